@@ -0,0 +1,204 @@
+#pragma once
+#include "MtQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// d-арная куча: при d = 4 дети узла лежат рядом в памяти, и спуск читает меньше кэш-линий,
+// чем в двоичной куче, а высота вдвое меньше. Порядок равных по приоритету элементов не сохраняется
+template <typename T, typename Compare, size_t Arity = 4>
+class DaryHeap
+{
+	static_assert(Arity >= 2, "DaryHeap arity must be at least 2");
+	static_assert(std::is_nothrow_move_constructible_v<T>, "DaryHeap requires T to be nothrow move constructible");
+
+public:
+	explicit DaryHeap(const Compare& compare = Compare())
+		: m_compare(compare)
+	{
+	}
+
+	template <typename U>
+	void Push(U&& value)
+	{
+		m_items.emplace_back(std::forward<U>(value));
+		SiftUp(m_items.size() - 1);
+	}
+
+	T& Front()
+	{
+		return m_items.front();
+	}
+
+	// На место вершины спускается последний элемент
+	void Pop()
+	{
+		T last = std::move(m_items.back());
+		m_items.pop_back();
+		if (!m_items.empty())
+		{
+			SiftDown(std::move(last));
+		}
+	}
+
+	size_t GetSize() const
+	{
+		return m_items.size();
+	}
+
+private:
+	// Элемент поднимается «дыркой»: родители сдвигаются вниз, а сам он записывается один раз
+	void SiftUp(size_t index)
+	{
+		T value = std::move(m_items[index]);
+		while (index > 0)
+		{
+			const auto parent = (index - 1) / Arity;
+			if (!m_compare(m_items[parent], value))
+			{
+				break;
+			}
+			m_items[index] = std::move(m_items[parent]);
+			index = parent;
+		}
+		m_items[index] = std::move(value);
+	}
+
+	void SiftDown(T value)
+	{
+		size_t index = 0;
+		const auto size = m_items.size();
+		for (;;)
+		{
+			const auto firstChild = index * Arity + 1;
+			if (firstChild >= size)
+			{
+				break;
+			}
+			const auto lastChild = std::min(firstChild + Arity, size);
+			auto best = firstChild;
+			for (auto child = firstChild + 1; child < lastChild; ++child)
+			{
+				if (m_compare(m_items[best], m_items[child]))
+				{
+					best = child;
+				}
+			}
+			if (!m_compare(value, m_items[best]))
+			{
+				break;
+			}
+			m_items[index] = std::move(m_items[best]);
+			index = best;
+		}
+		m_items[index] = std::move(value);
+	}
+
+	Compare m_compare;
+	std::vector<T> m_items;
+};
+
+// Режим полос для MtPriorityQueue: LaneOf раскладывает элементы по Lanes FIFO-полосам,
+// а потребители обходят полосы по кругу, забирая из каждой подряд не больше её веса
+template <size_t Lanes, typename LaneOf>
+struct WeightedLanes
+{
+};
+
+// Вставка и извлечение за O(1): при извлечении просматривается не больше Lanes + 1 полос
+template <typename T, size_t Lanes, typename LaneOf>
+class WeightedLaneStorage
+{
+	static_assert(Lanes >= 1, "WeightedLaneStorage needs at least one lane");
+
+public:
+	explicit WeightedLaneStorage(const std::array<unsigned, Lanes>& weights, const LaneOf& laneOf = LaneOf())
+		: m_weights(weights)
+		, m_laneOf(laneOf)
+	{
+		for (auto& weight : m_weights)
+		{
+			weight = std::max(weight, 1u);
+		}
+		m_credit = m_weights[0];
+	}
+
+	template <typename U>
+	void Push(U&& value)
+	{
+		const auto lane = m_laneOf(std::as_const(value));
+		if (lane >= Lanes)
+		{
+			throw std::out_of_range("Lane index is out of range");
+		}
+		m_lanes[lane].emplace_back(std::forward<U>(value));
+		++m_size;
+	}
+
+	T& Front()
+	{
+		return SelectLane().front();
+	}
+
+	void Pop()
+	{
+		SelectLane().pop_front();
+		--m_credit;
+		--m_size;
+	}
+
+	size_t GetSize() const
+	{
+		return m_size;
+	}
+
+private:
+	// Переходит к следующей полосе, только когда текущая пуста или исчерпала вес, поэтому
+	// повторный вызов перед Pop возвращает ту же полосу
+	std::deque<T>& SelectLane()
+	{
+		while (m_lanes[m_current].empty() || m_credit == 0)
+		{
+			m_current = (m_current + 1) % Lanes;
+			m_credit = m_weights[m_current];
+		}
+		return m_lanes[m_current];
+	}
+
+	std::array<std::deque<T>, Lanes> m_lanes;
+	std::array<unsigned, Lanes> m_weights;
+	LaneOf m_laneOf;
+	size_t m_current = 0;
+	unsigned m_credit = 0;
+	size_t m_size = 0;
+};
+
+// MtQueue с кучей вместо FIFO: ожидания, сроки, stop_token, пачки и Shutdown те же.
+// Первым выдаётся наибольший по Compare элемент, как в std::priority_queue. Для порядка по сроку
+// достаточно сравнения, у которого «больше» тот, чей срок раньше
+template <typename T, typename Compare = std::less<T>>
+class MtPriorityQueue : public MtQueue<T, DaryHeap<T, Compare>>
+{
+public:
+	explicit MtPriorityQueue(const size_t capacity = 0, const Compare& compare = Compare())
+		: MtQueue<T, DaryHeap<T, Compare>>(capacity, DaryHeap<T, Compare>(compare))
+	{
+	}
+};
+
+template <typename T, size_t Lanes, typename LaneOf>
+class MtPriorityQueue<T, WeightedLanes<Lanes, LaneOf>> : public MtQueue<T, WeightedLaneStorage<T, Lanes, LaneOf>>
+{
+public:
+	MtPriorityQueue(const size_t capacity, const std::array<unsigned, Lanes>& weights, const LaneOf& laneOf = LaneOf())
+		: MtQueue<T, WeightedLaneStorage<T, Lanes, LaneOf>>(capacity, WeightedLaneStorage<T, Lanes, LaneOf>(weights, laneOf))
+	{
+	}
+};
@@ -1,27 +1,145 @@
 #pragma once
+#include "SpscQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
 #include <condition_variable>
+#include <cstddef>
 #include <deque>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
-
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+// Хранилище элементов MtQueue под её блокировкой. Front — элемент, который будет выдан следующим;
+// Pop удаляет его. Порядок выдачи определяет хранилище, ожидания и остановку — сама очередь
+template <typename Storage, typename T>
+concept QueueStorage = requires(Storage storage, T value) {
+	storage.Push(std::move(value));
+	{ storage.Front() } -> std::same_as<T&>;
+	storage.Pop();
+	{ std::as_const(storage).GetSize() } -> std::convertible_to<size_t>;
+};
+
+// Хранилище по умолчанию: строгий FIFO
 template <typename T>
+class FifoStorage
+{
+public:
+	template <typename U>
+	void Push(U&& value)
+	{
+		m_items.emplace_back(std::forward<U>(value));
+	}
+
+	T& Front()
+	{
+		return m_items.front();
+	}
+
+	void Pop()
+	{
+		m_items.pop_front();
+	}
+
+	size_t GetSize() const
+	{
+		return m_items.size();
+	}
+
+	void Swap(std::deque<T>& items)
+	{
+		std::swap(m_items, items);
+	}
+
+private:
+	std::deque<T> m_items;
+};
+
+// Ровно один производитель и один потребитель: MtQueue<T, SpscPolicy<N>> становится SpscQueue<T, N>
+template <size_t Capacity, bool Blocking = true>
+struct SpscPolicy
+{
+};
+
+// Drain — потребители забирают оставшиеся элементы и только потом получают отказ,
+// FailFast — отказ сразу, оставшиеся элементы больше не выдаются
+enum class ShutdownMode
+{
+	Drain,
+	FailFast,
+};
+
+// Любое число производителей и потребителей. Storage задаёт порядок выдачи: FIFO по умолчанию,
+// куча и полосы с весами — в MtPriorityQueue.h
+template <typename T, typename Storage = FifoStorage<T>>
 class MtQueue
 {
+	static_assert(QueueStorage<Storage, T>, "MtQueue storage must provide Push, Front, Pop and GetSize");
+
 public:
-	explicit MtQueue(const size_t capacity = 0)
+	explicit MtQueue(const size_t capacity = 0, Storage storage = Storage())
 		: m_capacity(capacity)
+		, m_storage(std::move(storage))
 	{
 	}
 
+	// После Shutdown бросает исключение, в том числе производителю, который ждал места
 	void Push(const T& value)
 	{
-		DoPush(value);
+		if (!DoPush(value, {}, NoDeadline{}))
+		{
+			throw std::runtime_error("Queue is shut down");
+		}
 	}
 
 	void Push(T&& value)
 	{
-		DoPush(std::move(value));
+		if (!DoPush(std::move(value), {}, NoDeadline{}))
+		{
+			throw std::runtime_error("Queue is shut down");
+		}
+	}
+
+	// false, если запрошена остановка или очередь остановлена
+	bool Push(const T& value, const std::stop_token& stopToken)
+	{
+		return DoPush(value, stopToken, NoDeadline{});
+	}
+
+	bool Push(T&& value, const std::stop_token& stopToken)
+	{
+		return DoPush(std::move(value), stopToken, NoDeadline{});
+	}
+
+	// false, если место не освободилось за timeout или очередь остановлена
+	template <typename Rep, typename Period>
+	bool PushFor(const T& value, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return DoPush(value, {}, std::chrono::steady_clock::now() + timeout);
+	}
+
+	template <typename Rep, typename Period>
+	bool PushFor(T&& value, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return DoPush(std::move(value), {}, std::chrono::steady_clock::now() + timeout);
+	}
+
+	template <typename Clock, typename Duration>
+	bool PushUntil(const T& value, const std::chrono::time_point<Clock, Duration>& deadline)
+	{
+		return DoPush(value, {}, deadline);
+	}
+
+	template <typename Clock, typename Duration>
+	bool PushUntil(T&& value, const std::chrono::time_point<Clock, Duration>& deadline)
+	{
+		return DoPush(std::move(value), {}, deadline);
 	}
 
 	[[nodiscard]] bool TryPush(const T& value)
@@ -37,76 +155,153 @@ public:
 	bool TryPop(T& out)
 	{
 		std::unique_lock lock(m_mutex);
-		if (m_queue.empty())
+		if (!CanPop())
 		{
 			return false;
 		}
-		out = std::move(m_queue.front());
-		m_queue.pop_front();
-		m_cvNotFull.notify_one();
+		out = std::move(m_storage.Front());
+		m_storage.Pop();
+		NotifyNotFull(1);
 		return true;
 	}
 
 	std::unique_ptr<T> TryPop()
 	{
 		std::unique_lock lock(m_mutex);
-		if (m_queue.empty())
+		if (!CanPop())
 		{
 			return nullptr;
 		}
-		auto out = std::make_unique<T>(std::move(m_queue.front()));
+		auto out = std::make_unique<T>(std::move(m_storage.Front()));
 
-		m_queue.pop_front();
-		m_cvNotFull.notify_one();
+		m_storage.Pop();
+		NotifyNotFull(1);
 		return out;
 	}
 
+	// Из остановленной очереди, которой больше нечего выдать, бросает исключение
 	T WaitAndPop()
 	{
 		static_assert(std::is_nothrow_move_constructible_v<T>, "WaitAndPop by value requires T to be nothrow move constructible");
 
 		std::unique_lock lock(m_mutex);
-		m_cvNotEmpty.wait(lock, [this] {
-			return !m_queue.empty() || m_shutDown;
+		WaitUntil(m_cvNotEmpty, m_waitingConsumers, lock, {}, NoDeadline{}, [this] {
+			return CanPop() || m_shutDown;
 		});
+		if (!CanPop())
+		{
+			throw std::runtime_error("Queue is shut down");
+		}
 
-		T out = std::move(m_queue.front());
+		T out = std::move(m_storage.Front());
 
-		m_queue.pop_front();
-		m_cvNotFull.notify_one();
+		m_storage.Pop();
+		NotifyNotFull(1);
 		return out;
 	}
 
-	void WaitAndPop(T& out)
+	// false, если очередь остановлена и выдавать больше нечего
+	bool WaitAndPop(T& out)
 	{
-		std::unique_lock lock(m_mutex);
-		m_cvNotEmpty.wait(lock, [this] {
-			return !m_queue.empty() || m_shutDown;
-		});
+		return DoPop(out, {}, NoDeadline{});
+	}
 
-		if constexpr (std::is_nothrow_move_assignable_v<T> || !std::is_copy_assignable_v<T>)
+	// false также при запросе остановки
+	bool WaitAndPop(T& out, const std::stop_token& stopToken)
+	{
+		return DoPop(out, stopToken, NoDeadline{});
+	}
+
+	// false также по истечении времени; ожидание без опроса, поток спит до элемента или срока
+	template <typename Rep, typename Period>
+	bool WaitAndPopFor(T& out, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return DoPop(out, {}, std::chrono::steady_clock::now() + timeout);
+	}
+
+	template <typename Clock, typename Duration>
+	bool WaitAndPopUntil(T& out, const std::chrono::time_point<Clock, Duration>& deadline)
+	{
+		return DoPop(out, {}, deadline);
+	}
+
+	template <typename Rep, typename Period>
+	bool WaitAndPopFor(T& out, const std::chrono::duration<Rep, Period>& timeout, const std::stop_token& stopToken)
+	{
+		return DoPop(out, stopToken, std::chrono::steady_clock::now() + timeout);
+	}
+
+	// Кладёт элементы диапазона пачками: за одну блокировку столько, сколько помещается,
+	// и одно пробуждение на пачку. В ограниченной очереди ждёт, пока место освободится
+	template <std::input_iterator It>
+	void PushRange(It begin, const It end)
+	{
+		while (begin != end)
 		{
-			out = std::move(m_queue.front());
+			std::unique_lock lock(m_mutex);
+			WaitUntil(m_cvNotFull, m_waitingProducers, lock, {}, NoDeadline{}, [this] {
+				return !IsFull() || m_shutDown;
+			});
+			if (m_shutDown)
+			{
+				throw std::runtime_error("Queue is shut down");
+			}
+
+			size_t pushed = 0;
+			try
+			{
+				for (; begin != end && !IsFull(); ++begin, ++pushed)
+				{
+					m_storage.Push(*begin);
+				}
+			}
+			catch (...)
+			{
+				NotifyNotEmpty(pushed);
+				throw;
+			}
+			NotifyNotEmpty(pushed);
 		}
-		else
+	}
+
+	// Забирает до maxCount элементов за одну блокировку, возвращает их количество
+	template <typename OutputIt>
+	size_t TryPopBulk(OutputIt out, const size_t maxCount)
+	{
+		std::unique_lock lock(m_mutex);
+		if (!CanPop())
 		{
-			out = m_queue.front();
+			return 0;
 		}
+		return PopBulk(out, maxCount);
+	}
 
-		m_queue.pop_front();
-		m_cvNotFull.notify_one();
+	// Ждёт хотя бы одного элемента не дольше timeout и забирает до maxCount элементов.
+	// 0 — истёк таймаут или очередь остановлена и пуста
+	template <typename OutputIt, typename Rep, typename Period>
+	size_t WaitAndPopBulk(OutputIt out, const size_t maxCount, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		std::unique_lock lock(m_mutex);
+		WaitUntil(m_cvNotEmpty, m_waitingConsumers, lock, {}, std::chrono::steady_clock::now() + timeout, [this] {
+			return CanPop() || m_shutDown;
+		});
+		if (!CanPop())
+		{
+			return 0;
+		}
+		return PopBulk(out, maxCount);
 	}
 
 	size_t GetSize() const
 	{
 		std::shared_lock lock(m_mutex);
-		return m_queue.size();
+		return m_storage.GetSize();
 	}
 
 	[[nodiscard]] bool IsEmpty() const
 	{
 		std::shared_lock lock(m_mutex);
-		return m_queue.empty();
+		return m_storage.GetSize() == 0;
 	}
 
 	void Swap(MtQueue& other, const bool needNotifyAll = true)
@@ -121,11 +316,12 @@ public:
 	}
 
 	void Swap(std::deque<T>& other)
+		requires std::same_as<Storage, FifoStorage<T>>
 	{
 		std::unique_lock lock(m_mutex);
-		std::swap(m_queue, other);
+		m_storage.Swap(other);
 
-		if (!m_queue.empty())
+		if (m_storage.GetSize() > 0)
 		{
 			m_cvNotEmpty.notify_all();
 		}
@@ -135,10 +331,12 @@ public:
 		}
 	}
 
-	void Shutdown()
+	// Новые элементы больше не принимаются, ждущие производители и потребители просыпаются
+	void Shutdown(const ShutdownMode mode = ShutdownMode::Drain)
 	{
 		std::lock_guard lock(m_mutex);
 		m_shutDown = true;
+		m_shutdownMode = mode;
 		m_cvNotEmpty.notify_all();
 		m_cvNotFull.notify_all();
 	}
@@ -146,44 +344,156 @@ public:
 private:
 	bool IsFull() const
 	{
-		return m_capacity > 0 && m_queue.size() == m_capacity;
+		return m_capacity > 0 && m_storage.GetSize() >= m_capacity;
 	}
 
-	template <typename U>
-	void DoPush(U&& value)
+	// Ожидание без срока
+	struct NoDeadline
+	{
+	};
+
+	bool CanPop() const
+	{
+		return m_storage.GetSize() > 0 && !(m_shutDown && m_shutdownMode == ShutdownMode::FailFast);
+	}
+
+	template <typename U, typename Deadline>
+	bool DoPush(U&& value, const std::stop_token& stopToken, const Deadline& deadline)
+	{
+		std::unique_lock lock(m_mutex);
+		WaitUntil(m_cvNotFull, m_waitingProducers, lock, stopToken, deadline, [this] {
+			return !IsFull() || m_shutDown;
+		});
+		if (IsFull() || m_shutDown)
+		{
+			return false;
+		}
+
+		m_storage.Push(std::forward<U>(value));
+		NotifyNotEmpty(1);
+		return true;
+	}
+
+	template <typename Deadline>
+	bool DoPop(T& out, const std::stop_token& stopToken, const Deadline& deadline)
 	{
 		std::unique_lock lock(m_mutex);
+		WaitUntil(m_cvNotEmpty, m_waitingConsumers, lock, stopToken, deadline, [this] {
+			return CanPop() || m_shutDown;
+		});
+		if (!CanPop())
+		{
+			return false;
+		}
 
-		if (m_capacity > 0)
+		if constexpr (std::is_nothrow_move_assignable_v<T> || !std::is_copy_assignable_v<T>)
 		{
-			m_cvNotFull.wait(lock, [this] {
-				return !IsFull();
-			});
+			out = std::move(m_storage.Front());
+		}
+		else
+		{
+			out = m_storage.Front();
 		}
 
-		m_queue.emplace_back(std::forward<U>(value));
-		m_cvNotEmpty.notify_one();
+		m_storage.Pop();
+		NotifyNotFull(1);
+		return true;
 	}
 
 	template <typename U>
 	bool DoTryPush(U&& value)
 	{
 		std::unique_lock lock(m_mutex);
-		if (IsFull())
+		if (IsFull() || m_shutDown)
 		{
 			return false;
 		}
 
-		m_queue.emplace_back(std::forward<U>(value));
-		m_cvNotEmpty.notify_one();
+		m_storage.Push(std::forward<U>(value));
+		NotifyNotEmpty(1);
 		return true;
 	}
 
+	template <typename OutputIt>
+	size_t PopBulk(OutputIt& out, const size_t maxCount)
+	{
+		const auto count = std::min(maxCount, m_storage.GetSize());
+		for (size_t i = 0; i < count; ++i)
+		{
+			*out = std::move(m_storage.Front());
+			++out;
+			m_storage.Pop();
+		}
+		NotifyNotFull(count);
+		return count;
+	}
+
+	// Ждущие считаются, чтобы не будить условную переменную, когда никто не ждёт.
+	// Условная переменная сама просыпается по сроку и по запросу остановки, опрашивать очередь не нужно
+	template <typename Deadline, typename Predicate>
+	static bool WaitUntil(
+		std::condition_variable_any& cv,
+		size_t& waiting,
+		std::unique_lock<std::shared_mutex>& lock,
+		const std::stop_token& stopToken,
+		const Deadline& deadline,
+		Predicate predicate)
+	{
+		if (predicate())
+		{
+			return true;
+		}
+		++waiting;
+		bool result;
+		if constexpr (std::is_same_v<Deadline, NoDeadline>)
+		{
+			result = cv.wait(lock, stopToken, predicate);
+		}
+		else
+		{
+			result = cv.wait_until(lock, stopToken, deadline, predicate);
+		}
+		--waiting;
+		return result;
+	}
+
+	// Будит столько ждущих, сколько элементов или мест стало доступно
+	static void Notify(std::condition_variable_any& cv, const size_t waiting, const size_t count)
+	{
+		if (waiting == 0 || count == 0)
+		{
+			return;
+		}
+		if (count >= waiting)
+		{
+			cv.notify_all();
+			return;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			cv.notify_one();
+		}
+	}
+
+	void NotifyNotEmpty(const size_t count)
+	{
+		Notify(m_cvNotEmpty, m_waitingConsumers, count);
+	}
+
+	void NotifyNotFull(const size_t count)
+	{
+		if (m_capacity > 0)
+		{
+			Notify(m_cvNotFull, m_waitingProducers, count);
+		}
+	}
+
 	void DoSwap(MtQueue& other, const bool needNotifyAll)
 	{
-		std::swap(m_queue, other.m_queue);
+		std::swap(m_storage, other.m_storage);
 		std::swap(m_capacity, other.m_capacity);
 		std::swap(m_shutDown, other.m_shutDown);
+		std::swap(m_shutdownMode, other.m_shutdownMode);
 
 		auto notify = [needNotifyAll](auto& cv) {
 			if (needNotifyAll)
@@ -196,11 +506,11 @@ private:
 			}
 		};
 
-		if (!m_queue.empty())
+		if (m_storage.GetSize() > 0)
 		{
 			notify(m_cvNotEmpty);
 		}
-		if (!other.m_queue.empty())
+		if (other.m_storage.GetSize() > 0)
 		{
 			notify(other.m_cvNotEmpty);
 		}
@@ -215,9 +525,17 @@ private:
 	}
 
 	bool m_shutDown = false;
+	ShutdownMode m_shutdownMode = ShutdownMode::Drain;
 	size_t m_capacity;
-	std::deque<T> m_queue;
+	Storage m_storage;
 	mutable std::shared_mutex m_mutex;
 	std::condition_variable_any m_cvNotEmpty;
 	std::condition_variable_any m_cvNotFull;
-};
\ No newline at end of file
+	size_t m_waitingConsumers = 0;
+	size_t m_waitingProducers = 0;
+};
+
+template <typename T, size_t Capacity, bool Blocking>
+class MtQueue<T, SpscPolicy<Capacity, Blocking>> : public SpscQueue<T, Capacity, Blocking>
+{
+};
@@ -1,5 +1,9 @@
+#include "MtPriorityQueue.h"
 #include "MtQueue.h"
+#include "MtRingQueue.h"
 #include <catch2/catch_all.hpp>
+#include <numeric>
+#include <random>
 #include <utility>
 
 struct QueueItem
@@ -40,6 +44,30 @@ public:
 	}
 };
 
+// Кольцевой очереди нужен не бросающий перенос, копирование по-прежнему может бросить
+class CopyBomb
+{
+public:
+	int value;
+
+	explicit CopyBomb(const int v = 0)
+		: value(v)
+	{
+	}
+
+	CopyBomb(const CopyBomb& other)
+		: value(other.value)
+	{
+		if (Bomb::s_explodeOnCopy)
+		{
+			throw std::runtime_error("Copy Boom!");
+		}
+	}
+
+	CopyBomb(CopyBomb&& other) noexcept = default;
+	CopyBomb& operator=(CopyBomb&& other) noexcept = default;
+};
+
 TEST_CASE("Single thread")
 {
 	SECTION("Try pop")
@@ -297,4 +325,698 @@ TEST_CASE("Multiple threads")
 		REQUIRE(queue.TryPop(value) == true);
 		REQUIRE(value == 84);
 	}
-}
\ No newline at end of file
+}
+
+TEST_CASE("Timed waits and cancellation")
+{
+	using namespace std::chrono_literals;
+
+	SECTION("Wait and pop for times out on empty queue")
+	{
+		MtQueue<int> queue;
+		int value = 0;
+		const auto start = std::chrono::steady_clock::now();
+		REQUIRE_FALSE(queue.WaitAndPopFor(value, 50ms));
+		REQUIRE(std::chrono::steady_clock::now() - start >= 50ms);
+	}
+
+	SECTION("Wait and pop until wakes on push before deadline")
+	{
+		MtQueue<int> queue;
+		std::thread producer([&] {
+			std::this_thread::sleep_for(20ms);
+			queue.Push(7);
+		});
+
+		int value = 0;
+		REQUIRE(queue.WaitAndPopUntil(value, std::chrono::system_clock::now() + 5s));
+		REQUIRE(value == 7);
+		producer.join();
+	}
+
+	SECTION("Push for waits for free slot with deadline")
+	{
+		MtQueue<QueueItem> queue(1);
+		queue.Push({ 1, "first" });
+		REQUIRE_FALSE(queue.PushFor({ 2, "second" }, 30ms));
+
+		std::atomic poppedId{ 0 };
+		std::thread consumer([&] {
+			std::this_thread::sleep_for(20ms);
+			if (const auto item = queue.TryPop())
+			{
+				poppedId = item->id;
+			}
+		});
+		REQUIRE(queue.PushFor({ 3, "third" }, 5s));
+		consumer.join();
+		REQUIRE(poppedId == 1);
+		REQUIRE(queue.TryPop()->id == 3);
+	}
+
+	SECTION("Stop token cancels waiting consumer and producer")
+	{
+		MtQueue<int> queue(1);
+		queue.Push(1);
+
+		std::atomic pushed{ true };
+		std::jthread producer([&](const std::stop_token& stopToken) {
+			pushed = queue.Push(2, stopToken);
+		});
+
+		MtQueue<int> emptyQueue;
+		std::atomic popped{ true };
+		std::jthread consumer([&](const std::stop_token& stopToken) {
+			int value = 0;
+			popped = emptyQueue.WaitAndPop(value, stopToken);
+		});
+
+		std::this_thread::sleep_for(20ms);
+		producer.request_stop();
+		consumer.request_stop();
+		producer.join();
+		consumer.join();
+		REQUIRE_FALSE(pushed);
+		REQUIRE_FALSE(popped);
+		REQUIRE(queue.GetSize() == 1);
+	}
+}
+
+TEST_CASE("Shutdown")
+{
+	SECTION("Drain gives out remaining items")
+	{
+		MtQueue<int> queue;
+		queue.Push(1);
+		queue.Push(2);
+		queue.Shutdown();
+
+		REQUIRE_FALSE(queue.TryPush(3));
+		REQUIRE_THROWS(queue.Push(3));
+
+		int value = 0;
+		REQUIRE(queue.TryPop(value));
+		REQUIRE(value == 1);
+		REQUIRE(queue.WaitAndPop() == 2);
+		REQUIRE_FALSE(queue.WaitAndPop(value));
+		REQUIRE_THROWS(queue.WaitAndPop());
+	}
+
+	SECTION("Fail fast refuses remaining items")
+	{
+		MtQueue<int> queue;
+		queue.Push(1);
+		queue.Shutdown(ShutdownMode::FailFast);
+
+		int value = 0;
+		REQUIRE_FALSE(queue.TryPop(value));
+		REQUIRE_FALSE(queue.WaitAndPop(value));
+		REQUIRE(queue.GetSize() == 1);
+	}
+
+	SECTION("Wakes waiting consumers and producers")
+	{
+		MtQueue<int> emptyQueue;
+		MtQueue<int> fullQueue(1);
+		fullQueue.Push(1);
+
+		std::atomic popped{ true };
+		std::atomic pushThrew{ false };
+		std::thread consumer([&] {
+			int value = 0;
+			popped = emptyQueue.WaitAndPop(value);
+		});
+		std::thread producer([&] {
+			try
+			{
+				fullQueue.Push(2);
+			}
+			catch (const std::runtime_error&)
+			{
+				pushThrew = true;
+			}
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		emptyQueue.Shutdown();
+		fullQueue.Shutdown();
+		consumer.join();
+		producer.join();
+		REQUIRE_FALSE(popped);
+		REQUIRE(pushThrew);
+	}
+}
+
+TEST_CASE("Bulk operations")
+{
+	SECTION("Push range and try pop bulk")
+	{
+		MtQueue<int> queue;
+		const std::vector values = { 1, 2, 3, 4, 5 };
+		queue.PushRange(values.begin(), values.end());
+		REQUIRE(queue.GetSize() == 5);
+
+		std::vector<int> popped;
+		REQUIRE(queue.TryPopBulk(std::back_inserter(popped), 3) == 3);
+		REQUIRE(popped == std::vector{ 1, 2, 3 });
+		REQUIRE(queue.TryPopBulk(std::back_inserter(popped), 10) == 2);
+		REQUIRE(popped == values);
+		REQUIRE(queue.TryPopBulk(std::back_inserter(popped), 10) == 0);
+	}
+
+	SECTION("Wait and pop bulk times out on empty queue")
+	{
+		MtQueue<int> queue;
+		std::vector<int> popped;
+		const auto start = std::chrono::steady_clock::now();
+		REQUIRE(queue.WaitAndPopBulk(std::back_inserter(popped), 10, std::chrono::milliseconds(50)) == 0);
+		REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+		REQUIRE(popped.empty());
+	}
+
+	SECTION("Push range into bounded queue waits for free space")
+	{
+		constexpr int ELEMENTS = 100;
+		MtQueue<int> queue(3);
+		std::vector<int> values(ELEMENTS);
+		std::iota(values.begin(), values.end(), 0);
+
+		std::thread producer([&] {
+			queue.PushRange(values.begin(), values.end());
+		});
+
+		std::vector<int> popped;
+		while (popped.size() < ELEMENTS)
+		{
+			REQUIRE(queue.GetSize() <= 3);
+			queue.WaitAndPopBulk(std::back_inserter(popped), 2, std::chrono::seconds(5));
+		}
+		producer.join();
+		REQUIRE(popped == values);
+	}
+
+	SECTION("Push range wakes several consumers")
+	{
+		MtQueue<int> queue;
+		std::atomic poppedCount{ 0 };
+		std::vector<std::thread> consumers;
+		for (int i = 0; i < 3; ++i)
+		{
+			consumers.emplace_back([&] {
+				std::vector<int> popped;
+				poppedCount.fetch_add(static_cast<int>(queue.WaitAndPopBulk(std::back_inserter(popped), 1, std::chrono::seconds(5))));
+			});
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		const std::vector values = { 1, 2, 3 };
+		const auto start = std::chrono::steady_clock::now();
+		queue.PushRange(values.begin(), values.end());
+		for (auto& consumer : consumers)
+		{
+			consumer.join();
+		}
+		REQUIRE(poppedCount == 3);
+		REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+	}
+}
+
+TEST_CASE("Ring queue")
+{
+	SECTION("Capacity is rounded up to power of two")
+	{
+		MtRingQueue<int> queue(3);
+		REQUIRE(queue.GetCapacity() == 4);
+		for (int i = 0; i < 4; ++i)
+		{
+			REQUIRE(queue.TryPush(i));
+		}
+		REQUIRE_FALSE(queue.TryPush(4));
+		REQUIRE(queue.GetSize() == 4);
+	}
+
+	SECTION("FIFO order across wrap-around")
+	{
+		MtRingQueue<QueueItem> queue(2);
+		int nextPopped = 0;
+		for (int i = 0; i < 10; ++i)
+		{
+			REQUIRE(queue.TryPush({ i, "item" }));
+			if (i % 2 == 1)
+			{
+				REQUIRE(queue.TryPop()->id == nextPopped++);
+				QueueItem out;
+				REQUIRE(queue.TryPop(out));
+				REQUIRE(out.id == nextPopped++);
+			}
+		}
+		REQUIRE(queue.IsEmpty());
+		REQUIRE(queue.TryPop() == nullptr);
+	}
+
+	SECTION("Copy exception")
+	{
+		Bomb::s_explodeOnCopy = false;
+		MtRingQueue<CopyBomb> queue(2);
+		queue.Push(CopyBomb(1));
+
+		Bomb::s_explodeOnCopy = true;
+		const CopyBomb bomb(2);
+		REQUIRE_THROWS(queue.Push(bomb));
+		REQUIRE_THROWS(static_cast<void>(queue.TryPush(bomb)));
+		REQUIRE(queue.GetSize() == 1);
+
+		Bomb::s_explodeOnCopy = false;
+		queue.Push(bomb);
+		REQUIRE(queue.GetSize() == 2);
+		REQUIRE(queue.WaitAndPop().value == 1);
+		REQUIRE(queue.WaitAndPop().value == 2);
+	}
+
+	SECTION("Remaining items are destroyed with queue")
+	{
+		const auto item = std::make_shared<int>(1);
+		{
+			MtRingQueue<std::shared_ptr<int>> queue(4);
+			queue.Push(item);
+			queue.Push(item);
+			REQUIRE(item.use_count() == 3);
+		}
+		REQUIRE(item.use_count() == 1);
+	}
+
+	SECTION("Push waits for free slot")
+	{
+		MtRingQueue<int> queue(2);
+		queue.Push(1);
+		queue.Push(2);
+
+		std::atomic pushCompleted{ false };
+		std::thread producer([&] {
+			queue.Push(3);
+			pushCompleted = true;
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		REQUIRE(pushCompleted == false);
+		REQUIRE(queue.WaitAndPop() == 1);
+
+		producer.join();
+		REQUIRE(pushCompleted == true);
+		REQUIRE(queue.WaitAndPop() == 2);
+		REQUIRE(queue.WaitAndPop() == 3);
+	}
+
+	SECTION("Shutdown wakes waiting consumers after drain")
+	{
+		MtRingQueue<int> queue(4);
+		queue.Push(42);
+
+		std::atomic poppedCount{ 0 };
+		std::atomic poppedSum{ 0 };
+		std::vector<std::thread> consumers;
+		for (int i = 0; i < 3; ++i)
+		{
+			consumers.emplace_back([&] {
+				int value = 0;
+				while (queue.WaitAndPop(value))
+				{
+					poppedSum.fetch_add(value);
+					poppedCount.fetch_add(1);
+				}
+			});
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		queue.Shutdown();
+		for (auto& consumer : consumers)
+		{
+			consumer.join();
+		}
+		REQUIRE(poppedCount == 1);
+		REQUIRE(poppedSum == 42);
+		REQUIRE_THROWS(queue.WaitAndPop());
+	}
+
+	SECTION("Shutdown refuses new items")
+	{
+		MtRingQueue<int> queue(4);
+		queue.Push(1);
+		queue.Shutdown();
+
+		REQUIRE_FALSE(queue.TryPush(2));
+		REQUIRE_THROWS(queue.Push(3));
+		REQUIRE(queue.GetSize() == 1);
+		REQUIRE(queue.WaitAndPop() == 1);
+		REQUIRE(queue.IsEmpty());
+	}
+
+	SECTION("Burst of pushes wakes every parked consumer")
+	{
+		constexpr int ROUNDS = 300;
+		constexpr int CONSUMERS = 4;
+
+		// Каждый потребитель берёт один элемент, поэтому потерянное пробуждение оставляет элемент в очереди.
+		// Shutdown по истечении срока не даёт тесту зависнуть, если пробуждение всё-таки потеряется
+		int lostRounds = 0;
+		for (int round = 0; round < ROUNDS; ++round)
+		{
+			MtRingQueue<int> queue(8);
+			std::atomic poppedCount{ 0 };
+			std::vector<std::thread> consumers;
+			for (int i = 0; i < CONSUMERS; ++i)
+			{
+				consumers.emplace_back([&] {
+					int value = 0;
+					if (queue.WaitAndPop(value))
+					{
+						poppedCount.fetch_add(1);
+					}
+				});
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			for (int i = 0; i < CONSUMERS; ++i)
+			{
+				queue.Push(i);
+			}
+
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+			while (poppedCount < CONSUMERS && std::chrono::steady_clock::now() < deadline)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			if (poppedCount < CONSUMERS)
+			{
+				++lostRounds;
+			}
+			queue.Shutdown();
+			for (auto& consumer : consumers)
+			{
+				consumer.join();
+			}
+		}
+		REQUIRE(lostRounds == 0);
+	}
+
+	SECTION("Producer-consumer")
+	{
+		constexpr int N_PRODUCERS = 4;
+		constexpr int M_CONSUMERS = 4;
+		constexpr int K_ELEMENTS_PER_PRODUCER = 20000;
+		constexpr int ELEMENTS_PER_CONSUMER = N_PRODUCERS * K_ELEMENTS_PER_PRODUCER / M_CONSUMERS;
+
+		MtRingQueue<int> queue(16);
+		std::vector<int> seen(N_PRODUCERS * K_ELEMENTS_PER_PRODUCER, 0);
+		std::mutex mutex;
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < N_PRODUCERS; ++i)
+		{
+			threads.emplace_back([&, i] {
+				for (int j = 0; j < K_ELEMENTS_PER_PRODUCER; ++j)
+				{
+					queue.Push(i * K_ELEMENTS_PER_PRODUCER + j);
+				}
+			});
+		}
+		for (int i = 0; i < M_CONSUMERS; ++i)
+		{
+			threads.emplace_back([&] {
+				std::vector<int> popped;
+				for (int j = 0; j < ELEMENTS_PER_CONSUMER; ++j)
+				{
+					popped.push_back(queue.WaitAndPop());
+				}
+				std::lock_guard lock(mutex);
+				for (const auto value : popped)
+				{
+					++seen[value];
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		REQUIRE(std::ranges::all_of(seen, [](const int count) {
+			return count == 1;
+		}));
+		REQUIRE(queue.IsEmpty());
+	}
+}
+
+TEST_CASE("Spsc queue")
+{
+	SECTION("Selected by policy tag")
+	{
+		MtQueue<QueueItem, SpscPolicy<4>> queue;
+		static_assert(std::is_base_of_v<SpscQueue<QueueItem, 4>, decltype(queue)>);
+		REQUIRE(queue.GetCapacity() == 4);
+		for (int i = 0; i < 4; ++i)
+		{
+			REQUIRE(queue.TryPush({ i, "item" }));
+		}
+		REQUIRE_FALSE(queue.TryPush({ 4, "item" }));
+		REQUIRE(queue.GetSize() == 4);
+	}
+
+	SECTION("FIFO order across wrap-around")
+	{
+		SpscQueue<int, 2, false> queue;
+		for (int i = 0; i < 10; ++i)
+		{
+			REQUIRE(queue.TryPush(i));
+			int out = -1;
+			REQUIRE(queue.TryPop(out));
+			REQUIRE(out == i);
+		}
+		REQUIRE(queue.IsEmpty());
+		REQUIRE(queue.TryPop() == nullptr);
+	}
+
+	SECTION("Copy exception")
+	{
+		Bomb::s_explodeOnCopy = false;
+		SpscQueue<CopyBomb, 2> queue;
+		queue.Push(CopyBomb(1));
+
+		Bomb::s_explodeOnCopy = true;
+		const CopyBomb bomb(2);
+		REQUIRE_THROWS(queue.Push(bomb));
+		REQUIRE_THROWS(static_cast<void>(queue.TryPush(bomb)));
+		REQUIRE(queue.GetSize() == 1);
+
+		Bomb::s_explodeOnCopy = false;
+		REQUIRE(queue.TryPush(bomb));
+		REQUIRE(queue.WaitAndPop().value == 1);
+		REQUIRE(queue.WaitAndPop().value == 2);
+	}
+
+	SECTION("Shutdown wakes waiting consumer after drain")
+	{
+		SpscQueue<int, 4> queue;
+		queue.Push(42);
+
+		std::vector<int> popped;
+		std::thread consumer([&] {
+			int value = 0;
+			while (queue.WaitAndPop(value))
+			{
+				popped.push_back(value);
+			}
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		queue.Shutdown();
+		consumer.join();
+		REQUIRE(popped == std::vector{ 42 });
+		REQUIRE_THROWS(queue.WaitAndPop());
+	}
+
+	SECTION("Shutdown refuses new items")
+	{
+		MtQueue<int, SpscPolicy<4>> queue;
+		queue.Push(1);
+		queue.Shutdown();
+
+		const auto item = 2;
+		REQUIRE_FALSE(queue.TryPush(item));
+		REQUIRE_FALSE(queue.TryPush(3));
+		REQUIRE_THROWS(queue.Push(4));
+		REQUIRE(queue.GetSize() == 1);
+		REQUIRE(queue.WaitAndPop() == 1);
+		REQUIRE(queue.IsEmpty());
+	}
+
+	SECTION("Producer-consumer")
+	{
+		constexpr int ELEMENTS = 200000;
+		MtQueue<std::unique_ptr<int>, SpscPolicy<64>> queue;
+
+		std::thread producer([&] {
+			for (int i = 0; i < ELEMENTS; ++i)
+			{
+				queue.Push(std::make_unique<int>(i));
+			}
+		});
+
+		bool ordered = true;
+		for (int i = 0; i < ELEMENTS; ++i)
+		{
+			ordered = ordered && *queue.WaitAndPop() == i;
+		}
+		producer.join();
+		REQUIRE(ordered);
+		REQUIRE(queue.IsEmpty());
+	}
+}
+
+TEST_CASE("Priority queue")
+{
+	SECTION("Heap gives out largest first for any arity")
+	{
+		std::mt19937 random(42);
+		std::vector<int> values(1000);
+		for (auto& value : values)
+		{
+			value = static_cast<int>(random() % 100);
+		}
+
+		auto check = [&](auto heap) {
+			for (const auto value : values)
+			{
+				heap.Push(value);
+			}
+			std::vector<int> popped;
+			while (heap.GetSize() > 0)
+			{
+				popped.push_back(heap.Front());
+				heap.Pop();
+			}
+			return std::ranges::is_sorted(popped, std::greater{}) && popped.size() == values.size();
+		};
+		REQUIRE(check(DaryHeap<int, std::less<int>, 2>()));
+		REQUIRE(check(DaryHeap<int, std::less<int>, 3>()));
+		REQUIRE(check(DaryHeap<int, std::less<int>, 4>()));
+		REQUIRE(check(DaryHeap<int, std::less<int>, 8>()));
+	}
+
+	SECTION("Deadline order")
+	{
+		struct Job
+		{
+			int id;
+			std::chrono::steady_clock::time_point deadline;
+		};
+		struct EarlierDeadlineFirst
+		{
+			bool operator()(const Job& left, const Job& right) const
+			{
+				return left.deadline > right.deadline;
+			}
+		};
+
+		const auto now = std::chrono::steady_clock::now();
+		MtPriorityQueue<Job, EarlierDeadlineFirst> queue;
+		queue.Push({ 1, now + std::chrono::seconds(3) });
+		queue.Push({ 2, now + std::chrono::seconds(1) });
+		queue.Push({ 3, now + std::chrono::seconds(2) });
+
+		REQUIRE(queue.WaitAndPop().id == 2);
+		REQUIRE(queue.WaitAndPop().id == 3);
+		REQUIRE(queue.WaitAndPop().id == 1);
+		REQUIRE(queue.IsEmpty());
+	}
+
+	SECTION("Bounded")
+	{
+		MtPriorityQueue<int> queue(2);
+		REQUIRE(queue.TryPush(1));
+		REQUIRE(queue.TryPush(5));
+		REQUIRE_FALSE(queue.TryPush(3));
+		REQUIRE_FALSE(queue.PushFor(3, std::chrono::milliseconds(20)));
+
+		std::thread producer([&] {
+			queue.Push(3);
+		});
+		REQUIRE(queue.WaitAndPop() == 5);
+		producer.join();
+		REQUIRE(queue.WaitAndPop() == 3);
+		REQUIRE(*queue.TryPop() == 1);
+	}
+
+	SECTION("Bulk operations and deadlines")
+	{
+		MtPriorityQueue<int> queue(3);
+		const std::vector values = { 2, 7, 4, 9, 1 };
+		std::thread producer([&] {
+			queue.PushRange(values.begin(), values.end());
+		});
+
+		std::vector<int> popped;
+		while (popped.size() < values.size())
+		{
+			queue.WaitAndPopBulk(std::back_inserter(popped), 2, std::chrono::seconds(5));
+		}
+		producer.join();
+		std::ranges::sort(popped);
+		REQUIRE(popped == std::vector{ 1, 2, 4, 7, 9 });
+
+		queue.PushRange(values.begin(), values.begin() + 3);
+		REQUIRE_FALSE(queue.PushUntil(5, std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+		popped.clear();
+		REQUIRE(queue.TryPopBulk(std::back_inserter(popped), 2) == 2);
+		REQUIRE(popped == std::vector{ 7, 4 });
+		REQUIRE(queue.PushUntil(5, std::chrono::system_clock::now() + std::chrono::seconds(5)));
+		REQUIRE(queue.WaitAndPop() == 5);
+		REQUIRE(queue.WaitAndPop() == 2);
+	}
+
+	SECTION("Weighted lanes")
+	{
+		struct ValueLane
+		{
+			size_t operator()(const int value) const
+			{
+				return static_cast<size_t>(value / 100);
+			}
+		};
+
+		MtPriorityQueue<int, WeightedLanes<2, ValueLane>> queue(0, { 3, 1 });
+		for (int i = 0; i < 8; ++i)
+		{
+			queue.Push(i);
+		}
+		for (int i = 100; i < 104; ++i)
+		{
+			queue.Push(i);
+		}
+		REQUIRE_THROWS(queue.Push(1000));
+
+		std::vector<int> popped;
+		int value = 0;
+		while (queue.TryPop(value))
+		{
+			popped.push_back(value);
+		}
+		REQUIRE(popped == std::vector{ 0, 1, 2, 100, 3, 4, 5, 101, 6, 7, 102, 103 });
+	}
+
+	SECTION("Shutdown fail fast wakes consumers")
+	{
+		MtPriorityQueue<int> queue;
+		std::atomic popped{ true };
+		std::thread consumer([&] {
+			int value = 0;
+			popped = queue.WaitAndPop(value);
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		queue.Shutdown(ShutdownMode::FailFast);
+		consumer.join();
+		REQUIRE_FALSE(popped);
+		REQUIRE_FALSE(queue.TryPush(1));
+	}
+}
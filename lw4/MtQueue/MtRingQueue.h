@@ -0,0 +1,379 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Ограниченная очередь без блокировок на кольце слотов с номерами последовательности (MPMC-очередь Вьюкова).
+// Производители и потребители конкурируют только за свой счётчик позиции, а слот передаётся между ними
+// через его номер. Ждущие потоки сначала недолго крутятся, а потом засыпают на atomic::wait,
+// и будятся только если кто-то действительно ждёт
+template <typename T>
+class MtRingQueue
+{
+	static_assert(std::is_nothrow_move_constructible_v<T>, "MtRingQueue requires T to be nothrow move constructible");
+
+public:
+	// Ёмкость округляется вверх до степени двойки, но не меньше 2
+	explicit MtRingQueue(const size_t capacity)
+		: m_mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+		, m_slots(m_mask + 1)
+	{
+		for (size_t i = 0; i < m_slots.size(); ++i)
+		{
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	~MtRingQueue()
+	{
+		const auto end = m_enqueuePos.load(std::memory_order_relaxed);
+		for (auto pos = m_dequeuePos.load(std::memory_order_relaxed); pos != end; ++pos)
+		{
+			std::destroy_at(m_slots[pos & m_mask].Get());
+		}
+	}
+
+	MtRingQueue(const MtRingQueue&) = delete;
+	MtRingQueue& operator=(const MtRingQueue&) = delete;
+
+	// Ждёт свободного места; после Shutdown бросает исключение, в том числе производителю, который ждал места
+	void Push(const T& value)
+	{
+		DoPush(value);
+	}
+
+	void Push(T&& value)
+	{
+		DoPush(std::move(value));
+	}
+
+	// false, если очередь полна или остановлена
+	[[nodiscard]] bool TryPush(const T& value)
+	{
+		return DoTryPush(value);
+	}
+
+	[[nodiscard]] bool TryPush(T&& value)
+	{
+		return DoTryPush(std::move(value));
+	}
+
+	bool TryPop(T& out)
+	{
+		auto value = DoTryPop();
+		if (!value)
+		{
+			return false;
+		}
+		out = std::move(*value);
+		return true;
+	}
+
+	std::unique_ptr<T> TryPop()
+	{
+		auto value = DoTryPop();
+		if (!value)
+		{
+			return nullptr;
+		}
+		return std::make_unique<T>(std::move(*value));
+	}
+
+	// После Shutdown оставшиеся элементы ещё выдаются, а из пустой очереди — исключение
+	T WaitAndPop()
+	{
+		std::optional<T> value;
+		if (!WaitFor(m_notEmpty, [&] {
+				value = DoTryPop();
+				return value.has_value();
+			}))
+		{
+			throw std::runtime_error("Queue is shut down");
+		}
+		return std::move(*value);
+	}
+
+	// false, если очередь остановлена и пуста
+	bool WaitAndPop(T& out)
+	{
+		std::optional<T> value;
+		if (!WaitFor(m_notEmpty, [&] {
+				value = DoTryPop();
+				return value.has_value();
+			}))
+		{
+			return false;
+		}
+		out = std::move(*value);
+		return true;
+	}
+
+	// Приблизительный размер: при одновременных операциях может сразу устареть
+	size_t GetSize() const
+	{
+		const auto dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+		const auto enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+		return enqueuePos > dequeuePos ? std::min(enqueuePos - dequeuePos, GetCapacity()) : 0;
+	}
+
+	[[nodiscard]] bool IsEmpty() const
+	{
+		return GetSize() == 0;
+	}
+
+	size_t GetCapacity() const
+	{
+		return m_mask + 1;
+	}
+
+	// Новые элементы больше не принимаются, оставшиеся ещё выдаются, ждущие стороны просыпаются
+	void Shutdown()
+	{
+		m_shutDown.store(true, std::memory_order_release);
+		for (auto* waitPoint : { &m_notEmpty, &m_notFull })
+		{
+			// Шаг 2 сохраняет признак отправленного пробуждения
+			waitPoint->epoch.fetch_add(2, std::memory_order_release);
+			waitPoint->epoch.notify_all();
+		}
+	}
+
+private:
+	static constexpr size_t CACHE_LINE_SIZE = 64;
+	static constexpr int SPIN_COUNT = 64;
+
+	// Слот занимает целую кэш-линию, чтобы соседние производители и потребители не мешали друг другу
+	struct alignas(CACHE_LINE_SIZE) Slot
+	{
+		// pos — слот свободен для записи в позицию pos, pos + 1 — в слоте элемент позиции pos
+		std::atomic<size_t> sequence;
+		alignas(T) unsigned char storage[sizeof(T)];
+
+		T* Get()
+		{
+			return std::launder(reinterpret_cast<T*>(storage));
+		}
+	};
+
+	// Засыпание на счётчике событий: эпоха меняется, только если кто-то записался в ждущие.
+	// Младший бит эпохи отмечает пробуждение, которое ещё никто не получил. Пока бит стоит, новые элементы
+	// никого не будят, поэтому получивший пробуждение поток, закончив свою операцию, передаёт его дальше
+	struct alignas(CACHE_LINE_SIZE) WaitPoint
+	{
+		std::atomic<uint32_t> epoch{ 0 };
+		std::atomic<uint32_t> waiters{ 0 };
+	};
+
+	static void CpuRelax()
+	{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	template <typename U>
+	void DoPush(U&& value)
+	{
+		if constexpr (std::is_nothrow_constructible_v<T, U&&>)
+		{
+			if (!WaitFor(m_notFull, [&] {
+					return TryEmplace(std::forward<U>(value));
+				}))
+			{
+				throw std::runtime_error("Queue is shut down");
+			}
+		}
+		else
+		{
+			T item(std::forward<U>(value));
+			DoPush(std::move(item));
+		}
+	}
+
+	template <typename U>
+	bool DoTryPush(U&& value)
+	{
+		// Копия делается до захвата слота: если она бросит, занятый слот не останется недописанным
+		if constexpr (std::is_nothrow_constructible_v<T, U&&>)
+		{
+			return TryEmplace(std::forward<U>(value));
+		}
+		else
+		{
+			T item(std::forward<U>(value));
+			return TryEmplace(std::move(item));
+		}
+	}
+
+	template <typename U>
+	bool TryEmplace(U&& value)
+	{
+		if (m_shutDown.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			auto& slot = m_slots[pos & m_mask];
+			const auto sequence = slot.sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(sequence - pos);
+			if (diff == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					std::construct_at(slot.Get(), std::forward<U>(value));
+					slot.sequence.store(pos + 1, std::memory_order_release);
+					Notify(m_notEmpty);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	std::optional<T> DoTryPop()
+	{
+		auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			auto& slot = m_slots[pos & m_mask];
+			const auto sequence = slot.sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(sequence - (pos + 1));
+			if (diff == 0)
+			{
+				if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					std::optional<T> out(std::move(*slot.Get()));
+					std::destroy_at(slot.Get());
+					slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+					Notify(m_notFull);
+					return out;
+				}
+			}
+			else if (diff < 0)
+			{
+				return std::nullopt;
+			}
+			else
+			{
+				pos = m_dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	static void Notify(WaitPoint& waitPoint)
+	{
+		// Пара барьеров с WaitFor: либо ждущий увидит новый элемент, либо мы увидим ждущего
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waitPoint.waiters.load(std::memory_order_relaxed) == 0)
+		{
+			return;
+		}
+		// Нечётная эпоха — пробуждение уже отправлено, а разбуженный поток ещё не проверил очередь.
+		// Повторно будить незачем: он увидит и этот элемент и, если элементов больше одного, разбудит следующего
+		auto epoch = waitPoint.epoch.load(std::memory_order_relaxed);
+		if ((epoch & 1) == 0 && waitPoint.epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel))
+		{
+			waitPoint.epoch.notify_one();
+		}
+	}
+
+	// Забирает отправленное пробуждение и возвращает чётную эпоху, на которой можно засыпать
+	static uint32_t ConsumeWakeup(WaitPoint& waitPoint, bool& isConsumed)
+	{
+		auto epoch = waitPoint.epoch.load(std::memory_order_acquire);
+		for (;;)
+		{
+			if ((epoch & 1) == 0)
+			{
+				return epoch;
+			}
+			if (waitPoint.epoch.compare_exchange_weak(epoch, epoch + 1, std::memory_order_acq_rel))
+			{
+				isConsumed = true;
+				return epoch + 1;
+			}
+		}
+	}
+
+	// Есть ли ещё элементы для ждущих потребителей или место для ждущих производителей
+	bool HasWorkFor(const WaitPoint& waitPoint) const
+	{
+		return &waitPoint == &m_notEmpty ? !IsEmpty() : GetSize() < GetCapacity();
+	}
+
+	// false, если операция не удалась, а очередь остановлена
+	template <typename TryOperation>
+	bool WaitFor(WaitPoint& waitPoint, TryOperation&& tryOperation)
+	{
+		// Первая попытка — без записи в ждущие, иначе поток, который разбирает очередь подряд, на каждом элементе
+		// забирал бы переданное ему же пробуждение и передавал его снова
+		if (tryOperation())
+		{
+			return true;
+		}
+		// На одном ядре ожидание вращением только отнимает время у потока, который освободит очередь
+		static const int spinCount = std::thread::hardware_concurrency() > 1 ? SPIN_COUNT : 0;
+		for (int i = 0; i < spinCount; ++i)
+		{
+			CpuRelax();
+			if (tryOperation())
+			{
+				return true;
+			}
+		}
+
+		auto isWakeupConsumed = false;
+		for (;;)
+		{
+			waitPoint.waiters.fetch_add(1, std::memory_order_relaxed);
+			const auto epoch = ConsumeWakeup(waitPoint, isWakeupConsumed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			const auto done = tryOperation();
+			if (done || m_shutDown.load(std::memory_order_acquire))
+			{
+				waitPoint.waiters.fetch_sub(1, std::memory_order_relaxed);
+				// Элементы или места, появившиеся, пока пробуждение было у нас, никого не разбудили
+				if (done && isWakeupConsumed && HasWorkFor(waitPoint))
+				{
+					Notify(waitPoint);
+				}
+				return done;
+			}
+
+			waitPoint.epoch.wait(epoch, std::memory_order_acquire);
+			waitPoint.waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	const size_t m_mask;
+	std::vector<Slot> m_slots;
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueuePos{ 0 };
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeuePos{ 0 };
+	WaitPoint m_notEmpty;
+	WaitPoint m_notFull;
+	std::atomic<bool> m_shutDown{ false };
+};
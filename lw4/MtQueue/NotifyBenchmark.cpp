@@ -1,7 +1,11 @@
 #include "MtQueue.h"
+#include "MtRingQueue.h"
+#include <algorithm>
 #include <atomic>
 #include <catch2/catch_all.hpp>
+#include <chrono>
 #include <iostream>
+#include <numeric>
 #include <thread>
 #include <vector>
 
@@ -31,7 +35,11 @@ TEST_CASE("WaitAndPop notification benchmark")
 			consumers.emplace_back([&] {
 				while (!stop)
 				{
-					int value = emptyQueue.WaitAndPop();
+					int value = 0;
+					if (!emptyQueue.WaitAndPop(value))
+					{
+						break;
+					}
 					consumedCount.fetch_add(1);
 				}
 			});
@@ -74,7 +82,11 @@ TEST_CASE("WaitAndPop notification benchmark")
 			consumers.emplace_back([&] {
 				while (!stop)
 				{
-					int value = emptyQueue.WaitAndPop();
+					int value = 0;
+					if (!emptyQueue.WaitAndPop(value))
+					{
+						break;
+					}
 					consumedCount.fetch_add(1);
 				}
 			});
@@ -112,7 +124,11 @@ TEST_CASE("WaitAndPop notification benchmark")
 			consumers.emplace_back([&] {
 				while (!stop)
 				{
-					int value = emptyQueue.WaitAndPop();
+					int value = 0;
+					if (!emptyQueue.WaitAndPop(value))
+					{
+						break;
+					}
 					consumedCount.fetch_add(1);
 				}
 			});
@@ -150,7 +166,11 @@ TEST_CASE("WaitAndPop notification benchmark")
 			consumers.emplace_back([&] {
 				while (!stop)
 				{
-					int value = emptyQueue.WaitAndPop();
+					int value = 0;
+					if (!emptyQueue.WaitAndPop(value))
+					{
+						break;
+					}
 					consumedCount.fetch_add(1);
 				}
 			});
@@ -168,4 +188,175 @@ TEST_CASE("WaitAndPop notification benchmark")
 
 		return consumedCount.load();
 	};
-}
\ No newline at end of file
+}
+namespace
+{
+// Производители кладут поровну элементов, каждый потребитель забирает свою долю через WaitAndPop
+template <typename Queue>
+long long RunProducersConsumers(Queue& queue, const int producers, const int consumers, const int elements)
+{
+	std::atomic<long long> sum{ 0 };
+	std::vector<std::jthread> threads;
+	for (int i = 0; i < producers; ++i)
+	{
+		threads.emplace_back([&] {
+			for (int j = 0; j < elements / producers; ++j)
+			{
+				queue.Push(j);
+			}
+		});
+	}
+	for (int i = 0; i < consumers; ++i)
+	{
+		threads.emplace_back([&] {
+			long long localSum = 0;
+			for (int j = 0; j < elements / consumers; ++j)
+			{
+				localSum += queue.WaitAndPop();
+			}
+			sum.fetch_add(localSum);
+		});
+	}
+	threads.clear();
+	return sum.load();
+}
+} // namespace
+
+TEST_CASE("MtQueue vs MtRingQueue throughput")
+{
+	constexpr int CAPACITY = 1024;
+	constexpr int ELEMENTS = 240000;
+
+	for (const auto& [producers, consumers] : { std::pair{ 1, 1 }, std::pair{ 2, 2 }, std::pair{ 4, 4 }, std::pair{ 1, 4 }, std::pair{ 4, 1 } })
+	{
+		const auto suffix = " - " + std::to_string(producers) + " producers, " + std::to_string(consumers) + " consumers";
+
+		BENCHMARK("MtQueue" + suffix)
+		{
+			MtQueue<int> queue(CAPACITY);
+			return RunProducersConsumers(queue, producers, consumers, ELEMENTS);
+		};
+
+		BENCHMARK("MtRingQueue" + suffix)
+		{
+			MtRingQueue<int> queue(CAPACITY);
+			return RunProducersConsumers(queue, producers, consumers, ELEMENTS);
+		};
+	}
+}
+
+TEST_CASE("MtQueue batch size benchmark")
+{
+	constexpr int CAPACITY = 1024;
+	constexpr int PRODUCERS = 2;
+	constexpr int CONSUMERS = 2;
+	constexpr int ELEMENTS = 240000;
+
+	for (const size_t batchSize : { 1, 4, 16, 64, 256 })
+	{
+		BENCHMARK("PushRange / WaitAndPopBulk - batch " + std::to_string(batchSize))
+		{
+			MtQueue<int> queue(CAPACITY);
+			std::atomic consumedCount{ 0 };
+			std::atomic<long long> sum{ 0 };
+
+			std::vector<std::jthread> threads;
+			for (int i = 0; i < PRODUCERS; ++i)
+			{
+				threads.emplace_back([&] {
+					std::vector<int> batch(batchSize);
+					for (int j = 0; j < ELEMENTS / PRODUCERS; j += static_cast<int>(batchSize))
+					{
+						const auto count = std::min<size_t>(batchSize, ELEMENTS / PRODUCERS - j);
+						std::iota(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(count), j);
+						queue.PushRange(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(count));
+					}
+				});
+			}
+			for (int i = 0; i < CONSUMERS; ++i)
+			{
+				threads.emplace_back([&] {
+					std::vector<int> batch(batchSize);
+					long long localSum = 0;
+					while (consumedCount.load() < ELEMENTS)
+					{
+						const auto count = queue.WaitAndPopBulk(batch.begin(), batchSize, std::chrono::milliseconds(10));
+						localSum = std::accumulate(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(count), localSum);
+						consumedCount.fetch_add(static_cast<int>(count));
+					}
+					sum.fetch_add(localSum);
+				});
+			}
+			threads.clear();
+			return sum.load();
+		};
+	}
+}
+
+namespace
+{
+// Производитель шлёт пачки с паузами, потребитель замеряет задержку от Push до получения элемента
+template <typename PopWithDeadline>
+std::chrono::nanoseconds MeasureBurstP99Latency(PopWithDeadline&& popWithDeadline)
+{
+	using Clock = std::chrono::steady_clock;
+	constexpr int BURSTS = 50;
+	constexpr int BURST_SIZE = 20;
+
+	MtQueue<Clock::time_point> queue;
+	std::jthread producer([&] {
+		for (int i = 0; i < BURSTS; ++i)
+		{
+			for (int j = 0; j < BURST_SIZE; ++j)
+			{
+				queue.Push(Clock::now());
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+	});
+
+	std::vector<std::chrono::nanoseconds> latencies;
+	Clock::time_point pushedAt;
+	while (latencies.size() < BURSTS * BURST_SIZE)
+	{
+		if (popWithDeadline(queue, pushedAt, std::chrono::milliseconds(100)))
+		{
+			latencies.push_back(Clock::now() - pushedAt);
+		}
+	}
+	std::ranges::sort(latencies);
+	return latencies[latencies.size() * 99 / 100];
+}
+} // namespace
+
+TEST_CASE("Deadline wait vs polling under bursty load")
+{
+	using Clock = std::chrono::steady_clock;
+
+	BENCHMARK("TryPop polling with sleep")
+	{
+		const auto p99 = MeasureBurstP99Latency([](auto& queue, Clock::time_point& out, const auto timeout) {
+			const auto deadline = Clock::now() + timeout;
+			while (Clock::now() < deadline)
+			{
+				if (queue.TryPop(out))
+				{
+					return true;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			return false;
+		});
+		std::cout << "p99: " << std::chrono::duration_cast<std::chrono::microseconds>(p99).count() << " us" << std::endl;
+		return p99;
+	};
+
+	BENCHMARK("WaitAndPopFor")
+	{
+		const auto p99 = MeasureBurstP99Latency([](auto& queue, Clock::time_point& out, const auto timeout) {
+			return queue.WaitAndPopFor(out, timeout);
+		});
+		std::cout << "p99: " << std::chrono::duration_cast<std::chrono::microseconds>(p99).count() << " us" << std::endl;
+		return p99;
+	};
+}
@@ -0,0 +1,127 @@
+#include "MtPriorityQueue.h"
+#include "MtQueue.h"
+#include <algorithm>
+#include <array>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t CAPACITY = 256;
+constexpr int URGENT_JOBS = 500;
+constexpr int CONSUMERS = 2;
+
+struct Job
+{
+	bool urgent = false;
+	Clock::time_point pushedAt;
+};
+
+struct UrgentFirst
+{
+	bool operator()(const Job& lhs, const Job& rhs) const
+	{
+		return !lhs.urgent && rhs.urgent;
+	}
+};
+
+struct JobLane
+{
+	size_t operator()(const Job& job) const
+	{
+		return job.urgent ? 0 : 1;
+	}
+};
+
+void SimulateWork()
+{
+	const auto until = Clock::now() + std::chrono::microseconds(20);
+	while (Clock::now() < until)
+	{
+	}
+}
+
+// Фоновый производитель держит очередь заполненной, срочные задачи приходят редко.
+// Замеряется время от Push срочной задачи до того, как её взял потребитель
+template <typename Queue>
+std::chrono::nanoseconds MeasureUrgentP99Wait(Queue& queue)
+{
+	std::vector<std::chrono::nanoseconds> waits;
+	std::mutex waitsMutex;
+
+	std::vector<std::jthread> consumers;
+	for (int i = 0; i < CONSUMERS; ++i)
+	{
+		consumers.emplace_back([&] {
+			Job job;
+			while (queue.WaitAndPop(job))
+			{
+				if (job.urgent)
+				{
+					const auto wait = Clock::now() - job.pushedAt;
+					std::lock_guard lock(waitsMutex);
+					waits.push_back(wait);
+				}
+				SimulateWork();
+			}
+		});
+	}
+
+	std::jthread bulkProducer([&](const std::stop_token& stopToken) {
+		while (queue.Push(Job{ false, Clock::now() }, stopToken))
+		{
+		}
+	});
+
+	for (int i = 0; i < URGENT_JOBS; ++i)
+	{
+		queue.Push(Job{ true, Clock::now() });
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+	bulkProducer.request_stop();
+	bulkProducer.join();
+	queue.Shutdown(ShutdownMode::Drain);
+	consumers.clear();
+
+	std::ranges::sort(waits);
+	return waits[waits.size() * 99 / 100];
+}
+
+void PrintP99(const std::chrono::nanoseconds p99)
+{
+	std::cout << "urgent p99 wait: " << std::chrono::duration_cast<std::chrono::microseconds>(p99).count() << " us" << std::endl;
+}
+} // namespace
+
+TEST_CASE("Urgent job wait under saturation")
+{
+	BENCHMARK("MtQueue - FIFO")
+	{
+		MtQueue<Job> queue(CAPACITY);
+		const auto p99 = MeasureUrgentP99Wait(queue);
+		PrintP99(p99);
+		return p99;
+	};
+
+	BENCHMARK("MtPriorityQueue - 4-ary heap")
+	{
+		MtPriorityQueue<Job, UrgentFirst> queue(CAPACITY);
+		const auto p99 = MeasureUrgentP99Wait(queue);
+		PrintP99(p99);
+		return p99;
+	};
+
+	BENCHMARK("MtPriorityQueue - weighted lanes 8:1")
+	{
+		MtPriorityQueue<Job, WeightedLanes<2, JobLane>> queue(CAPACITY, { 8, 1 });
+		const auto p99 = MeasureUrgentP99Wait(queue);
+		PrintP99(p99);
+		return p99;
+	};
+}
@@ -0,0 +1,102 @@
+#include "MtQueue.h"
+#include "MtRingQueue.h"
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+constexpr int ELEMENTS = 10000000;
+constexpr size_t CAPACITY = 1024;
+
+template <typename Queue>
+long long RunBlocking(Queue& queue)
+{
+	std::jthread producer([&] {
+		for (int i = 0; i < ELEMENTS; ++i)
+		{
+			queue.Push(i);
+		}
+	});
+
+	long long sum = 0;
+	for (int i = 0; i < ELEMENTS; ++i)
+	{
+		sum += queue.WaitAndPop();
+	}
+	return sum;
+}
+
+// Без засыпания: обе стороны крутятся на TryPush/TryPop и уступают процессор, если очередь полна или пуста
+template <typename Queue>
+long long RunNonBlocking(Queue& queue)
+{
+	std::jthread producer([&] {
+		for (int i = 0; i < ELEMENTS; ++i)
+		{
+			while (!queue.TryPush(i))
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	long long sum = 0;
+	int value = 0;
+	for (int i = 0; i < ELEMENTS; ++i)
+	{
+		while (!queue.TryPop(value))
+		{
+			std::this_thread::yield();
+		}
+		sum += value;
+	}
+	return sum;
+}
+
+template <typename Run>
+long long MeasureOpsPerSecond(const std::string& name, Run&& run)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const auto sum = run();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << name << ": " << static_cast<long long>(ELEMENTS / elapsed.count()) << " ops/s" << std::endl;
+	return sum;
+}
+} // namespace
+
+TEST_CASE("Single producer single consumer benchmark")
+{
+	BENCHMARK("MtQueue")
+	{
+		MtQueue<int> queue(CAPACITY);
+		return MeasureOpsPerSecond("MtQueue", [&] {
+			return RunBlocking(queue);
+		});
+	};
+
+	BENCHMARK("MtRingQueue")
+	{
+		MtRingQueue<int> queue(CAPACITY);
+		return MeasureOpsPerSecond("MtRingQueue", [&] {
+			return RunBlocking(queue);
+		});
+	};
+
+	BENCHMARK("MtQueue<SpscPolicy> - blocking")
+	{
+		MtQueue<int, SpscPolicy<CAPACITY>> queue;
+		return MeasureOpsPerSecond("MtQueue<SpscPolicy> - blocking", [&] {
+			return RunBlocking(queue);
+		});
+	};
+
+	BENCHMARK("MtQueue<SpscPolicy> - non-blocking")
+	{
+		MtQueue<int, SpscPolicy<CAPACITY, false>> queue;
+		return MeasureOpsPerSecond("MtQueue<SpscPolicy> - non-blocking", [&] {
+			return RunNonBlocking(queue);
+		});
+	};
+}
@@ -0,0 +1,297 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Очередь ровно для одного производителя и одного потребителя на непрерывном кольце.
+// Каждая сторона пишет только свой индекс и держит кэшированную копию чужого, поэтому чужая
+// кэш-линия читается, лишь когда кольцо по кэшу выглядит полным или пустым.
+// Blocking добавляет Push/WaitAndPop с засыпанием на atomic::wait; без него операции не ждут и не будят
+template <typename T, size_t Capacity, bool Blocking = true>
+class SpscQueue
+{
+	static_assert(Capacity >= 2 && std::has_single_bit(Capacity), "SpscQueue capacity must be a power of two");
+	static_assert(std::is_nothrow_move_constructible_v<T>, "SpscQueue requires T to be nothrow move constructible");
+
+public:
+	SpscQueue()
+		: m_slots(std::make_unique<Slot[]>(Capacity))
+	{
+	}
+
+	~SpscQueue()
+	{
+		const auto tail = m_tail.load(std::memory_order_relaxed);
+		for (auto head = m_head.load(std::memory_order_relaxed); head != tail; ++head)
+		{
+			std::destroy_at(m_slots[head & MASK].Get());
+		}
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Ждёт свободного места; после Shutdown бросает исключение, в том числе производителю, который ждал места
+	void Push(const T& value)
+		requires Blocking
+	{
+		T item(value);
+		Push(std::move(item));
+	}
+
+	void Push(T&& value)
+		requires Blocking
+	{
+		if (!WaitFor(m_notFull, m_producerWaiting, [&] {
+				return TryEmplace(std::move(value));
+			}))
+		{
+			throw std::runtime_error("Queue is shut down");
+		}
+	}
+
+	// false, если очередь полна или остановлена
+	[[nodiscard]] bool TryPush(const T& value)
+	{
+		if (IsShutDown() || IsFullForProducer())
+		{
+			return false;
+		}
+		T item(value);
+		return TryEmplace(std::move(item));
+	}
+
+	[[nodiscard]] bool TryPush(T&& value)
+	{
+		return TryEmplace(std::move(value));
+	}
+
+	bool TryPop(T& out)
+	{
+		auto value = DoTryPop();
+		if (!value)
+		{
+			return false;
+		}
+		out = std::move(*value);
+		return true;
+	}
+
+	std::unique_ptr<T> TryPop()
+	{
+		auto value = DoTryPop();
+		if (!value)
+		{
+			return nullptr;
+		}
+		return std::make_unique<T>(std::move(*value));
+	}
+
+	// После Shutdown оставшиеся элементы ещё выдаются, а из пустой очереди — исключение
+	T WaitAndPop()
+		requires Blocking
+	{
+		std::optional<T> value;
+		if (!WaitFor(m_notEmpty, m_consumerWaiting, [&] {
+				value = DoTryPop();
+				return value.has_value();
+			}))
+		{
+			throw std::runtime_error("Queue is shut down");
+		}
+		return std::move(*value);
+	}
+
+	// false, если очередь остановлена и пуста
+	bool WaitAndPop(T& out)
+		requires Blocking
+	{
+		std::optional<T> value;
+		if (!WaitFor(m_notEmpty, m_consumerWaiting, [&] {
+				value = DoTryPop();
+				return value.has_value();
+			}))
+		{
+			return false;
+		}
+		out = std::move(*value);
+		return true;
+	}
+
+	size_t GetSize() const
+	{
+		const auto head = m_head.load(std::memory_order_acquire);
+		const auto tail = m_tail.load(std::memory_order_acquire);
+		return tail > head ? tail - head : 0;
+	}
+
+	[[nodiscard]] bool IsEmpty() const
+	{
+		return GetSize() == 0;
+	}
+
+	static constexpr size_t GetCapacity()
+	{
+		return Capacity;
+	}
+
+	// Новые элементы больше не принимаются, оставшиеся ещё выдаются, ждущие стороны просыпаются
+	void Shutdown()
+	{
+		m_shutDown.store(true, std::memory_order_release);
+		if constexpr (Blocking)
+		{
+			for (auto* epoch : { &m_notEmpty, &m_notFull })
+			{
+				epoch->fetch_add(1, std::memory_order_release);
+				epoch->notify_all();
+			}
+		}
+	}
+
+private:
+	static constexpr size_t CACHE_LINE_SIZE = 64;
+	static constexpr size_t MASK = Capacity - 1;
+	static constexpr int SPIN_COUNT = 256;
+
+	struct Slot
+	{
+		alignas(T) unsigned char storage[sizeof(T)];
+
+		T* Get()
+		{
+			return std::launder(reinterpret_cast<T*>(storage));
+		}
+	};
+
+	static void CpuRelax()
+	{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	bool IsFullForProducer()
+	{
+		const auto tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_cachedHead < Capacity)
+		{
+			return false;
+		}
+		m_cachedHead = m_head.load(std::memory_order_acquire);
+		return tail - m_cachedHead == Capacity;
+	}
+
+	bool IsShutDown() const
+	{
+		return m_shutDown.load(std::memory_order_acquire);
+	}
+
+	bool TryEmplace(T&& value)
+	{
+		if (IsShutDown() || IsFullForProducer())
+		{
+			return false;
+		}
+		const auto tail = m_tail.load(std::memory_order_relaxed);
+		std::construct_at(m_slots[tail & MASK].Get(), std::move(value));
+		m_tail.store(tail + 1, std::memory_order_release);
+		Notify(m_notEmpty, m_consumerWaiting);
+		return true;
+	}
+
+	std::optional<T> DoTryPop()
+	{
+		const auto head = m_head.load(std::memory_order_relaxed);
+		if (head == m_cachedTail)
+		{
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head == m_cachedTail)
+			{
+				return std::nullopt;
+			}
+		}
+
+		auto* item = m_slots[head & MASK].Get();
+		std::optional<T> out(std::move(*item));
+		std::destroy_at(item);
+		m_head.store(head + 1, std::memory_order_release);
+		Notify(m_notFull, m_producerWaiting);
+		return out;
+	}
+
+	// С каждой стороны ждёт не больше одного потока, поэтому достаточно флага ожидания и счётчика пробуждений
+	static void Notify(std::atomic<uint32_t>& epoch, std::atomic<bool>& waiting)
+	{
+		if constexpr (Blocking)
+		{
+			// Пара барьеров с WaitFor: либо ждущий увидит изменение индекса, либо мы увидим флаг
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (waiting.load(std::memory_order_relaxed))
+			{
+				waiting.store(false, std::memory_order_relaxed);
+				epoch.fetch_add(1, std::memory_order_release);
+				epoch.notify_one();
+			}
+		}
+	}
+
+	// false, если операция не удалась, а очередь остановлена
+	template <typename TryOperation>
+	bool WaitFor(std::atomic<uint32_t>& epoch, std::atomic<bool>& waiting, TryOperation&& tryOperation)
+	{
+		// На одном ядре ожидание вращением только отнимает время у второй стороны
+		static const int spinCount = std::thread::hardware_concurrency() > 1 ? SPIN_COUNT : 0;
+		for (int i = 0; i < spinCount; ++i)
+		{
+			if (tryOperation())
+			{
+				return true;
+			}
+			CpuRelax();
+		}
+
+		for (;;)
+		{
+			const auto currentEpoch = epoch.load(std::memory_order_acquire);
+			waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			const auto done = tryOperation();
+			if (done || m_shutDown.load(std::memory_order_acquire))
+			{
+				waiting.store(false, std::memory_order_relaxed);
+				return done;
+			}
+			epoch.wait(currentEpoch, std::memory_order_acquire);
+		}
+	}
+
+	std::unique_ptr<Slot[]> m_slots;
+
+	// Линия потребителя: его индекс и кэш индекса производителя
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{ 0 };
+	size_t m_cachedTail = 0;
+
+	// Линия производителя
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{ 0 };
+	size_t m_cachedHead = 0;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_notEmpty{ 0 };
+	std::atomic<bool> m_consumerWaiting{ false };
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_notFull{ 0 };
+	std::atomic<bool> m_producerWaiting{ false };
+	std::atomic<bool> m_shutDown{ false };
+};
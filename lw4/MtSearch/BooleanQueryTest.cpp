@@ -0,0 +1,208 @@
+#include "Index/IndexSnapshot.h"
+#include "Query/BooleanMatcher.h"
+#include <algorithm>
+#include <catch2/catch_all.hpp>
+#include <random>
+#include <set>
+#include <string>
+
+namespace
+{
+constexpr uint32_t DOCS_COUNT = 3000;
+constexpr uint32_t VOCABULARY_SIZE = 30;
+
+using Docs = std::vector<std::set<std::string>>;
+
+std::string GetWord(const uint32_t index)
+{
+	return "w" + std::to_string(index);
+}
+
+std::shared_ptr<Segment> BuildSegment(std::mt19937& random, Docs& docs)
+{
+	Segment::Builder builder;
+	for (uint32_t docId = 0; docId < DOCS_COUNT; ++docId)
+	{
+		std::vector<std::string> words;
+		std::vector<TermCounter::Entry> entries;
+		const auto termsCount = 1 + random() % 8;
+		for (uint32_t i = 0; i < termsCount; ++i)
+		{
+			// Перекос к младшим словам даёт и частые, и редкие списки
+			words.push_back(GetWord(random() % VOCABULARY_SIZE * (random() % VOCABULARY_SIZE) / VOCABULARY_SIZE));
+		}
+		std::ranges::sort(words);
+		words.erase(std::ranges::unique(words).begin(), words.end());
+		for (const auto& word : words)
+		{
+			entries.push_back({ word, 1 + static_cast<uint32_t>(random() % 3), {} });
+		}
+		docs.emplace_back(words.begin(), words.end());
+		builder.AddDocument("doc" + std::to_string(docId), entries, 10, FileState{});
+	}
+	return builder.Build();
+}
+
+std::string MakeRandomQuery(std::mt19937& random, const int depth)
+{
+	const auto kind = depth == 0 ? 0 : random() % 4;
+	if (kind == 0)
+	{
+		// Изредка слово, которого нет в индексе
+		return random() % 10 == 0 ? "missing" : GetWord(random() % VOCABULARY_SIZE);
+	}
+	if (kind == 1)
+	{
+		return "NOT " + MakeRandomQuery(random, depth - 1);
+	}
+	const auto left = MakeRandomQuery(random, depth - 1);
+	const auto right = MakeRandomQuery(random, depth - 1);
+	if (kind == 2)
+	{
+		return "(" + left + (random() % 2 == 0 ? " AND " : " ") + right + ")";
+	}
+	return "(" + left + " OR " + right + ")";
+}
+
+bool Evaluate(const BooleanQuery& query, const size_t node, const std::set<std::string>& words)
+{
+	const auto& current = query.GetNodes()[node];
+	switch (current.type)
+	{
+	case BooleanQuery::NodeType::Term:
+		return words.contains(query.GetTerms()[current.termIndex]);
+	case BooleanQuery::NodeType::Not:
+		return !Evaluate(query, current.children.front(), words);
+	case BooleanQuery::NodeType::And:
+		return std::ranges::all_of(current.children, [&](const size_t child) {
+			return Evaluate(query, child, words);
+		});
+	case BooleanQuery::NodeType::Or:
+		return std::ranges::any_of(current.children, [&](const size_t child) {
+			return Evaluate(query, child, words);
+		});
+	}
+	return false;
+}
+
+std::vector<uint32_t> Match(
+	const IndexSnapshot::SegmentView& view,
+	const BooleanQuery& query,
+	const uint32_t firstDocId,
+	const uint32_t lastDocId)
+{
+	std::vector<std::optional<uint32_t>> termOrdinals;
+	for (const auto& term : query.GetTerms())
+	{
+		termOrdinals.push_back(view.segment->FindTerm(term));
+	}
+
+	std::vector<uint32_t> result;
+	BooleanMatcher matcher(view, query, termOrdinals);
+	matcher.ForEachMatch(firstDocId, lastDocId, [&](const uint32_t localDocId, std::span<const uint32_t>) {
+		result.push_back(localDocId);
+	});
+	return result;
+}
+} // namespace
+
+TEST_CASE("Boolean query parsing")
+{
+	SECTION("Precedence and implicit AND")
+	{
+		const auto query = BooleanQuery::Parse("Deal lead OR NOT qualify");
+		const auto& nodes = query.GetNodes();
+		REQUIRE(query.GetTerms() == std::vector<std::string>{ "deal", "lead", "qualify" });
+
+		const auto& root = nodes[query.GetRoot()];
+		REQUIRE(root.type == BooleanQuery::NodeType::Or);
+		REQUIRE(root.children.size() == 2);
+		REQUIRE(nodes[root.children[0]].type == BooleanQuery::NodeType::And);
+		REQUIRE(nodes[root.children[1]].type == BooleanQuery::NodeType::Not);
+	}
+
+	SECTION("Grouping and repeated words")
+	{
+		const auto query = BooleanQuery::Parse("(deal OR lead)AND(deal)");
+		REQUIRE(query.GetTerms().size() == 2);
+		REQUIRE(query.GetNodes()[query.GetRoot()].type == BooleanQuery::NodeType::And);
+	}
+
+	SECTION("Lowercase operators are words")
+	{
+		const auto query = BooleanQuery::Parse("cats and dogs");
+		REQUIRE(query.GetTerms() == std::vector<std::string>{ "cats", "and", "dogs" });
+	}
+
+	SECTION("Malformed queries")
+	{
+		REQUIRE_THROWS(BooleanQuery::Parse(""));
+		REQUIRE_THROWS(BooleanQuery::Parse("deal AND"));
+		REQUIRE_THROWS(BooleanQuery::Parse("OR deal"));
+		REQUIRE_THROWS(BooleanQuery::Parse("(deal lead"));
+		REQUIRE_THROWS(BooleanQuery::Parse("deal)"));
+		REQUIRE_THROWS(BooleanQuery::Parse("NOT"));
+	}
+}
+
+TEST_CASE("Boolean matching matches reference evaluation")
+{
+	std::mt19937 random(5);
+	Docs docs;
+	const auto segment = BuildSegment(random, docs);
+
+	auto deletes = std::make_shared<SegmentDeletes>();
+	deletes->docs.assign(DOCS_COUNT, false);
+	for (uint32_t docId = 1; docId < DOCS_COUNT; docId += 5)
+	{
+		deletes->docs[docId] = true;
+		++deletes->count;
+	}
+
+	for (const auto hasDeletes : { false, true })
+	{
+		const IndexSnapshot::SegmentView view{ segment, hasDeletes ? deletes : nullptr };
+		for (int i = 0; i < 300; ++i)
+		{
+			const auto query = BooleanQuery::Parse(MakeRandomQuery(random, 1 + i % 4));
+			const auto firstDocId = i % 2 == 0 ? 0 : static_cast<uint32_t>(random() % DOCS_COUNT);
+			const auto lastDocId = i % 2 == 0 ? DOCS_COUNT : static_cast<uint32_t>(firstDocId + random() % (DOCS_COUNT - firstDocId + 1));
+
+			std::vector<uint32_t> expected;
+			for (auto docId = firstDocId; docId < lastDocId; ++docId)
+			{
+				if (!view.IsDeleted(docId) && Evaluate(query, query.GetRoot(), docs[docId]))
+				{
+					expected.push_back(docId);
+				}
+			}
+			REQUIRE(Match(view, query, firstDocId, lastDocId) == expected);
+		}
+	}
+}
+
+TEST_CASE("Boolean matching reports counts of matched terms only")
+{
+	std::mt19937 random(9);
+	Docs docs;
+	const auto segment = BuildSegment(random, docs);
+	const IndexSnapshot::SegmentView view{ segment, nullptr };
+
+	const auto query = BooleanQuery::Parse("w0 OR (w1 NOT w2)");
+	std::vector<std::optional<uint32_t>> termOrdinals;
+	for (const auto& term : query.GetTerms())
+	{
+		termOrdinals.push_back(segment->FindTerm(term));
+	}
+
+	size_t matchesCount = 0;
+	BooleanMatcher matcher(view, query, termOrdinals);
+	matcher.ForEachMatch(0, DOCS_COUNT, [&](const uint32_t localDocId, const std::span<const uint32_t> termCounts) {
+		const auto& words = docs[localDocId];
+		REQUIRE((termCounts[0] > 0) == words.contains("w0"));
+		REQUIRE((termCounts[1] > 0) == (words.contains("w1") && !words.contains("w2")));
+		REQUIRE(termCounts[2] == 0);
+		++matchesCount;
+	});
+	REQUIRE(matchesCount > 0);
+}
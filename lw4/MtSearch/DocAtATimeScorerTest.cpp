@@ -0,0 +1,215 @@
+#include "Index/IndexSnapshot.h"
+#include "Query/DocAtATimeScorer.h"
+#include <algorithm>
+#include <catch2/catch_all.hpp>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace
+{
+constexpr size_t TOP = 10;
+constexpr uint32_t DOCS_COUNT = 3000;
+constexpr uint32_t VOCABULARY_SIZE = 200;
+
+std::shared_ptr<Segment> BuildSegment(std::mt19937& random)
+{
+	std::vector<std::string> vocabulary;
+	for (uint32_t i = 0; i < VOCABULARY_SIZE; ++i)
+	{
+		vocabulary.push_back("term" + std::to_string(i));
+	}
+
+	Segment::Builder builder;
+	for (uint32_t docId = 0; docId < DOCS_COUNT; ++docId)
+	{
+		std::vector<TermCounter::Entry> entries;
+		uint32_t length = 0;
+		const auto termsCount = 1 + random() % 12;
+		for (uint32_t i = 0; i < termsCount; ++i)
+		{
+			// Квадрат даёт перекос к частым терминам, как в реальных текстах
+			const auto rank = random() % VOCABULARY_SIZE * (random() % VOCABULARY_SIZE) / VOCABULARY_SIZE;
+			const std::string_view term = vocabulary[rank];
+			if (std::ranges::find(entries, term, &TermCounter::Entry::term) != entries.end())
+			{
+				continue;
+			}
+			const auto count = 1 + static_cast<uint32_t>(random() % 5);
+			entries.push_back({ term, count, {} });
+			length += count;
+		}
+		length += random() % 20;
+		builder.AddDocument("doc" + std::to_string(docId), entries, length, FileState{});
+	}
+
+	auto segment = builder.Build();
+	segment->AssignGlobalDocIds(1000);
+	return segment;
+}
+
+double GetAverageDocLength(const Segment& segment)
+{
+	return static_cast<double>(segment.GetTotalDocLength()) / static_cast<double>(segment.GetDocsCount());
+}
+
+std::vector<float> MakeLengthNorms(const Segment& segment)
+{
+	std::vector<float> norms;
+	for (const auto docLength : segment.GetDocLengths())
+	{
+		norms.push_back(ScoreFunction::GetBm25LengthNorm(docLength, GetAverageDocLength(segment)));
+	}
+	return norms;
+}
+
+std::vector<DocAtATimeScorer::Term> MakeTerms(
+	const Segment& segment,
+	const ScoringModel model,
+	const std::vector<uint32_t>& termOrdinals)
+{
+	std::vector<DocAtATimeScorer::Term> terms;
+	for (size_t i = 0; i < termOrdinals.size(); ++i)
+	{
+		const auto termOrdinal = termOrdinals[i];
+		terms.push_back({ i,
+			ScoreFunction::GetIdf(model, DOCS_COUNT, segment.GetPostings(termOrdinal).GetSize()),
+			segment.GetPostings(termOrdinal),
+			segment.GetMaxTermFrequency(termOrdinal),
+			segment.GetBlockMaxTermFrequencies(termOrdinal) });
+	}
+	return terms;
+}
+
+DocAtATimeScorer::ScoredDocs ScoreExhaustive(
+	const IndexSnapshot::SegmentView& view,
+	const ScoreFunction& scoreFunction,
+	const std::vector<DocAtATimeScorer::Term>& terms,
+	const uint32_t firstDocId,
+	const uint32_t lastDocId)
+{
+	std::vector<double> scores(DOCS_COUNT, 0.0);
+	std::vector<bool> isMatched(DOCS_COUNT, false);
+	for (const auto& term : terms)
+	{
+		term.postings.ForEach([&](const uint64_t docId, const uint32_t termCount) {
+			scores[docId] += scoreFunction.GetContribution(termCount, static_cast<uint32_t>(docId), term.idf);
+			isMatched[docId] = true;
+		});
+	}
+
+	DocAtATimeScorer::ScoredDocs result;
+	for (auto docId = firstDocId; docId < lastDocId; ++docId)
+	{
+		if (isMatched[docId] && !view.IsDeleted(docId))
+		{
+			result.emplace_back(view.segment->GetGlobalDocId(docId), scores[docId]);
+		}
+	}
+	std::ranges::sort(result, IsMoreRelevant);
+	result.resize(std::min(result.size(), TOP));
+	return result;
+}
+
+DocAtATimeScorer::ScoredDocs Score(
+	const IndexSnapshot::SegmentView& view,
+	const ScoreFunction& scoreFunction,
+	const std::vector<DocAtATimeScorer::Term>& terms,
+	const uint32_t firstDocId,
+	const uint32_t lastDocId,
+	const QueryAlgorithm algorithm)
+{
+	std::atomic<double> threshold = -std::numeric_limits<double>::infinity();
+	DocAtATimeScorer scorer(view, scoreFunction, terms.size(), TOP, threshold);
+	auto result = scorer.Score(terms, firstDocId, lastDocId, algorithm);
+	std::ranges::sort(result, IsMoreRelevant);
+	return result;
+}
+} // namespace
+
+TEST_CASE("Top-k pruning matches exhaustive scoring")
+{
+	std::mt19937 random(42);
+	const auto segment = BuildSegment(random);
+
+	auto deletes = std::make_shared<SegmentDeletes>();
+	deletes->docs.assign(DOCS_COUNT, false);
+	for (uint32_t docId = 0; docId < DOCS_COUNT; docId += 3)
+	{
+		deletes->docs[docId] = true;
+		++deletes->count;
+	}
+
+	const auto lengthNorms = MakeLengthNorms(*segment);
+
+	for (const auto model : { ScoringModel::TfIdf, ScoringModel::Bm25 })
+	{
+		const ScoreFunction scoreFunction(model, segment->GetDocLengths(), lengthNorms, GetAverageDocLength(*segment));
+		for (const auto algorithm : { QueryAlgorithm::MaxScore, QueryAlgorithm::Wand, QueryAlgorithm::BlockMaxWand })
+		{
+			for (const auto hasDeletes : { false, true })
+			{
+				const IndexSnapshot::SegmentView view{ segment, hasDeletes ? deletes : nullptr };
+				for (int query = 0; query < 200; ++query)
+				{
+					std::vector<uint32_t> termOrdinals;
+					const auto termsCount = 1 + random() % 6;
+					for (uint32_t i = 0; i < termsCount; ++i)
+					{
+						termOrdinals.push_back(static_cast<uint32_t>(random() % segment->GetTermsCount()));
+					}
+					const auto terms = MakeTerms(*segment, model, termOrdinals);
+
+					// Половина запросов по всему сегменту, половина по случайному поддиапазону
+					uint32_t firstDocId = 0;
+					uint32_t lastDocId = DOCS_COUNT;
+					if (query % 2 == 1)
+					{
+						firstDocId = static_cast<uint32_t>(random() % DOCS_COUNT);
+						lastDocId = static_cast<uint32_t>(firstDocId + random() % (DOCS_COUNT - firstDocId + 1));
+					}
+
+					REQUIRE(Score(view, scoreFunction, terms, firstDocId, lastDocId, algorithm)
+						== ScoreExhaustive(view, scoreFunction, terms, firstDocId, lastDocId));
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE("BM25 upper bounds cover every posting")
+{
+	std::mt19937 random(3);
+	const auto segment = BuildSegment(random);
+	const auto lengthNorms = MakeLengthNorms(*segment);
+	const ScoreFunction scoreFunction(ScoringModel::Bm25, segment->GetDocLengths(), lengthNorms, GetAverageDocLength(*segment));
+
+	for (uint32_t termOrdinal = 0; termOrdinal < segment->GetTermsCount(); ++termOrdinal)
+	{
+		const auto blockMaxTermFrequencies = segment->GetBlockMaxTermFrequencies(termOrdinal);
+		const auto listBound = scoreFunction.GetUpperBound(segment->GetMaxTermFrequency(termOrdinal), 1.0);
+		size_t position = 0;
+		segment->GetPostings(termOrdinal).ForEach([&](const uint64_t docId, const uint32_t termCount) {
+			const auto contribution = scoreFunction.GetContribution(termCount, static_cast<uint32_t>(docId), 1.0);
+			const auto blockBound = scoreFunction.GetUpperBound(blockMaxTermFrequencies[position / PostingList::BLOCK_SIZE], 1.0);
+			REQUIRE(contribution <= blockBound);
+			REQUIRE(blockBound <= listBound);
+			++position;
+		});
+	}
+}
+
+TEST_CASE("Shared threshold prunes documents below it")
+{
+	std::mt19937 random(7);
+	const auto segment = BuildSegment(random);
+	const IndexSnapshot::SegmentView view{ segment, nullptr };
+	const auto terms = MakeTerms(*segment, ScoringModel::TfIdf, { 0, 1 });
+	const ScoreFunction scoreFunction(ScoringModel::TfIdf, segment->GetDocLengths(), {}, GetAverageDocLength(*segment));
+
+	std::atomic<double> threshold = std::numeric_limits<double>::infinity();
+	DocAtATimeScorer scorer(view, scoreFunction, terms.size(), TOP, threshold);
+	REQUIRE(scorer.Score(terms, 0, DOCS_COUNT, QueryAlgorithm::BlockMaxWand).empty());
+	REQUIRE_THROWS(scorer.Score(terms, 0, DOCS_COUNT, QueryAlgorithm::Exhaustive));
+}
@@ -0,0 +1,93 @@
+#include "IndexFile.h"
+#include "Bytes.h"
+#include "MappedFile.h"
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+constexpr std::array<char, 8> MAGIC = { 'M', 'T', 'S', 'I', 'N', 'D', 'E', 'X' };
+
+struct FileHeader
+{
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t segmentsCount;
+};
+
+struct SegmentEntry
+{
+	uint64_t offset;
+	uint64_t size;
+};
+} // namespace
+
+void IndexFile::Save(const std::string& path, const std::vector<std::shared_ptr<const Segment>>& segments)
+{
+	std::vector<SegmentEntry> entries;
+	auto offset = sizeof(FileHeader) + segments.size() * sizeof(SegmentEntry);
+	for (const auto& segment : segments)
+	{
+		offset = (offset + BYTES_ALIGNMENT - 1) / BYTES_ALIGNMENT * BYTES_ALIGNMENT;
+		entries.push_back({ offset, segment->GetBytes().size() });
+		offset += segment->GetBytes().size();
+	}
+
+	std::vector<std::byte> head;
+	AppendBytes(head, FileHeader{ MAGIC, VERSION, static_cast<uint32_t>(segments.size()) });
+	AppendBytes(head, std::span<const SegmentEntry>(entries));
+
+	const auto tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Cannot create index file: " + tempPath);
+		}
+
+		file.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			const auto bytes = segments[i]->GetBytes();
+			const std::vector<char> padding(entries[i].offset - static_cast<uint64_t>(file.tellp()), 0);
+			file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+			file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		}
+		if (!file.flush())
+		{
+			throw std::runtime_error("Cannot write index file: " + tempPath);
+		}
+	}
+	std::filesystem::rename(tempPath, path);
+}
+
+std::vector<std::shared_ptr<const Segment>> IndexFile::Load(const std::string& path)
+{
+	const auto file = std::make_shared<const MappedFile>(path);
+	const auto bytes = file->GetBytes();
+
+	const auto& header = ViewBytes<FileHeader>(bytes, 0, 1).front();
+	if (header.magic != MAGIC)
+	{
+		throw std::runtime_error("Not an index file: " + path);
+	}
+	if (header.version != VERSION)
+	{
+		throw std::runtime_error("Unsupported index version " + std::to_string(header.version) + ": " + path);
+	}
+
+	std::vector<std::shared_ptr<const Segment>> segments;
+	for (const auto& entry : ViewBytes<SegmentEntry>(bytes, sizeof(FileHeader), header.segmentsCount))
+	{
+		ViewBytes<std::byte>(bytes, entry.offset, entry.size);
+		if (entry.offset % BYTES_ALIGNMENT != 0)
+		{
+			throw std::runtime_error("Corrupted index data");
+		}
+		segments.push_back(Segment::Open(file, bytes.subspan(entry.offset, entry.size)));
+	}
+	return segments;
+}
@@ -0,0 +1,67 @@
+#include "IndexSnapshot.h"
+
+#include <algorithm>
+
+bool IndexSnapshot::SegmentView::IsDeleted(const uint32_t localDocId) const
+{
+	return deletes != nullptr && deletes->docs[localDocId];
+}
+
+size_t IndexSnapshot::SegmentView::GetLiveDocsCount() const
+{
+	return segment->GetDocsCount() - (deletes != nullptr ? deletes->count : 0);
+}
+
+uint64_t IndexSnapshot::SegmentView::GetLiveDocLength() const
+{
+	return segment->GetTotalDocLength() - (deletes != nullptr ? deletes->length : 0);
+}
+
+size_t IndexSnapshot::SegmentView::GetLiveTermDocsCount(const uint32_t termOrdinal) const
+{
+	const auto docsCount = segment->GetPostings(termOrdinal).GetSize();
+	if (deletes == nullptr)
+	{
+		return docsCount;
+	}
+	const auto it = deletes->termDocs.find(termOrdinal);
+	return it != deletes->termDocs.end() ? docsCount - it->second : docsCount;
+}
+
+std::optional<IndexSnapshot::DocLocation> IndexSnapshot::FindDocument(const uint64_t globalDocId) const
+{
+	const auto it = std::ranges::lower_bound(segments, globalDocId, {}, [](const SegmentView& view) {
+		return view.segment->GetLastGlobalDocId();
+	});
+	if (it == segments.end())
+	{
+		return std::nullopt;
+	}
+
+	const auto localDocId = it->segment->FindLocalDocId(globalDocId);
+	if (!localDocId || it->IsDeleted(*localDocId))
+	{
+		return std::nullopt;
+	}
+	return DocLocation{ static_cast<size_t>(it - segments.begin()), *localDocId };
+}
+
+size_t IndexSnapshot::GetLiveDocsCount() const
+{
+	size_t count = 0;
+	for (const auto& view : segments)
+	{
+		count += view.GetLiveDocsCount();
+	}
+	return count;
+}
+
+uint64_t IndexSnapshot::GetLiveDocLength() const
+{
+	uint64_t length = 0;
+	for (const auto& view : segments)
+	{
+		length += view.GetLiveDocLength();
+	}
+	return length;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	std::span<const std::byte> GetBytes() const;
+
+private:
+	void* m_data = nullptr;
+	size_t m_size = 0;
+};
@@ -0,0 +1,290 @@
+#include "PostingList.h"
+#include "Bytes.h"
+
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+// Экспоненциальный поиск от начала диапазона: при пересечении списков цель обычно недалеко от курсора,
+// и галоп находит её за O(log d) вместо O(log n)
+template <typename It, typename T, typename Proj = std::identity>
+It GallopLowerBound(It first, const It last, const T& value, Proj proj = {})
+{
+	std::ptrdiff_t step = 1;
+	while (step < last - first && std::invoke(proj, first[step]) < value)
+	{
+		first += step;
+		step *= 2;
+	}
+	return std::ranges::lower_bound(first, first + std::min(step + 1, last - first), value, {}, proj);
+}
+} // namespace
+
+PostingList::Cursor::Cursor(const PostingList& list)
+	: m_list(&list)
+	, m_blocksCount(list.GetBlocks().size() + (list.m_tail.empty() ? 0 : 1))
+{
+	LoadBlock(0);
+}
+
+uint64_t PostingList::Cursor::GetDocId() const
+{
+	return m_position < m_block.count ? m_block.docIds[m_position] : END;
+}
+
+uint32_t PostingList::Cursor::GetTermCount() const
+{
+	return m_block.termCounts[m_position];
+}
+
+void PostingList::Cursor::Next()
+{
+	if (++m_position == m_block.count)
+	{
+		LoadBlock(m_blockIndex + 1);
+	}
+}
+
+void PostingList::Cursor::Advance(const uint64_t docId)
+{
+	if (GetDocId() >= docId)
+	{
+		return;
+	}
+	if (GetBlockLastDocId(m_blockIndex) < docId)
+	{
+		LoadBlock(GallopBlock(docId));
+	}
+	const auto begin = m_block.docIds.begin();
+	m_position = GallopLowerBound(begin + m_position, begin + m_block.count, docId) - begin;
+	if (m_position == m_block.count)
+	{
+		LoadBlock(m_blockIndex + 1);
+	}
+}
+
+size_t PostingList::Cursor::FindBlock(const uint64_t docId) const
+{
+	// Чаще всего искомый документ лежит в уже раскодированном блоке
+	if (m_blockIndex < m_blocksCount && m_block.count > 0 && m_block.docIds[0] <= docId
+		&& docId <= GetBlockLastDocId(m_blockIndex))
+	{
+		return m_blockIndex;
+	}
+
+	const auto blocks = m_list->GetBlocks();
+	const auto it = std::ranges::lower_bound(blocks, docId, {}, &BlockHeader::lastDocId);
+	if (it != blocks.end())
+	{
+		return it - blocks.begin();
+	}
+	return !m_list->m_tail.empty() && m_list->m_tail.back() >= docId ? blocks.size() : m_blocksCount;
+}
+
+size_t PostingList::Cursor::GetBlockIndex() const
+{
+	return m_blockIndex;
+}
+
+uint64_t PostingList::Cursor::GetPrecedingTermCount() const
+{
+	return std::accumulate(m_block.termCounts.begin(), m_block.termCounts.begin() + m_position, uint64_t{ 0 });
+}
+
+uint64_t PostingList::Cursor::GetBlockLastDocId(const size_t blockIndex) const
+{
+	const auto blocks = m_list->GetBlocks();
+	if (blockIndex < blocks.size())
+	{
+		return blocks[blockIndex].lastDocId;
+	}
+	return blockIndex < m_blocksCount ? m_list->m_tail.back() : END;
+}
+
+size_t PostingList::Cursor::GallopBlock(const uint64_t docId) const
+{
+	const auto blocks = m_list->GetBlocks();
+	const auto first = blocks.begin() + std::min(m_blockIndex + 1, blocks.size());
+	const auto it = GallopLowerBound(first, blocks.end(), docId, &BlockHeader::lastDocId);
+	return it != blocks.end() ? it - blocks.begin() : FindBlock(docId);
+}
+
+void PostingList::Cursor::LoadBlock(const size_t blockIndex)
+{
+	m_blockIndex = blockIndex;
+	m_position = 0;
+	m_block.count = 0;
+	if (blockIndex < m_blocksCount)
+	{
+		m_list->DecodeBlockAt(blockIndex, m_block);
+	}
+}
+
+PostingList PostingList::Map(const std::span<const std::byte> bytes)
+{
+	const auto& header = ViewBytes<EncodedHeader>(bytes, 0, 1).front();
+	const auto blocksOffset = sizeof(EncodedHeader);
+	const auto dataOffset = blocksOffset + header.blocksCount * sizeof(BlockHeader);
+
+	PostingList list;
+	list.m_isMapped = true;
+	list.m_size = header.size;
+	list.m_mappedBlocks = ViewBytes<BlockHeader>(bytes, blocksOffset, header.blocksCount);
+	list.m_mappedData = ViewBytes<uint8_t>(bytes, dataOffset, header.dataSize);
+	return list;
+}
+
+void PostingList::Serialize(std::vector<std::byte>& out) const
+{
+	auto sealed = *this;
+	if (!sealed.m_tail.empty())
+	{
+		sealed.FlushTail();
+	}
+	const auto blocks = sealed.GetBlocks();
+	const auto data = sealed.GetData();
+
+	AlignBytes(out);
+	AppendBytes(out, EncodedHeader{ m_size, blocks.size(), data.size() });
+	AppendBytes(out, blocks);
+	AppendBytes(out, data);
+}
+
+void PostingList::Add(const uint64_t docId, const uint32_t termCount)
+{
+	if (m_isMapped)
+	{
+		throw std::logic_error("Mapped posting list is read-only");
+	}
+
+	const auto hasPostings = !m_tail.empty() || !m_blocks.empty();
+	const auto lastDocId = !m_tail.empty() ? m_tail.back() : (m_blocks.empty() ? 0 : m_blocks.back().lastDocId);
+	if (hasPostings && docId <= lastDocId)
+	{
+		throw std::invalid_argument("Postings must be added in increasing docId order");
+	}
+
+	m_tail.push_back(docId);
+	m_tailTermCounts.push_back(termCount);
+	++m_size;
+
+	if (m_tail.size() == BLOCK_SIZE)
+	{
+		FlushTail();
+	}
+}
+
+bool PostingList::Remove(const uint64_t docId)
+{
+	bool found = false;
+	ForEachBlockInRange(docId, docId + 1, [&found](const Block&) {
+		found = true;
+	});
+	if (!found)
+	{
+		return false;
+	}
+
+	PostingList rebuilt;
+	ForEach([&rebuilt, docId](const uint64_t id, const uint32_t termCount) {
+		if (id != docId)
+		{
+			rebuilt.Add(id, termCount);
+		}
+	});
+	*this = std::move(rebuilt);
+	return true;
+}
+
+size_t PostingList::GetSize() const
+{
+	return m_size;
+}
+
+size_t PostingList::GetMemoryUsage() const
+{
+	return sizeof(*this)
+		+ m_blocks.capacity() * sizeof(BlockHeader)
+		+ m_data.capacity()
+		+ m_tail.capacity() * sizeof(uint64_t)
+		+ m_tailTermCounts.capacity() * sizeof(uint32_t);
+}
+
+std::span<const PostingList::BlockHeader> PostingList::GetBlocks() const
+{
+	return m_isMapped ? m_mappedBlocks : std::span<const BlockHeader>(m_blocks);
+}
+
+std::span<const uint8_t> PostingList::GetData() const
+{
+	return m_isMapped ? m_mappedData : std::span<const uint8_t>(m_data);
+}
+
+void PostingList::FlushTail()
+{
+	const auto offset = m_data.size();
+	auto previousDocId = m_blocks.empty() ? 0 : m_blocks.back().lastDocId;
+
+	for (const auto docId : m_tail)
+	{
+		WriteVarint(m_data, docId - previousDocId);
+		previousDocId = docId;
+	}
+	for (const auto termCount : m_tailTermCounts)
+	{
+		WriteVarint(m_data, termCount);
+	}
+
+	m_blocks.push_back({ m_tail.back(), static_cast<uint32_t>(offset), static_cast<uint32_t>(m_tail.size()) });
+	m_tail.clear();
+	m_tailTermCounts.clear();
+}
+
+void PostingList::DecodeBlockAt(const size_t blockIndex, Block& block) const
+{
+	const auto blocks = GetBlocks();
+	if (blockIndex < blocks.size())
+	{
+		DecodeBlock(blocks[blockIndex], block);
+		return;
+	}
+	block.count = m_tail.size();
+	std::ranges::copy(m_tail, block.docIds.begin());
+	std::ranges::copy(m_tailTermCounts, block.termCounts.begin());
+}
+
+void PostingList::DecodeBlock(const BlockHeader& header, Block& block) const
+{
+	const auto* in = GetData().data() + header.offset;
+	auto docId = &header == GetBlocks().data() ? 0 : (&header - 1)->lastDocId;
+
+	block.count = header.count;
+	for (size_t i = 0; i < header.count; ++i)
+	{
+		docId += ReadVarint(in);
+		block.docIds[i] = docId;
+	}
+	for (size_t i = 0; i < header.count; ++i)
+	{
+		block.termCounts[i] = static_cast<uint32_t>(ReadVarint(in));
+	}
+}
+
+bool PostingList::ClipBlock(Block& block, const uint64_t firstDocId, const uint64_t lastDocId)
+{
+	const auto begin = std::lower_bound(block.docIds.begin(), block.docIds.begin() + block.count, firstDocId);
+	const auto end = std::lower_bound(begin, block.docIds.begin() + block.count, lastDocId);
+	const auto skipped = begin - block.docIds.begin();
+	const auto count = end - begin;
+
+	if (skipped > 0)
+	{
+		std::copy(begin, end, block.docIds.begin());
+		std::copy(block.termCounts.begin() + skipped, block.termCounts.begin() + skipped + count, block.termCounts.begin());
+	}
+	const auto reachedLastDocId = end != block.docIds.begin() + block.count;
+	block.count = count;
+	return reachedLastDocId;
+}
@@ -0,0 +1,534 @@
+#include "Segment.h"
+#include "Bytes.h"
+#include "IndexSnapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+
+namespace
+{
+float RoundUp(const double value)
+{
+	auto rounded = static_cast<float>(value);
+	if (rounded < value)
+	{
+		rounded = std::nextafter(rounded, std::numeric_limits<float>::infinity());
+	}
+	return rounded;
+}
+
+void AppendStrings(
+	std::vector<std::byte>& out,
+	const std::vector<std::string>& strings,
+	uint64_t& offsetsPosition,
+	uint64_t& charsPosition)
+{
+	std::vector<uint64_t> offsets{ 0 };
+	for (const auto& str : strings)
+	{
+		offsets.push_back(offsets.back() + str.size());
+	}
+
+	AlignBytes(out);
+	offsetsPosition = out.size();
+	AppendBytes(out, std::span<const uint64_t>(offsets));
+
+	charsPosition = out.size();
+	for (const auto& str : strings)
+	{
+		AppendBytes(out, std::span<const char>(str));
+	}
+}
+
+void AppendPositions(const std::span<const uint32_t> positions, std::vector<uint8_t>& out)
+{
+	uint32_t previous = 0;
+	for (const auto position : positions)
+	{
+		WriteVarint(out, position - previous);
+		previous = position;
+	}
+}
+
+const uint8_t* SkipVarints(const uint8_t* in, uint64_t count)
+{
+	for (; count > 0; ++in)
+	{
+		if ((*in & 0x80) == 0)
+		{
+			--count;
+		}
+	}
+	return in;
+}
+
+uint64_t SumTermCounts(const PostingList::Block& block)
+{
+	return std::accumulate(block.termCounts.begin(), block.termCounts.begin() + block.count, uint64_t{ 0 });
+}
+} // namespace
+
+void Segment::Builder::AddDocument(
+	std::string path,
+	const std::span<const TermCounter::Entry> termCounts,
+	const uint32_t length,
+	const FileState& fileState)
+{
+	const auto localDocId = static_cast<uint32_t>(m_paths.size());
+	for (const auto& [term, count, positions] : termCounts)
+	{
+		auto it = m_postings.find(term);
+		if (it == m_postings.end())
+		{
+			it = m_postings.emplace(term, TermPostings()).first;
+		}
+		it->second.postings.Add(localDocId, count);
+		if (positions.size() != count)
+		{
+			m_hasPositions = false;
+		}
+		else if (m_hasPositions)
+		{
+			AppendPositions(positions, it->second.positions);
+		}
+	}
+	m_paths.push_back(std::move(path));
+	m_docLengths.push_back(length);
+	m_fileStates.push_back(fileState);
+}
+
+size_t Segment::Builder::GetDocsCount() const
+{
+	return m_paths.size();
+}
+
+std::shared_ptr<Segment> Segment::Builder::Build()
+{
+	Contents contents;
+	contents.terms.reserve(m_postings.size());
+	for (const auto& term : m_postings | std::views::keys)
+	{
+		contents.terms.push_back(term);
+	}
+	std::ranges::sort(contents.terms);
+
+	contents.postings.reserve(contents.terms.size());
+	for (const auto& term : contents.terms)
+	{
+		auto& termPostings = m_postings.at(term);
+		contents.postings.push_back(std::move(termPostings.postings));
+		if (m_hasPositions)
+		{
+			contents.positions.push_back(std::move(termPostings.positions));
+		}
+	}
+	contents.globalDocIds.assign(m_paths.size(), 0);
+	contents.paths = std::move(m_paths);
+	contents.docLengths = std::move(m_docLengths);
+	contents.fileStates = std::move(m_fileStates);
+
+	m_postings.clear();
+	m_hasPositions = true;
+	return Encode(contents);
+}
+
+std::shared_ptr<Segment> Segment::Merge(const std::vector<MergePart>& parts)
+{
+	Contents contents;
+
+	std::vector<std::vector<int64_t>> newDocIds(parts.size());
+	for (size_t part = 0; part < parts.size(); ++part)
+	{
+		const auto& source = *parts[part].segment;
+		newDocIds[part].assign(source.GetDocsCount(), -1);
+
+		for (uint32_t localDocId = 0; localDocId < source.GetDocsCount(); ++localDocId)
+		{
+			if (parts[part].deletes != nullptr && parts[part].deletes->docs[localDocId])
+			{
+				continue;
+			}
+			newDocIds[part][localDocId] = static_cast<int64_t>(contents.paths.size());
+			contents.paths.emplace_back(source.GetPath(localDocId));
+			contents.docLengths.push_back(source.GetDocLength(localDocId));
+			contents.globalDocIds.push_back(source.GetGlobalDocId(localDocId));
+			contents.fileStates.push_back(source.GetFileState(localDocId));
+		}
+	}
+
+	std::map<std::string, std::vector<std::pair<size_t, uint32_t>>, std::less<>> termSources;
+	for (size_t part = 0; part < parts.size(); ++part)
+	{
+		for (TermDictionary::Iterator it(parts[part].segment->m_terms, 0); it.IsValid(); it.Next())
+		{
+			termSources[std::string(it.GetTerm())].emplace_back(part, it.GetOrdinal());
+		}
+	}
+
+	const auto hasPositions = std::ranges::all_of(parts, [](const MergePart& part) {
+		return part.segment->HasPositions();
+	});
+
+	for (const auto& [term, sources] : termSources)
+	{
+		PostingList postings;
+		std::vector<uint8_t> positions;
+		for (const auto& [part, termOrdinal] : sources)
+		{
+			const auto& source = *parts[part].segment;
+			const auto& partDocIds = newDocIds[part];
+			// Позиции документа закодированы независимо от соседей, поэтому переносятся байтами без перекодирования
+			const auto* in = hasPositions ? source.m_positions.data() + source.m_positionOffsets[termOrdinal] : nullptr;
+			source.GetPostings(termOrdinal).ForEach([&](const uint64_t localDocId, const uint32_t termCount) {
+				const auto* next = hasPositions ? SkipVarints(in, termCount) : nullptr;
+				if (partDocIds[localDocId] >= 0)
+				{
+					postings.Add(partDocIds[localDocId], termCount);
+					positions.insert(positions.end(), in, next);
+				}
+				in = next;
+			});
+		}
+		if (postings.GetSize() > 0)
+		{
+			contents.terms.emplace_back(term);
+			contents.postings.push_back(std::move(postings));
+			if (hasPositions)
+			{
+				contents.positions.push_back(std::move(positions));
+			}
+		}
+	}
+
+	return Encode(contents);
+}
+
+std::shared_ptr<Segment> Segment::Open(std::shared_ptr<const void> owner, const std::span<const std::byte> bytes)
+{
+	auto segment = std::shared_ptr<Segment>(new Segment());
+	segment->m_owner = std::move(owner);
+	segment->m_bytes = bytes;
+	segment->Parse();
+	return segment;
+}
+
+std::shared_ptr<Segment> Segment::Encode(const Contents& contents)
+{
+	std::vector<std::byte> out;
+	Header header{};
+	header.docsCount = contents.paths.size();
+	header.termsCount = contents.terms.size();
+	AppendBytes(out, header);
+
+	const auto terms = TermDictionary::Encode(contents.terms);
+	AlignBytes(out);
+	header.termBlockOffsets = out.size();
+	AppendBytes(out, std::span<const uint64_t>(terms.blockOffsets));
+	header.termBytes = out.size();
+	AppendBytes(out, std::span<const uint8_t>(terms.bytes));
+
+	std::vector<uint64_t> postingOffsets;
+	std::vector<std::byte> postings;
+	for (const auto& postingList : contents.postings)
+	{
+		AlignBytes(postings);
+		postingOffsets.push_back(postings.size());
+		postingList.Serialize(postings);
+	}
+	postingOffsets.push_back(postings.size());
+
+	AlignBytes(out);
+	header.postingOffsets = out.size();
+	AppendBytes(out, std::span<const uint64_t>(postingOffsets));
+	AlignBytes(out);
+	header.postings = out.size();
+	AppendBytes(out, std::span<const std::byte>(postings));
+
+	std::vector<float> maxTermFrequencies;
+	std::vector<uint64_t> blockMaxOffsets{ 0 };
+	std::vector<float> blockMaxTermFrequencies;
+	for (const auto& postingList : contents.postings)
+	{
+		float termMax = 0;
+		postingList.ForEachBlockInRange(0, UINT64_MAX, [&](const PostingList::Block& block) {
+			float blockMax = 0;
+			for (size_t i = 0; i < block.count; ++i)
+			{
+				const auto termFrequency = static_cast<double>(block.termCounts[i]) / contents.docLengths[block.docIds[i]];
+				blockMax = std::max(blockMax, RoundUp(termFrequency));
+			}
+			blockMaxTermFrequencies.push_back(blockMax);
+			termMax = std::max(termMax, blockMax);
+		});
+		maxTermFrequencies.push_back(termMax);
+		blockMaxOffsets.push_back(blockMaxTermFrequencies.size());
+	}
+
+	AlignBytes(out);
+	header.maxTermFrequencies = out.size();
+	AppendBytes(out, std::span<const float>(maxTermFrequencies));
+	AlignBytes(out);
+	header.blockMaxOffsets = out.size();
+	AppendBytes(out, std::span<const uint64_t>(blockMaxOffsets));
+	header.blockMaxTermFrequencies = out.size();
+	AppendBytes(out, std::span<const float>(blockMaxTermFrequencies));
+
+	AlignBytes(out);
+	header.docLengths = out.size();
+	AppendBytes(out, std::span<const uint32_t>(contents.docLengths));
+	AlignBytes(out);
+	header.globalDocIds = out.size();
+	AppendBytes(out, std::span<const uint64_t>(contents.globalDocIds));
+	header.fileStates = out.size();
+	AppendBytes(out, std::span<const FileState>(contents.fileStates));
+
+	AppendStrings(out, contents.paths, header.pathOffsets, header.pathChars);
+
+	std::vector<uint32_t> docTermsOffsets(contents.paths.size() + 1, 0);
+	for (const auto& postingList : contents.postings)
+	{
+		postingList.ForEach([&](const uint64_t localDocId, uint32_t) {
+			++docTermsOffsets[localDocId + 1];
+		});
+	}
+	std::partial_sum(docTermsOffsets.begin(), docTermsOffsets.end(), docTermsOffsets.begin());
+
+	std::vector<uint32_t> docTerms(docTermsOffsets.back());
+	auto positions = docTermsOffsets;
+	for (uint32_t termOrdinal = 0; termOrdinal < contents.postings.size(); ++termOrdinal)
+	{
+		contents.postings[termOrdinal].ForEach([&](const uint64_t localDocId, uint32_t) {
+			docTerms[positions[localDocId]++] = termOrdinal;
+		});
+	}
+
+	AlignBytes(out);
+	header.docTermsOffsets = out.size();
+	AppendBytes(out, std::span<const uint32_t>(docTermsOffsets));
+	header.docTerms = out.size();
+	AppendBytes(out, std::span<const uint32_t>(docTerms));
+
+	if (!contents.positions.empty())
+	{
+		std::vector<uint64_t> positionOffsets{ 0 };
+		std::vector<uint64_t> positionBlockOffsets;
+		std::vector<uint8_t> positions;
+		for (size_t termOrdinal = 0; termOrdinal < contents.postings.size(); ++termOrdinal)
+		{
+			const auto& termPositions = contents.positions[termOrdinal];
+			const auto* in = termPositions.data();
+			contents.postings[termOrdinal].ForEachBlockInRange(0, UINT64_MAX, [&](const PostingList::Block& block) {
+				positionBlockOffsets.push_back(positions.size() + (in - termPositions.data()));
+				in = SkipVarints(in, SumTermCounts(block));
+			});
+			positions.insert(positions.end(), termPositions.begin(), termPositions.end());
+			positionOffsets.push_back(positions.size());
+		}
+
+		header.hasPositions = 1;
+		AlignBytes(out);
+		header.positionOffsets = out.size();
+		AppendBytes(out, std::span<const uint64_t>(positionOffsets));
+		header.positionBlockOffsets = out.size();
+		AppendBytes(out, std::span<const uint64_t>(positionBlockOffsets));
+		header.positions = out.size();
+		AppendBytes(out, std::span<const uint8_t>(positions));
+	}
+
+	std::memcpy(out.data(), &header, sizeof(header));
+
+	auto segment = std::shared_ptr<Segment>(new Segment());
+	segment->m_ownedBytes = std::move(out);
+	segment->m_bytes = segment->m_ownedBytes;
+	segment->Parse();
+	return segment;
+}
+
+void Segment::Parse()
+{
+	const auto& header = ViewBytes<Header>(m_bytes, 0, 1).front();
+	if (header.docsCount > m_bytes.size() || header.termsCount > m_bytes.size())
+	{
+		throw std::runtime_error("Corrupted index data");
+	}
+
+	const auto termBlockOffsets = ViewBytes<uint64_t>(
+		m_bytes,
+		header.termBlockOffsets,
+		(header.termsCount + TermDictionary::BLOCK_SIZE - 1) / TermDictionary::BLOCK_SIZE + 1);
+	m_terms = TermDictionary(
+		header.termsCount,
+		termBlockOffsets,
+		ViewBytes<uint8_t>(m_bytes, header.termBytes, termBlockOffsets.back()));
+	m_postingOffsets = ViewBytes<uint64_t>(m_bytes, header.postingOffsets, header.termsCount + 1);
+	m_postings = ViewBytes<std::byte>(m_bytes, header.postings, m_postingOffsets.back());
+	m_maxTermFrequencies = ViewBytes<float>(m_bytes, header.maxTermFrequencies, header.termsCount);
+	m_blockMaxOffsets = ViewBytes<uint64_t>(m_bytes, header.blockMaxOffsets, header.termsCount + 1);
+	m_blockMaxTermFrequencies = ViewBytes<float>(m_bytes, header.blockMaxTermFrequencies, m_blockMaxOffsets.back());
+
+	m_docLengths = ViewBytes<uint32_t>(m_bytes, header.docLengths, header.docsCount);
+	m_totalDocLength = std::accumulate(m_docLengths.begin(), m_docLengths.end(), uint64_t{ 0 });
+	m_globalDocIds = ViewBytes<uint64_t>(m_bytes, header.globalDocIds, header.docsCount);
+	m_fileStates = ViewBytes<FileState>(m_bytes, header.fileStates, header.docsCount);
+	m_pathOffsets = ViewBytes<uint64_t>(m_bytes, header.pathOffsets, header.docsCount + 1);
+	m_pathChars = ViewBytes<char>(m_bytes, header.pathChars, m_pathOffsets.back());
+
+	m_docTermsOffsets = ViewBytes<uint32_t>(m_bytes, header.docTermsOffsets, header.docsCount + 1);
+	m_docTerms = ViewBytes<uint32_t>(m_bytes, header.docTerms, m_docTermsOffsets.back());
+
+	if (header.hasPositions != 0)
+	{
+		m_positionOffsets = ViewBytes<uint64_t>(m_bytes, header.positionOffsets, header.termsCount + 1);
+		m_positionBlockOffsets = ViewBytes<uint64_t>(m_bytes, header.positionBlockOffsets, m_blockMaxOffsets.back());
+		m_positions = ViewBytes<uint8_t>(m_bytes, header.positions, m_positionOffsets.back());
+	}
+}
+
+void Segment::AssignGlobalDocIds(const uint64_t firstDocId)
+{
+	if (m_ownedBytes.empty())
+	{
+		throw std::logic_error("Mapped segment is read-only");
+	}
+
+	const auto offset = reinterpret_cast<const std::byte*>(m_globalDocIds.data()) - m_bytes.data();
+	auto* globalDocIds = reinterpret_cast<uint64_t*>(m_ownedBytes.data() + offset);
+	std::iota(globalDocIds, globalDocIds + m_globalDocIds.size(), firstDocId);
+}
+
+size_t Segment::GetDocsCount() const
+{
+	return m_docLengths.size();
+}
+
+size_t Segment::GetTermsCount() const
+{
+	return m_terms.GetSize();
+}
+
+uint64_t Segment::GetGlobalDocId(const uint32_t localDocId) const
+{
+	return m_globalDocIds[localDocId];
+}
+
+uint64_t Segment::GetLastGlobalDocId() const
+{
+	return m_globalDocIds.back();
+}
+
+std::optional<uint32_t> Segment::FindLocalDocId(const uint64_t globalDocId) const
+{
+	const auto it = std::ranges::lower_bound(m_globalDocIds, globalDocId);
+	if (it == m_globalDocIds.end() || *it != globalDocId)
+	{
+		return std::nullopt;
+	}
+	return static_cast<uint32_t>(it - m_globalDocIds.begin());
+}
+
+std::string_view Segment::GetPath(const uint32_t localDocId) const
+{
+	return { m_pathChars.data() + m_pathOffsets[localDocId], m_pathOffsets[localDocId + 1] - m_pathOffsets[localDocId] };
+}
+
+uint32_t Segment::GetDocLength(const uint32_t localDocId) const
+{
+	return m_docLengths[localDocId];
+}
+
+std::span<const uint32_t> Segment::GetDocLengths() const
+{
+	return m_docLengths;
+}
+
+uint64_t Segment::GetTotalDocLength() const
+{
+	return m_totalDocLength;
+}
+
+const FileState& Segment::GetFileState(const uint32_t localDocId) const
+{
+	return m_fileStates[localDocId];
+}
+
+std::span<const uint32_t> Segment::GetDocTerms(const uint32_t localDocId) const
+{
+	return m_docTerms.subspan(
+		m_docTermsOffsets[localDocId],
+		m_docTermsOffsets[localDocId + 1] - m_docTermsOffsets[localDocId]);
+}
+
+std::optional<uint32_t> Segment::FindTerm(const std::string_view term) const
+{
+	return m_terms.Find(term);
+}
+
+std::string Segment::GetTerm(const uint32_t termOrdinal) const
+{
+	return m_terms.GetTerm(termOrdinal);
+}
+
+const TermDictionary& Segment::GetTermDictionary() const
+{
+	return m_terms;
+}
+
+PostingList Segment::GetPostings(const uint32_t termOrdinal) const
+{
+	return PostingList::Map(m_postings.subspan(
+		m_postingOffsets[termOrdinal],
+		m_postingOffsets[termOrdinal + 1] - m_postingOffsets[termOrdinal]));
+}
+
+float Segment::GetMaxTermFrequency(const uint32_t termOrdinal) const
+{
+	return m_maxTermFrequencies[termOrdinal];
+}
+
+std::span<const float> Segment::GetBlockMaxTermFrequencies(const uint32_t termOrdinal) const
+{
+	return m_blockMaxTermFrequencies.subspan(
+		m_blockMaxOffsets[termOrdinal],
+		m_blockMaxOffsets[termOrdinal + 1] - m_blockMaxOffsets[termOrdinal]);
+}
+
+bool Segment::HasPositions() const
+{
+	return !m_positionOffsets.empty();
+}
+
+void Segment::DecodePositions(
+	const uint32_t termOrdinal,
+	const PostingList::Cursor& cursor,
+	std::vector<uint32_t>& positions) const
+{
+	if (!HasPositions())
+	{
+		throw std::logic_error("Segment has no positions");
+	}
+
+	const auto blockOffset = m_positionBlockOffsets[m_blockMaxOffsets[termOrdinal] + cursor.GetBlockIndex()];
+	const auto* in = SkipVarints(m_positions.data() + blockOffset, cursor.GetPrecedingTermCount());
+	positions.resize(cursor.GetTermCount());
+	uint32_t position = 0;
+	for (auto& value : positions)
+	{
+		position += static_cast<uint32_t>(ReadVarint(in));
+		value = position;
+	}
+}
+
+std::span<const std::byte> Segment::GetBytes() const
+{
+	return m_bytes;
+}
+
+size_t Segment::GetMemoryUsage() const
+{
+	return sizeof(*this) + m_bytes.size();
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include "../Tokenizer/TermCounter.h"
+#include "FileState.h"
+#include "PostingList.h"
+#include "TermDictionary.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct SegmentDeletes;
+
+// Сегмент хранится одним плоским образом байтов: словарь терминов с фронтальным кодированием, блоки постингов, таблица документов
+// и пул путей. Образ либо принадлежит сегменту, либо отображён из файла индекса и читается без копирования.
+// Позиционные постинги необязательны: они есть, только если позиции пришли для всех документов сегмента
+class Segment
+{
+public:
+	class Builder
+	{
+	public:
+		void AddDocument(
+			std::string path,
+			std::span<const TermCounter::Entry> termCounts,
+			uint32_t length,
+			const FileState& fileState);
+		size_t GetDocsCount() const;
+		std::shared_ptr<Segment> Build();
+
+	private:
+		struct TermPostings
+		{
+			PostingList postings;
+			std::vector<uint8_t> positions;
+		};
+
+		struct TermHash
+		{
+			using is_transparent = void;
+
+			size_t operator()(const std::string_view term) const
+			{
+				return std::hash<std::string_view>{}(term);
+			}
+		};
+
+		std::unordered_map<std::string, TermPostings, TermHash, std::equal_to<>> m_postings;
+		std::vector<std::string> m_paths;
+		std::vector<uint32_t> m_docLengths;
+		std::vector<FileState> m_fileStates;
+		bool m_hasPositions = true;
+	};
+
+	struct MergePart
+	{
+		const Segment* segment;
+		const SegmentDeletes* deletes;
+	};
+
+	static std::shared_ptr<Segment> Merge(const std::vector<MergePart>& parts);
+	static std::shared_ptr<Segment> Open(std::shared_ptr<const void> owner, std::span<const std::byte> bytes);
+
+	Segment(const Segment&) = delete;
+	Segment& operator=(const Segment&) = delete;
+
+	void AssignGlobalDocIds(uint64_t firstDocId);
+
+	size_t GetDocsCount() const;
+	size_t GetTermsCount() const;
+	uint64_t GetGlobalDocId(uint32_t localDocId) const;
+	uint64_t GetLastGlobalDocId() const;
+	std::optional<uint32_t> FindLocalDocId(uint64_t globalDocId) const;
+	std::string_view GetPath(uint32_t localDocId) const;
+	uint32_t GetDocLength(uint32_t localDocId) const;
+	std::span<const uint32_t> GetDocLengths() const;
+	uint64_t GetTotalDocLength() const;
+	const FileState& GetFileState(uint32_t localDocId) const;
+	std::span<const uint32_t> GetDocTerms(uint32_t localDocId) const;
+
+	std::optional<uint32_t> FindTerm(std::string_view term) const;
+	std::string GetTerm(uint32_t termOrdinal) const;
+	const TermDictionary& GetTermDictionary() const;
+	PostingList GetPostings(uint32_t termOrdinal) const;
+	// Верхние границы termCount / docLength по всему списку термина и по каждому его блоку
+	float GetMaxTermFrequency(uint32_t termOrdinal) const;
+	std::span<const float> GetBlockMaxTermFrequencies(uint32_t termOrdinal) const;
+	bool HasPositions() const;
+	// Позиции термина в документе под курсором его списка. Позиции хранятся разностями в varint, с началом
+	// каждого блока постингов, так что раскодируется только хвост блока до нужного документа
+	void DecodePositions(uint32_t termOrdinal, const PostingList::Cursor& cursor, std::vector<uint32_t>& positions) const;
+
+	std::span<const std::byte> GetBytes() const;
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Header
+	{
+		uint64_t docsCount;
+		uint64_t termsCount;
+		uint64_t termBlockOffsets;
+		uint64_t termBytes;
+		uint64_t postingOffsets;
+		uint64_t postings;
+		uint64_t maxTermFrequencies;
+		uint64_t blockMaxOffsets;
+		uint64_t blockMaxTermFrequencies;
+		uint64_t docLengths;
+		uint64_t globalDocIds;
+		uint64_t fileStates;
+		uint64_t pathOffsets;
+		uint64_t pathChars;
+		uint64_t docTermsOffsets;
+		uint64_t docTerms;
+		uint64_t hasPositions;
+		uint64_t positionOffsets;
+		uint64_t positionBlockOffsets;
+		uint64_t positions;
+	};
+
+	struct Contents
+	{
+		std::vector<std::string> terms;
+		std::vector<PostingList> postings;
+		std::vector<std::string> paths;
+		std::vector<uint32_t> docLengths;
+		std::vector<uint64_t> globalDocIds;
+		std::vector<FileState> fileStates;
+		// По списку позиций на термин, в порядке его постингов; пусто, если сегмент без позиций
+		std::vector<std::vector<uint8_t>> positions;
+	};
+
+	Segment() = default;
+	static std::shared_ptr<Segment> Encode(const Contents& contents);
+	void Parse();
+
+	std::vector<std::byte> m_ownedBytes;
+	std::shared_ptr<const void> m_owner;
+	std::span<const std::byte> m_bytes;
+
+	TermDictionary m_terms;
+	std::span<const uint64_t> m_postingOffsets;
+	std::span<const std::byte> m_postings;
+	std::span<const float> m_maxTermFrequencies;
+	std::span<const uint64_t> m_blockMaxOffsets;
+	std::span<const float> m_blockMaxTermFrequencies;
+
+	std::span<const uint32_t> m_docLengths;
+	uint64_t m_totalDocLength = 0;
+	std::span<const uint64_t> m_globalDocIds;
+	std::span<const FileState> m_fileStates;
+	std::span<const uint64_t> m_pathOffsets;
+	std::span<const char> m_pathChars;
+
+	std::span<const uint32_t> m_docTermsOffsets;
+	std::span<const uint32_t> m_docTerms;
+
+	std::span<const uint64_t> m_positionOffsets;
+	std::span<const uint64_t> m_positionBlockOffsets;
+	std::span<const uint8_t> m_positions;
+};
@@ -0,0 +1,300 @@
+#include "TermDictionary.h"
+#include "Bytes.h"
+
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+
+namespace
+{
+size_t GetCommonPrefixLength(const std::string_view left, const std::string_view right)
+{
+	return std::ranges::mismatch(left, right).in1 - left.begin();
+}
+
+bool MatchesWildcard(const std::string_view text, const std::string_view pattern)
+{
+	// Жадное сопоставление с возвратом к последней звёздочке
+	size_t t = 0;
+	size_t p = 0;
+	auto star = std::string_view::npos;
+	size_t starText = 0;
+	while (t < text.size())
+	{
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t]))
+		{
+			++t;
+			++p;
+		}
+		else if (p < pattern.size() && pattern[p] == '*')
+		{
+			star = p++;
+			starText = t;
+		}
+		else if (star != std::string_view::npos)
+		{
+			p = star + 1;
+			t = ++starText;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == '*')
+	{
+		++p;
+	}
+	return p == pattern.size();
+}
+} // namespace
+
+TermDictionary::Iterator::Iterator(const TermDictionary& dictionary, const uint32_t ordinal)
+	: m_dictionary(&dictionary)
+{
+	Seek(ordinal);
+}
+
+bool TermDictionary::Iterator::IsValid() const
+{
+	return m_ordinal < m_dictionary->m_termsCount;
+}
+
+uint32_t TermDictionary::Iterator::GetOrdinal() const
+{
+	return m_ordinal;
+}
+
+std::string_view TermDictionary::Iterator::GetTerm() const
+{
+	return m_term;
+}
+
+void TermDictionary::Iterator::Next()
+{
+	if (++m_ordinal < m_dictionary->m_termsCount)
+	{
+		Decode();
+	}
+}
+
+void TermDictionary::Iterator::Seek(const uint32_t ordinal)
+{
+	if (ordinal >= m_dictionary->m_termsCount)
+	{
+		m_ordinal = static_cast<uint32_t>(m_dictionary->m_termsCount);
+		return;
+	}
+
+	const auto blockIndex = ordinal / BLOCK_SIZE;
+	m_ordinal = blockIndex * BLOCK_SIZE;
+	m_in = m_dictionary->m_bytes.data() + m_dictionary->m_blockOffsets[blockIndex];
+	Decode();
+	while (m_ordinal < ordinal)
+	{
+		Next();
+	}
+}
+
+void TermDictionary::Iterator::Decode()
+{
+	const auto sharedLength = m_ordinal % BLOCK_SIZE == 0 ? 0 : ReadVarint(m_in);
+	const auto suffixLength = ReadVarint(m_in);
+	m_term.resize(sharedLength);
+	m_term.append(reinterpret_cast<const char*>(m_in), suffixLength);
+	m_in += suffixLength;
+}
+
+TermDictionary::Encoded TermDictionary::Encode(const std::span<const std::string> sortedTerms)
+{
+	Encoded encoded;
+	for (size_t i = 0; i < sortedTerms.size(); ++i)
+	{
+		const auto& term = sortedTerms[i];
+		size_t sharedLength = 0;
+		if (i % BLOCK_SIZE == 0)
+		{
+			encoded.blockOffsets.push_back(encoded.bytes.size());
+		}
+		else
+		{
+			sharedLength = GetCommonPrefixLength(sortedTerms[i - 1], term);
+			WriteVarint(encoded.bytes, sharedLength);
+		}
+		WriteVarint(encoded.bytes, term.size() - sharedLength);
+		encoded.bytes.insert(encoded.bytes.end(), term.begin() + static_cast<std::ptrdiff_t>(sharedLength), term.end());
+	}
+	encoded.blockOffsets.push_back(encoded.bytes.size());
+	return encoded;
+}
+
+TermDictionary::TermDictionary(
+	const size_t termsCount,
+	const std::span<const uint64_t> blockOffsets,
+	const std::span<const uint8_t> bytes)
+	: m_termsCount(termsCount)
+	, m_blockOffsets(blockOffsets)
+	, m_bytes(bytes)
+{
+	if (blockOffsets.size() != (termsCount + BLOCK_SIZE - 1) / BLOCK_SIZE + 1 || blockOffsets.back() != bytes.size())
+	{
+		throw std::runtime_error("Corrupted index data");
+	}
+}
+
+size_t TermDictionary::GetSize() const
+{
+	return m_termsCount;
+}
+
+std::string TermDictionary::GetTerm(const uint32_t ordinal) const
+{
+	return std::string(Iterator(*this, ordinal).GetTerm());
+}
+
+std::optional<uint32_t> TermDictionary::Find(const std::string_view term) const
+{
+	const auto ordinal = LowerBound(term);
+	if (ordinal < m_termsCount && Iterator(*this, ordinal).GetTerm() == term)
+	{
+		return ordinal;
+	}
+	return std::nullopt;
+}
+
+uint32_t TermDictionary::LowerBound(const std::string_view term) const
+{
+	// Последний блок, чей первый термин не больше искомого; внутри блока — линейный просмотр
+	const auto blocksCount = m_blockOffsets.size() - 1;
+	const auto blocks = std::views::iota(size_t{ 0 }, blocksCount);
+	const auto next = std::ranges::upper_bound(blocks, term, {}, [this](const size_t blockIndex) {
+		return GetBlockFirstTerm(blockIndex);
+	});
+	if (next == blocks.begin())
+	{
+		return 0;
+	}
+
+	Iterator it(*this, static_cast<uint32_t>(*(next - 1) * BLOCK_SIZE));
+	for (uint32_t i = 0; i < BLOCK_SIZE && it.IsValid() && it.GetTerm() < term; ++i)
+	{
+		it.Next();
+	}
+	return it.GetOrdinal();
+}
+
+std::vector<uint32_t> TermDictionary::FindByPrefix(const std::string_view prefix) const
+{
+	const auto first = LowerBound(prefix);
+	std::vector<uint32_t> result(GetPrefixEnd(prefix) - first);
+	std::iota(result.begin(), result.end(), first);
+	return result;
+}
+
+std::vector<uint32_t> TermDictionary::FindByWildcard(const std::string_view pattern) const
+{
+	// Кандидаты ограничены терминами с буквальным префиксом маски
+	const auto prefix = pattern.substr(0, pattern.find_first_of("*?"));
+	const auto last = GetPrefixEnd(prefix);
+
+	std::vector<uint32_t> result;
+	for (Iterator it(*this, LowerBound(prefix)); it.GetOrdinal() < last; it.Next())
+	{
+		if (MatchesWildcard(it.GetTerm(), pattern))
+		{
+			result.push_back(it.GetOrdinal());
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> TermDictionary::FindByEditDistance(const std::string_view term, const uint32_t maxEdits) const
+{
+	// Строки таблицы Левенштейна для префиксов текущего термина. Соседние термины делят префикс, поэтому
+	// строки общего префикса не пересчитываются; если все значения строки превысили maxEdits, ни один термин
+	// с этим префиксом не подойдёт и весь их диапазон пропускается
+	const auto width = term.size() + 1;
+	std::vector<uint32_t> rows(width);
+	std::iota(rows.begin(), rows.end(), 0u);
+	std::string rowsPrefix;
+
+	std::vector<uint32_t> result;
+	Iterator it(*this, 0);
+	while (it.IsValid())
+	{
+		const auto candidate = it.GetTerm();
+		rowsPrefix.resize(GetCommonPrefixLength(rowsPrefix, candidate));
+		rows.resize((rowsPrefix.size() + 1) * width);
+
+		auto isPruned = false;
+		while (rowsPrefix.size() < candidate.size() && !isPruned)
+		{
+			const auto c = candidate[rowsPrefix.size()];
+			rowsPrefix.push_back(c);
+			const auto previous = rows.size() - width;
+			rows.resize(rows.size() + width);
+			const auto current = previous + width;
+
+			rows[current] = static_cast<uint32_t>(rowsPrefix.size());
+			auto rowMin = rows[current];
+			for (size_t j = 1; j < width; ++j)
+			{
+				rows[current + j] = std::min({ rows[previous + j] + 1,
+					rows[current + j - 1] + 1,
+					rows[previous + j - 1] + (term[j - 1] == c ? 0u : 1u) });
+				rowMin = std::min(rowMin, rows[current + j]);
+			}
+			isPruned = rowMin > maxEdits;
+		}
+
+		if (isPruned)
+		{
+			// Короткий диапазон дешевле дочитать, длинный — перепрыгнуть поиском по блокам
+			uint32_t skipped = 0;
+			do
+			{
+				it.Next();
+			} while (it.IsValid() && it.GetTerm().starts_with(rowsPrefix) && ++skipped < BLOCK_SIZE);
+			if (skipped == BLOCK_SIZE)
+			{
+				it.Seek(GetPrefixEnd(rowsPrefix));
+			}
+			continue;
+		}
+		if (rows.back() <= maxEdits)
+		{
+			result.push_back(it.GetOrdinal());
+		}
+		it.Next();
+	}
+	return result;
+}
+
+size_t TermDictionary::GetMemoryUsage() const
+{
+	return m_blockOffsets.size_bytes() + m_bytes.size_bytes();
+}
+
+std::string_view TermDictionary::GetBlockFirstTerm(const size_t blockIndex) const
+{
+	const auto* in = m_bytes.data() + m_blockOffsets[blockIndex];
+	const auto length = ReadVarint(in);
+	return { reinterpret_cast<const char*>(in), length };
+}
+
+uint32_t TermDictionary::GetPrefixEnd(const std::string_view prefix) const
+{
+	// Все термины с префиксом лежат перед наименьшей строкой, которая больше любого из них
+	std::string successor(prefix);
+	while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xFF)
+	{
+		successor.pop_back();
+	}
+	if (successor.empty())
+	{
+		return static_cast<uint32_t>(m_termsCount);
+	}
+	successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+	return LowerBound(successor);
+}
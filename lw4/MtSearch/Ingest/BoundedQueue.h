@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+struct BoundedQueueStats
+{
+	size_t capacity = 0;
+	uint64_t pushes = 0;
+	size_t maxDepth = 0;
+	// Средняя длина очереди в моменты вставки
+	double averageDepth = 0;
+	// Суммарное время, которое производители ждали места, а потребители — элементов
+	double pushWaitSeconds = 0;
+	double popWaitSeconds = 0;
+};
+
+// Очередь между стадиями конвейера. Ограниченная ёмкость даёт обратное давление: быстрая стадия ждёт
+// медленную вместо того, чтобы копить в памяти файлы целиком. Время ожидания с обеих сторон показывает,
+// какая из соседних стадий узкое место
+template <typename T>
+class BoundedQueue
+{
+public:
+	using Stats = BoundedQueueStats;
+
+	explicit BoundedQueue(const size_t capacity)
+		: m_capacity(capacity)
+	{
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// false, если очередь закрыта и значение не принято
+	bool Push(T value)
+	{
+		std::unique_lock lock(m_mutex);
+		if (m_queue.size() >= m_capacity && !m_closed)
+		{
+			const auto start = Clock::now();
+			m_cvNotFull.wait(lock, [this] {
+				return m_queue.size() < m_capacity || m_closed;
+			});
+			m_pushWait += Clock::now() - start;
+		}
+		if (m_closed)
+		{
+			return false;
+		}
+
+		m_depthSum += m_queue.size();
+		++m_pushes;
+		m_queue.push_back(std::move(value));
+		m_maxDepth = std::max(m_maxDepth, m_queue.size());
+		m_cvNotEmpty.notify_one();
+		return true;
+	}
+
+	// nullopt, когда очередь закрыта и опустела
+	std::optional<T> Pop()
+	{
+		std::unique_lock lock(m_mutex);
+		if (m_queue.empty() && !m_closed)
+		{
+			const auto start = Clock::now();
+			m_cvNotEmpty.wait(lock, [this] {
+				return !m_queue.empty() || m_closed;
+			});
+			m_popWait += Clock::now() - start;
+		}
+		if (m_queue.empty())
+		{
+			return std::nullopt;
+		}
+
+		auto value = std::move(m_queue.front());
+		m_queue.pop_front();
+		m_cvNotFull.notify_one();
+		return value;
+	}
+
+	// Закрытие будит всех: потребители дочитывают остаток, производители получают отказ
+	void Close()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_closed = true;
+		}
+		m_cvNotEmpty.notify_all();
+		m_cvNotFull.notify_all();
+	}
+
+	// Отказ от недочитанного остатка при аварийной остановке конвейера
+	void Cancel()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_closed = true;
+			m_queue.clear();
+		}
+		m_cvNotEmpty.notify_all();
+		m_cvNotFull.notify_all();
+	}
+
+	Stats GetStats() const
+	{
+		std::lock_guard lock(m_mutex);
+		return {
+			m_capacity,
+			m_pushes,
+			m_maxDepth,
+			m_pushes > 0 ? static_cast<double>(m_depthSum) / static_cast<double>(m_pushes) : 0,
+			std::chrono::duration<double>(m_pushWait).count(),
+			std::chrono::duration<double>(m_popWait).count(),
+		};
+	}
+
+	// Статистика считается заново для каждого запуска конвейера
+	void ResetStats()
+	{
+		std::lock_guard lock(m_mutex);
+		m_pushes = 0;
+		m_depthSum = 0;
+		m_maxDepth = 0;
+		m_pushWait = {};
+		m_popWait = {};
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	const size_t m_capacity;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cvNotEmpty;
+	std::condition_variable m_cvNotFull;
+	std::deque<T> m_queue;
+	bool m_closed = false;
+
+	uint64_t m_pushes = 0;
+	uint64_t m_depthSum = 0;
+	size_t m_maxDepth = 0;
+	Clock::duration m_pushWait{};
+	Clock::duration m_popWait{};
+};
@@ -0,0 +1,196 @@
+#include "Ingest/IngestPipeline.h"
+#include <catch2/catch_all.hpp>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace
+{
+struct CollectedSegments
+{
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Segment>> segments;
+
+	IngestPipeline::PublishSegment GetPublisher()
+	{
+		return [this](const std::shared_ptr<Segment>& segment) {
+			std::lock_guard lock(mutex);
+			segments.push_back(segment);
+		};
+	}
+
+	std::set<std::string> GetPaths() const
+	{
+		std::set<std::string> paths;
+		for (const auto& segment : segments)
+		{
+			for (uint32_t localDocId = 0; localDocId < segment->GetDocsCount(); ++localDocId)
+			{
+				paths.emplace(segment->GetPath(localDocId));
+			}
+		}
+		return paths;
+	}
+};
+
+std::filesystem::path CreateTree()
+{
+	const auto dir = std::filesystem::temp_directory_path() / "mtsearch_ingest_test";
+	std::filesystem::remove_all(dir);
+	for (const auto* subdir : { "a/b/c", "a/d", "e" })
+	{
+		std::filesystem::create_directories(dir / subdir);
+	}
+	for (int i = 0; i < 20; ++i)
+	{
+		for (const auto* subdir : { "", "a", "a/b/c", "a/d", "e" })
+		{
+			std::ofstream(dir / subdir / ("f" + std::to_string(i) + ".txt")) << "deal lead " << subdir << ' ' << i;
+		}
+	}
+	return dir;
+}
+
+IngestPipeline::Options MakeOptions()
+{
+	IngestPipeline::Options options;
+	options.walkers = 3;
+	options.readers = 2;
+	options.tokenizers = 3;
+	options.queueCapacity = 4;
+	options.docsPerSegment = 7;
+	return options;
+}
+} // namespace
+
+TEST_CASE("Bounded queue")
+{
+	SECTION("Backpressure and close")
+	{
+		BoundedQueue<int> queue(2);
+		REQUIRE(queue.Push(1));
+		REQUIRE(queue.Push(2));
+
+		std::jthread producer([&] {
+			REQUIRE(queue.Push(3));
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		REQUIRE(queue.Pop() == 1);
+		producer.join();
+
+		queue.Close();
+		REQUIRE_FALSE(queue.Push(4));
+		REQUIRE(queue.Pop() == 2);
+		REQUIRE(queue.Pop() == 3);
+		REQUIRE_FALSE(queue.Pop().has_value());
+
+		const auto stats = queue.GetStats();
+		REQUIRE(stats.pushes == 3);
+		REQUIRE(stats.maxDepth == 2);
+		REQUIRE(stats.pushWaitSeconds > 0);
+	}
+
+	SECTION("Cancel drops pending items")
+	{
+		BoundedQueue<int> queue(4);
+		REQUIRE(queue.Push(1));
+		queue.Cancel();
+		REQUIRE_FALSE(queue.Pop().has_value());
+	}
+}
+
+TEST_CASE("Ingest pipeline")
+{
+	const auto dir = CreateTree();
+	const auto options = MakeOptions();
+
+	SECTION("Recursive walk indexes every file once")
+	{
+		CollectedSegments collected;
+		IngestPipeline pipeline(options, collected.GetPublisher());
+		const auto stats = pipeline.Run({ {}, { dir.string() }, true, true }, {});
+
+		const auto paths = collected.GetPaths();
+		REQUIRE(paths.size() == 100);
+		REQUIRE(paths.contains((dir / "a/b/c/f3.txt").string()));
+		for (const auto& segment : collected.segments)
+		{
+			REQUIRE(segment->GetDocsCount() <= options.docsPerSegment);
+			REQUIRE(segment->HasPositions());
+		}
+
+		REQUIRE(stats.stages.size() == 4);
+		for (const auto& stage : stats.stages)
+		{
+			REQUIRE(stage.items == 100);
+		}
+		for (const auto& [name, queue] : stats.queues)
+		{
+			REQUIRE(queue.pushes == 100);
+			REQUIRE(queue.maxDepth <= options.queueCapacity);
+		}
+	}
+
+	SECTION("Flat walk skips subdirectories")
+	{
+		CollectedSegments collected;
+		IngestPipeline pipeline(options, collected.GetPublisher());
+		pipeline.Run({ {}, { dir.string() }, false }, {});
+		REQUIRE(collected.GetPaths().size() == 20);
+	}
+
+	SECTION("Unchanged files are skipped")
+	{
+		CollectedSegments first;
+		CollectedSegments second;
+		// Конвейер живёт между запусками, а сегменты каждого запуска собираются отдельно
+		auto* current = &first;
+		IngestPipeline pipeline(options, [&current](const std::shared_ptr<Segment>& segment) {
+			std::lock_guard lock(current->mutex);
+			current->segments.push_back(segment);
+		});
+
+		const std::vector<std::string> files{ (dir / "f1.txt").string(), (dir / "f2.txt").string(), (dir / "missing.txt").string() };
+		pipeline.Run({ files, {}, false }, {});
+		REQUIRE(first.GetPaths().size() == 2);
+
+		std::map<std::string, FileState> states;
+		for (const auto& segment : first.segments)
+		{
+			for (uint32_t localDocId = 0; localDocId < segment->GetDocsCount(); ++localDocId)
+			{
+				states.emplace(segment->GetPath(localDocId), segment->GetFileState(localDocId));
+			}
+		}
+		// Другие метаданные при том же содержимом: файл читается, но по хешу не переиндексируется
+		states[files[1]].modificationTime = 0;
+
+		current = &second;
+		const auto stats = pipeline.Run({ files, {}, false }, [&](const std::string& path) -> std::optional<FileState> {
+			const auto it = states.find(path);
+			return it != states.end() ? std::optional(it->second) : std::nullopt;
+		});
+		REQUIRE(second.segments.empty());
+		REQUIRE(stats.queues[1].stats.pushes == 1);
+	}
+
+	SECTION("Errors stop the run but not the pipeline")
+	{
+		CollectedSegments collected;
+		IngestPipeline pipeline(options, collected.GetPublisher());
+		REQUIRE_THROWS(pipeline.Run({ {}, { (dir / "missing").string() }, true }, {}));
+		pipeline.Run({ {}, { dir.string() }, true }, {});
+		REQUIRE(collected.GetPaths().size() == 100);
+
+		IngestPipeline failingPipeline(options, [](const std::shared_ptr<Segment>&) {
+			throw std::runtime_error("Cannot publish");
+		});
+		REQUIRE_THROWS(failingPipeline.Run({ {}, { dir.string() }, true }, {}));
+		REQUIRE_THROWS(failingPipeline.Run({ {}, { dir.string() }, true }, {}));
+	}
+
+	std::filesystem::remove_all(dir);
+}
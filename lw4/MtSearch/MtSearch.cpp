@@ -1,21 +1,46 @@
 #include "MtSearch.h"
+#include "Index/IndexFile.h"
+#include "Query/BooleanMatcher.h"
+#include "Query/CollectionStatistics.h"
+#include "Query/DocAtATimeScorer.h"
+#include "Query/ScoredDoc.h"
+#include "Query/TermPattern.h"
+#include "ThreadPool/NumaTopology.h"
+#include "Tokenizer/Tokenizer.h"
 
-#include <boost/asio/post.hpp>
-#include <boost/asio/thread_pool.hpp>
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <limits>
 #include <ranges>
+#include <unordered_set>
+#include <utility>
 
-constexpr double NANO_IN_SECOND = 1000000000;
-
-std::vector<std::pair<uint64_t, double>> GetTopMapItems(const std::unordered_map<uint64_t, double>& inputMap, int top);
+using namespace std::chrono_literals;
 
-bool IsLatinChar(const char c)
-{
-	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
-}
+constexpr double NANO_IN_SECOND = 1000000000;
+constexpr size_t TOP_RESULTS_COUNT = 10;
+// Ранжированный список кэшируется с запасом на несколько страниц выдачи
+constexpr size_t CACHED_RESULTS_COUNT = 100;
+constexpr size_t MAX_TERM_EXPANSIONS = 64;
+constexpr size_t QUERY_CACHE_MEMORY_BUDGET = 64 << 20;
+constexpr uint32_t MIN_DOCS_PER_PARTITION = 4096;
+constexpr size_t DOCS_PER_SEGMENT = 512;
+constexpr size_t MAX_DIRECTORY_WALKERS = 4;
+constexpr size_t INGEST_QUEUE_CAPACITY = 256;
+constexpr size_t MIN_SEGMENT_DOCS = 1024;
+constexpr size_t MERGE_FACTOR = 4;
+constexpr double MAX_DELETED_DOCS_RATIO = 0.3;
+constexpr auto MERGE_INTERVAL = 10s;
+// Старшие биты идентификатора документа — номер шарда, так что сегменты шарда лежат в снимке подряд
+constexpr int SHARD_DOC_ID_SHIFT = 48;
 
 std::vector<std::string> SplitBySpaces(const std::string& str)
 {
@@ -31,10 +56,25 @@ std::vector<std::string> SplitBySpaces(const std::string& str)
 	return words;
 }
 
-MtSearch::MtSearch(std::istream& input, std::ostream& output, const int threads)
+MtSearch::IndexShard::IndexShard(const int threads, std::vector<int> shardCpus, const uint64_t firstDocId)
+	: cpus(std::move(shardCpus))
+	, pool(threads, cpus)
+	, nextDocId(firstDocId)
+{
+}
+
+MtSearch::MtSearch(std::istream& input, std::ostream& output, const int threads, const ShardOptions& shardOptions)
 	: m_input(input)
 	, m_output(output)
 	, m_threads(threads)
+	, m_shards(CreateShards(threads, shardOptions))
+	, m_queryCache(QUERY_CACHE_MEMORY_BUDGET)
+	, m_mergeThread([this](const std::stop_token& stopToken) {
+		MergeLoop(stopToken);
+	})
+	, m_ingestPipeline(GetIngestOptions(threads), [this](const std::shared_ptr<Segment>& segment) {
+		PublishSegment(segment);
+	})
 {
 }
 
@@ -59,9 +99,20 @@ void MtSearch::ProcessLine(const std::string& line)
 	const std::string addDirRecCommand = "add_dir_recursive";
 	const std::string findCommand = "find";
 	const std::string findBatchCommand = "find_batch";
+	const std::string findWithCommand = "find_with";
+	const std::string findPhraseCommand = "find_phrase";
+	const std::string findNearCommand = "find_near";
+	const std::string findBoolCommand = "find_bool";
+	const std::string scoringCommand = "scoring";
+	const std::string indexPositionsCommand = "index_positions";
 	const std::string removeFileCommand = "remove_file";
 	const std::string removeDirCommand = "remove_dir";
 	const std::string removeDirRecCommand = "remove_dir_recursive";
+	const std::string saveIndexCommand = "save_index";
+	const std::string loadIndexCommand = "load_index";
+	const std::string syncDirCommand = "sync_dir";
+	const std::string watchDirCommand = "watch_dir";
+	const std::string unwatchDirCommand = "unwatch_dir";
 
 	if (line.empty())
 	{
@@ -89,6 +140,55 @@ void MtSearch::ProcessLine(const std::string& line)
 		const auto wordsInfo = FindMostRelevantDocIds(SplitBySpaces(arg));
 		PrintFilesRelevantInfo(wordsInfo);
 	}
+	else if (command == findWithCommand)
+	{
+		auto words = SplitBySpaces(arg);
+		const auto algorithm = words.empty() ? std::nullopt : ParseQueryAlgorithm(words.front());
+		if (!algorithm)
+		{
+			throw std::invalid_argument("Invalid query algorithm");
+		}
+		words.erase(words.begin());
+		PrintFilesRelevantInfo(FindMostRelevantDocIds(words, *algorithm));
+	}
+	else if (command == findPhraseCommand)
+	{
+		PrintFilesRelevantInfo(FindPhraseDocIds(SplitBySpaces(arg), PhraseMatcher::Mode::Phrase));
+	}
+	else if (command == findNearCommand)
+	{
+		auto words = SplitBySpaces(arg);
+		uint32_t maxDistance = 0;
+		const auto* distance = words.empty() ? nullptr : words.front().c_str();
+		if (distance == nullptr
+			|| std::from_chars(distance, distance + words.front().size(), maxDistance).ptr != distance + words.front().size())
+		{
+			throw std::invalid_argument("Invalid distance");
+		}
+		words.erase(words.begin());
+		PrintFilesRelevantInfo(FindPhraseDocIds(words, PhraseMatcher::Mode::Near, maxDistance));
+	}
+	else if (command == findBoolCommand)
+	{
+		PrintFilesRelevantInfo(FindBooleanDocIds(arg));
+	}
+	else if (command == indexPositionsCommand)
+	{
+		if (arg != "on" && arg != "off")
+		{
+			throw std::invalid_argument("Invalid index_positions value");
+		}
+		SetIndexPositions(arg == "on");
+	}
+	else if (command == scoringCommand)
+	{
+		const auto model = ParseScoringModel(arg);
+		if (!model)
+		{
+			throw std::invalid_argument("Invalid scoring model");
+		}
+		SetScoringModel(*model);
+	}
 	else if (command == findBatchCommand)
 	{
 		ProcessFindBatch(arg);
@@ -113,192 +213,892 @@ void MtSearch::ProcessLine(const std::string& line)
 	{
 		PrintIndexInfo();
 	}
+	else if (command == "indexStats")
+	{
+		PrintIndexStats();
+	}
+	else if (command == "ingestStats")
+	{
+		PrintIngestStats();
+	}
+	else if (command == "compact")
+	{
+		MergeSegments(true);
+	}
+	else if (command == saveIndexCommand)
+	{
+		SaveIndex(arg);
+	}
+	else if (command == loadIndexCommand)
+	{
+		LoadIndex(arg);
+	}
+	else if (command == syncDirCommand)
+	{
+		SyncDir(arg);
+	}
+	else if (command == watchDirCommand)
+	{
+		WatchDir(arg);
+	}
+	else if (command == unwatchDirCommand)
+	{
+		UnwatchDir(arg);
+	}
 	else
 	{
 		throw std::invalid_argument("Invalid command");
 	}
 }
 
-void InsertWord(std::unordered_map<std::string, int>& words, const std::string& word)
+void MtSearch::AddFileToIndex(const std::string& filePath)
+{
+	IndexFiles({ filePath }, false);
+}
+
+void MtSearch::AddDirToIndex(const std::string& dirPath, const bool recursively)
+{
+	RunIngestPipeline({ {}, { dirPath }, recursively }, {});
+}
+
+void MtSearch::AddFilesToIndex(const std::vector<std::string>& filePaths)
+{
+	IndexFiles(filePaths, false);
+}
+
+void MtSearch::AddDocumentsToIndex(std::vector<Document> documents)
+{
+	TermCounter termCounter(m_indexPositions.load());
+	Segment::Builder builder;
+	for (auto& [path, content] : documents)
+	{
+		FileState state;
+		state.size = content.size();
+		state.contentHash = HashContent(content);
+		Tokenizer::CountTerms(content, termCounter);
+		builder.AddDocument(std::move(path), termCounter.GetEntries(), termCounter.GetTotalCount(), state);
+		termCounter.Clear();
+	}
+	PublishSegment(builder.Build());
+}
+
+uint64_t MtSearch::GetIndexEpoch() const
 {
-	std::string result = word;
+	return m_snapshot.load()->epoch;
+}
 
-	std::transform(result.begin(), result.end(), result.begin(), [](const unsigned char c) {
-		return std::tolower(c);
+void MtSearch::IndexFiles(const std::vector<std::string>& files, const bool onlyChanged)
+{
+	std::unordered_map<std::string_view, FileState> indexedStates;
+	if (onlyChanged)
+	{
+		const auto states = GetIndexedFileStates(files);
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+			if (states[i])
+			{
+				indexedStates.emplace(files[i], *states[i]);
+			}
+		}
+	}
+
+	RunIngestPipeline({ files, {}, false }, [&indexedStates](const std::string& path) -> std::optional<FileState> {
+		const auto it = indexedStates.find(path);
+		return it != indexedStates.end() ? std::optional(it->second) : std::nullopt;
 	});
+}
+
+void MtSearch::RunIngestPipeline(
+	IngestPipeline::Input input,
+	const IngestPipeline::FindIndexedState& findIndexedState)
+{
+	input.recordPositions = m_indexPositions.load();
+	auto stats = m_ingestPipeline.Run(input, findIndexedState);
+
+	std::lock_guard lock(m_ingestStatsMutex);
+	m_ingestStats = std::move(stats);
+}
+
+IngestPipeline::Options MtSearch::GetIngestOptions(const int threads)
+{
+	const auto threadsCount = static_cast<size_t>(std::max(threads, 1));
+	IngestPipeline::Options options;
+	options.walkers = std::min(threadsCount, MAX_DIRECTORY_WALKERS);
+	options.readers = threadsCount;
+	options.tokenizers = threadsCount;
+	options.queueCapacity = INGEST_QUEUE_CAPACITY;
+	options.docsPerSegment = DOCS_PER_SEGMENT;
+	return options;
+}
+
+IngestPipeline::Stats MtSearch::GetIngestStats() const
+{
+	std::lock_guard lock(m_ingestStatsMutex);
+	return m_ingestStats;
+}
 
-	auto it = words.find(result);
-	if (it != words.end())
+std::vector<std::optional<FileState>> MtSearch::GetIndexedFileStates(const std::vector<std::string>& files)
+{
+	std::vector<std::optional<FileState>> states(files.size());
+
+	std::lock_guard lock(m_writeMutex);
+	const auto snapshot = m_snapshot.load();
+	for (size_t i = 0; i < files.size(); ++i)
 	{
-		it->second++;
+		const auto it = m_fileIds.find(files[i]);
+		if (it == m_fileIds.end())
+		{
+			continue;
+		}
+		if (const auto location = snapshot->FindDocument(it->second))
+		{
+			states[i] = snapshot->segments[location->segmentIndex].segment->GetFileState(location->localDocId);
+		}
 	}
-	else
+	return states;
+}
+
+std::vector<std::string> MtSearch::GetIndexedFiles(const std::string& path)
+{
+	const auto dirPrefix = (std::filesystem::path(path) / "").string();
+
+	std::vector<std::string> files;
+	std::lock_guard lock(m_writeMutex);
+	for (const auto& filePath : m_fileIds | std::views::keys)
 	{
-		words[result] = 1;
+		if (filePath == path || filePath.starts_with(dirPrefix))
+		{
+			files.push_back(filePath);
+		}
 	}
+	return files;
 }
 
-uint ReadWordsFromFile(std::ifstream& input, std::unordered_map<std::string, int>& wordsCountMap)
+void MtSearch::SyncDir(const std::string& dirPath)
 {
-	std::string line;
-	uint totalWordCount = 0;
-	while (std::getline(input, line))
+	const auto files = ListDirectoryFiles(dirPath, true);
+	const std::unordered_set<std::string_view> existingFiles(files.begin(), files.end());
+
+	auto removedFiles = GetIndexedFiles(dirPath);
+	std::erase_if(removedFiles, [&existingFiles](const std::string& filePath) {
+		return existingFiles.contains(filePath);
+	});
+
+	RemoveFilesFromIndex(removedFiles);
+	IndexFiles(files, true);
+}
+
+void MtSearch::SyncPaths(const std::vector<std::string>& paths)
+{
+	std::vector<std::string> files;
+	std::vector<std::string> removedFiles;
+	for (const auto& path : paths)
 	{
-		std::string currentWord;
+		std::error_code ec;
+		if (std::filesystem::is_directory(path, ec))
+		{
+			SyncDir(path);
+		}
+		else if (std::filesystem::is_regular_file(path, ec))
+		{
+			files.push_back(path);
+		}
+		else
+		{
+			std::ranges::move(GetIndexedFiles(path), std::back_inserter(removedFiles));
+		}
+	}
+	std::ranges::sort(removedFiles);
+	const auto [first, last] = std::ranges::unique(removedFiles);
+	removedFiles.erase(first, last);
+
+	RemoveFilesFromIndex(removedFiles);
+	IndexFiles(files, true);
+}
 
-		for (const auto c : line)
+void MtSearch::WatchDir(const std::string& dirPath)
+{
+	SyncDir(dirPath);
+
+	auto watcher = std::make_unique<DirectoryWatcher>(dirPath, [this](const std::vector<std::string>& changedPaths) {
+		try
+		{
+			SyncPaths(changedPaths);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Cannot sync changes: " << e.what() << std::endl;
+		}
+	});
+
+	std::lock_guard lock(m_watchersMutex);
+	m_watchers.push_back(std::move(watcher));
+}
+
+void MtSearch::UnwatchDir(const std::string& dirPath)
+{
+	std::vector<std::unique_ptr<DirectoryWatcher>> stoppedWatchers;
+	{
+		std::lock_guard lock(m_watchersMutex);
+		for (auto& watcher : m_watchers)
 		{
-			if (IsLatinChar(c))
+			if (watcher->GetDirPath() == dirPath)
 			{
-				currentWord += c;
-				continue;
+				stoppedWatchers.push_back(std::move(watcher));
 			}
+		}
+		std::erase(m_watchers, nullptr);
+	}
+}
+
+std::vector<std::unique_ptr<MtSearch::IndexShard>> MtSearch::CreateShards(const int threads, const ShardOptions& shardOptions)
+{
+	const auto count = std::max<size_t>(shardOptions.count, 1);
+	if (count > size_t{ 1 } << (64 - SHARD_DOC_ID_SHIFT))
+	{
+		throw std::invalid_argument("Too many shards");
+	}
+
+	// Потоки делятся между шардами поровну, но хотя бы один у каждого
+	const auto threadsPerShard = std::max(threads / static_cast<int>(count), 1);
+	const auto topology = shardOptions.pinToNumaNodes ? NumaTopology::Detect() : NumaTopology{};
+	std::vector<std::unique_ptr<IndexShard>> shards;
+	for (size_t shard = 0; shard < count; ++shard)
+	{
+		auto cpus = topology.nodeCpus.empty() ? std::vector<int>() : topology.nodeCpus[shard % topology.nodeCpus.size()];
+		shards.push_back(std::make_unique<IndexShard>(threadsPerShard, std::move(cpus), uint64_t{ shard } << SHARD_DOC_ID_SHIFT));
+	}
+	return shards;
+}
+
+size_t MtSearch::GetSegmentShard(const IndexSnapshot::SegmentView& view) const
+{
+	// Индекс мог быть сохранён с другим числом шардов: лишние диапазоны распределяются по кругу
+	return (view.segment->GetGlobalDocId(0) >> SHARD_DOC_ID_SHIFT) % m_shards.size();
+}
+
+size_t MtSearch::SelectShardForSegment(const IndexSnapshot& snapshot) const
+{
+	std::vector<size_t> docsCounts(m_shards.size());
+	for (const auto& view : snapshot.segments)
+	{
+		docsCounts[GetSegmentShard(view)] += view.GetLiveDocsCount();
+	}
+	return std::ranges::min_element(docsCounts) - docsCounts.begin();
+}
+
+std::vector<std::pair<size_t, size_t>> MtSearch::GetShardRuns(const IndexSnapshot& snapshot) const
+{
+	std::vector<std::pair<size_t, size_t>> runs;
+	for (size_t i = 0; i < snapshot.segments.size(); ++i)
+	{
+		if (runs.empty() || GetSegmentShard(snapshot.segments[i]) != GetSegmentShard(snapshot.segments[i - 1]))
+		{
+			runs.emplace_back(i, i + 1);
+		}
+		else
+		{
+			runs.back().second = i + 1;
+		}
+	}
+	return runs;
+}
 
-			if (currentWord.empty())
+void MtSearch::PublishSegment(const std::shared_ptr<Segment>& segment)
+{
+	if (segment->GetDocsCount() == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard lock(m_writeMutex);
+		const auto current = m_snapshot.load();
+		// Сегмент уходит в шард с наименьшим числом живых документов
+		auto& shard = *m_shards[SelectShardForSegment(*current)];
+		segment->AssignGlobalDocIds(shard.nextDocId);
+		shard.nextDocId += segment->GetDocsCount();
+
+		std::vector<uint64_t> replacedDocIds;
+		for (uint32_t localDocId = 0; localDocId < segment->GetDocsCount(); ++localDocId)
+		{
+			const auto docId = segment->GetGlobalDocId(localDocId);
+			const auto [it, inserted] = m_fileIds.try_emplace(std::string(segment->GetPath(localDocId)), docId);
+			if (!inserted)
 			{
-				continue;
+				replacedDocIds.push_back(std::exchange(it->second, docId));
 			}
-			InsertWord(wordsCountMap, currentWord);
-			++totalWordCount;
-			currentWord.clear();
 		}
-		if (!currentWord.empty())
+
+		auto snapshot = std::make_shared<IndexSnapshot>(*current);
+		const auto position = std::ranges::upper_bound(snapshot->segments, segment->GetGlobalDocId(0), {}, [](const IndexSnapshot::SegmentView& view) {
+			return view.segment->GetGlobalDocId(0);
+		});
+		snapshot->segments.insert(position, { segment, nullptr });
+		++snapshot->epoch;
+		DeleteDocuments(*snapshot, replacedDocIds);
+		m_snapshot.store(std::move(snapshot));
+	}
+	RequestMerge();
+}
+
+void MtSearch::DeleteDocuments(IndexSnapshot& snapshot, const std::vector<uint64_t>& docIds)
+{
+	std::unordered_map<size_t, std::shared_ptr<SegmentDeletes>> changedDeletes;
+
+	for (const auto docId : docIds)
+	{
+		const auto location = snapshot.FindDocument(docId);
+		if (!location)
+		{
+			continue;
+		}
+
+		auto& view = snapshot.segments[location->segmentIndex];
+		auto& deletes = changedDeletes[location->segmentIndex];
+		if (!deletes)
+		{
+			deletes = view.deletes != nullptr
+				? std::make_shared<SegmentDeletes>(*view.deletes)
+				: std::make_shared<SegmentDeletes>();
+			deletes->docs.resize(view.segment->GetDocsCount(), false);
+		}
+		if (deletes->docs[location->localDocId])
 		{
-			InsertWord(wordsCountMap, currentWord);
-			++totalWordCount;
+			continue;
+		}
+
+		deletes->docs[location->localDocId] = true;
+		++deletes->count;
+		deletes->length += view.segment->GetDocLength(location->localDocId);
+		for (const auto termOrdinal : view.segment->GetDocTerms(location->localDocId))
+		{
+			++deletes->termDocs[termOrdinal];
 		}
 	}
-	return totalWordCount;
+
+	for (auto& [segmentIndex, deletes] : changedDeletes)
+	{
+		snapshot.segments[segmentIndex].deletes = std::move(deletes);
+	}
 }
 
-void MtSearch::AddFileToIndex(const std::string& filePath)
+std::vector<MtSearch::WordData> MtSearch::GetWordsDataFromIndex(
+	const IndexSnapshot& snapshot,
+	CollectionStatistics& statistics,
+	const ScoringModel model,
+	const std::vector<std::string>& words)
 {
-	std::ifstream file(filePath);
-	if (!file.is_open())
+	std::vector<WordData> wordDataList;
+
+	for (size_t queryIndex = 0; queryIndex < words.size(); ++queryIndex)
 	{
-		std::cerr << "Cannot open file: " << filePath << std::endl;
-		return;
+		std::string result = words[queryIndex];
+
+		std::transform(result.begin(), result.end(), result.begin(), [](const unsigned char c) {
+			return std::tolower(c);
+		});
+
+		const auto idf = statistics.FindIdf(snapshot, model, result);
+		if (!idf)
+		{
+			continue;
+		}
+
+		WordData wordData{ wordDataList.size(), *idf, std::vector<std::optional<uint32_t>>(snapshot.segments.size()) };
+		for (size_t i = 0; i < snapshot.segments.size(); ++i)
+		{
+			wordData.segmentTerms[i] = snapshot.segments[i].segment->FindTerm(result);
+		}
+		wordDataList.push_back(std::move(wordData));
+	}
+	return wordDataList;
+}
+
+std::vector<std::string> MtSearch::ExpandTermPatterns(const IndexSnapshot& snapshot, const std::vector<std::string>& terms)
+{
+	std::vector<std::string> expandedTerms;
+	for (const auto& term : terms)
+	{
+		const auto pattern = TermPattern::Parse(term);
+		if (pattern.type == TermPattern::Type::Exact)
+		{
+			expandedTerms.push_back(pattern.text);
+			continue;
+		}
+
+		// Раскрытия сегментов объединяются; при слишком широком шаблоне остаются самые частые термины
+		std::unordered_map<std::string, uint64_t> termDocs;
+		for (const auto& view : snapshot.segments)
+		{
+			const auto& dictionary = view.segment->GetTermDictionary();
+			for (const auto termOrdinal : pattern.Expand(dictionary))
+			{
+				termDocs[dictionary.GetTerm(termOrdinal)] += view.segment->GetPostings(termOrdinal).GetSize();
+			}
+		}
+
+		std::vector<std::pair<std::string, uint64_t>> matches(termDocs.begin(), termDocs.end());
+		const auto matchesCount = std::min(matches.size(), MAX_TERM_EXPANSIONS);
+		const auto byDocsCount = [](const auto& left, const auto& right) {
+			return left.second != right.second ? left.second > right.second : left.first < right.first;
+		};
+		std::ranges::partial_sort(matches, matches.begin() + static_cast<std::ptrdiff_t>(matchesCount), byDocsCount);
+		for (size_t i = 0; i < matchesCount; ++i)
+		{
+			expandedTerms.push_back(std::move(matches[i].first));
+		}
 	}
+	return expandedTerms;
+}
 
-	auto docId = m_docIndex.fetch_add(1, std::memory_order_relaxed); // TODO почему memory_order_relaxed
+std::vector<std::pair<uint64_t, double>> MtSearch::FindMostRelevantDocIds(
+	const std::vector<std::string>& words,
+	const QueryAlgorithm algorithm)
+{
+	return FindRelevantDocIdsRange(words, 0, TOP_RESULTS_COUNT, algorithm);
+}
+
+MtSearch::FileInfo MtSearch::FindRelevantDocIdsRange(
+	const std::vector<std::string>& words,
+	const size_t from,
+	const size_t to,
+	const QueryAlgorithm algorithm)
+{
+	const auto depth = std::min(to, MAX_RESULTS_DEPTH);
+	if (from >= depth)
 	{
-		// TODO какое отношение порядка, и как операции связаны с
-		std::unique_lock lock(m_indexMutex);
-		m_files[docId] = filePath;
+		return {};
 	}
-	std::unordered_map<std::string, int> wordsCount;
-	auto totalWordCount = ReadWordsFromFile(file, wordsCount);
 
-	InvertIndex localUpdates;
-	for (const auto& [word, count] : wordsCount)
+	const auto rankedDocs = FindRankedDocs(words, depth, algorithm);
+	const auto& docs = rankedDocs->docs;
+	return { docs.begin() + std::min(from, docs.size()), docs.begin() + std::min(depth, docs.size()) };
+}
+
+QueryCache::Stats MtSearch::GetQueryCacheStats() const
+{
+	return m_queryCache.GetStats();
+}
+
+void MtSearch::SetScoringModel(const ScoringModel model)
+{
+	m_scoringModel.store(model);
+}
+
+void MtSearch::SetIndexPositions(const bool indexPositions)
+{
+	m_indexPositions.store(indexPositions);
+}
+
+void MtSearch::ClearQueryCache()
+{
+	m_queryCache.Clear();
+}
+
+std::shared_ptr<const QueryCache::RankedDocs> MtSearch::FindRankedDocs(
+	const std::vector<std::string>& words,
+	const size_t count,
+	const QueryAlgorithm algorithm)
+{
+	const auto snapshot = m_snapshot.load();
+	const auto model = m_scoringModel.load();
+	// Все алгоритмы дают одинаковую выдачу, поэтому алгоритм в ключ не входит
+	const auto terms = QueryCache::NormalizeTerms(words);
+	const auto key = QueryCache::MakeKey(model, terms);
+	if (auto cached = m_queryCache.Find(key, snapshot->epoch, count))
 	{
-		localUpdates[word].emplace_back(
-			docId,
-			static_cast<double>(count) / totalWordCount,
-			totalWordCount);
+		return cached;
 	}
 
-	std::unique_lock lock(m_indexMutex);
-	for (auto& [word, docs] : localUpdates)
+	const auto depth = std::min(std::max(count, CACHED_RESULTS_COUNT), MAX_RESULTS_DEPTH);
+	auto docs = ScoreQuery(*snapshot, terms, depth, algorithm, model);
+	const auto isComplete = docs.size() < depth;
+	auto rankedDocs = std::make_shared<const QueryCache::RankedDocs>(QueryCache::RankedDocs{ std::move(docs), isComplete });
+	m_queryCache.Insert(key, snapshot->epoch, rankedDocs);
+	return rankedDocs;
+}
+
+MtSearch::FileInfo MtSearch::ScoreQuery(
+	const IndexSnapshot& snapshot,
+	const std::vector<std::string>& terms,
+	const size_t top,
+	const QueryAlgorithm algorithm,
+	const ScoringModel model)
+{
+	const auto statistics = GetCollectionStatistics(snapshot);
+	const auto wordDataList = GetWordsDataFromIndex(snapshot, *statistics, model, ExpandTermPatterns(snapshot, terms));
+	if (wordDataList.empty())
 	{
-		auto& targetList = m_invertIndex[word]; // TODO нужно сделать эффективное удаление
-		targetList.insert(
-			targetList.end(),
-			std::make_move_iterator(docs.begin()),
-			std::make_move_iterator(docs.end())); // TODO сравнить через бенчмарк этот подход с более гранулярным блоком
+		return {};
 	}
+
+	// Порог k-го результата общий для всех диапазонов и шардов: найденное в одном помогает отсекать в остальных
+	std::atomic<double> sharedThreshold = -std::numeric_limits<double>::infinity();
+
+	return ScatterRanges(snapshot, SplitIntoScoreRanges(snapshot), [&](const ScoreRange& range) {
+		const auto& segment = snapshot.segments[range.segmentIndex].segment;
+		const auto lengthNorms = model == ScoringModel::Bm25 ? statistics->GetLengthNorms(segment) : nullptr;
+		const ScoreFunction scoreFunction(model,
+			segment->GetDocLengths(),
+			lengthNorms != nullptr ? std::span<const float>(*lengthNorms) : std::span<const float>(),
+			statistics->GetAverageDocLength());
+
+		return algorithm == QueryAlgorithm::Exhaustive
+			? ScoreDocRange(snapshot, wordDataList, range, scoreFunction, top)
+			: PruneDocRange(snapshot, wordDataList, range, scoreFunction, top, algorithm, sharedThreshold);
+	}, top);
 }
 
-void MtSearch::AddDirToIndex(const std::string& dirPath, const bool recursively)
+MtSearch::FileInfo MtSearch::FindPhraseDocIds(
+	const std::vector<std::string>& words,
+	const PhraseMatcher::Mode mode,
+	const uint32_t maxDistance)
 {
-	MtProcessDirectory(
-		dirPath,
-		[this](const std::string& filePath) {
-			AddFileToIndex(filePath);
-		},
-		recursively);
+	const auto snapshot = m_snapshot.load();
+	const auto model = m_scoringModel.load();
+	const auto statistics = GetCollectionStatistics(*snapshot);
+	const auto wordDataList = GetWordsDataFromIndex(*snapshot, *statistics, model, words);
+	// Слово, которого нет в индексе, не даёт совпасть ни фразе, ни окну
+	if (wordDataList.empty() || wordDataList.size() < words.size())
+	{
+		return {};
+	}
+
+	return MatchRanges(*snapshot, *statistics, model, [&](const ScoreRange& range, const ScoreFunction& scoreFunction) {
+		return MatchDocRange(*snapshot, wordDataList, range, scoreFunction, mode, maxDistance);
+	});
 }
 
-std::vector<MtSearch::WordData> MtSearch::GetWordsDataFromIndex(const std::vector<std::string>& words)
+MtSearch::FileInfo MtSearch::FindBooleanDocIds(const std::string& queryText)
 {
+	const auto query = BooleanQuery::Parse(queryText);
+	const auto snapshot = m_snapshot.load();
+	const auto model = m_scoringModel.load();
+	const auto statistics = GetCollectionStatistics(*snapshot);
+
+	// В отличие от обычного поиска отсутствующие слова не выбрасываются: от них зависит смысл AND и NOT
 	std::vector<WordData> wordDataList;
+	for (const auto& term : query.GetTerms())
+	{
+		WordData wordData{ wordDataList.size(),
+			statistics->FindIdf(*snapshot, model, term).value_or(0.0),
+			std::vector<std::optional<uint32_t>>(snapshot->segments.size()) };
+		for (size_t i = 0; i < snapshot->segments.size(); ++i)
+		{
+			wordData.segmentTerms[i] = snapshot->segments[i].segment->FindTerm(term);
+		}
+		wordDataList.push_back(std::move(wordData));
+	}
+
+	return MatchRanges(*snapshot, *statistics, model, [&](const ScoreRange& range, const ScoreFunction& scoreFunction) {
+		return MatchBooleanRange(*snapshot, query, wordDataList, range, scoreFunction);
+	});
+}
 
-	std::shared_lock readLock(m_indexMutex);
-	const auto totalDocsCount = m_files.size();
+MtSearch::FileInfo MtSearch::MatchRanges(
+	const IndexSnapshot& snapshot,
+	CollectionStatistics& statistics,
+	const ScoringModel model,
+	const RangeMatcher& matchRange)
+{
+	return ScatterRanges(snapshot, SplitIntoScoreRanges(snapshot), [&](const ScoreRange& range) {
+		const auto& segment = snapshot.segments[range.segmentIndex].segment;
+		const auto lengthNorms = model == ScoringModel::Bm25 ? statistics.GetLengthNorms(segment) : nullptr;
+		const ScoreFunction scoreFunction(model,
+			segment->GetDocLengths(),
+			lengthNorms != nullptr ? std::span<const float>(*lengthNorms) : std::span<const float>(),
+			statistics.GetAverageDocLength());
+
+		return matchRange(range, scoreFunction);
+	}, TOP_RESULTS_COUNT);
+}
 
-	for (const auto& word : words)
+std::shared_ptr<CollectionStatistics> MtSearch::GetCollectionStatistics(const IndexSnapshot& snapshot)
+{
+	auto statistics = m_statistics.load();
+	if (statistics == nullptr || statistics->GetEpoch() != snapshot.epoch)
 	{
-		std::string result = word;
+		statistics = std::make_shared<CollectionStatistics>(snapshot);
+		m_statistics.store(statistics);
+	}
+	return statistics;
+}
 
-		std::transform(result.begin(), result.end(), result.begin(), [](const unsigned char c) {
-			return std::tolower(c);
+std::vector<MtSearch::ScoreRange> MtSearch::SplitIntoScoreRanges(const IndexSnapshot& snapshot) const
+{
+	size_t docsCount = 0;
+	for (const auto& view : snapshot.segments)
+	{
+		docsCount += view.segment->GetDocsCount();
+	}
+	const auto rangeSize = std::max<size_t>(MIN_DOCS_PER_PARTITION, (docsCount + m_threads - 1) / m_threads);
+
+	std::vector<ScoreRange> ranges;
+	for (size_t segmentIndex = 0; segmentIndex < snapshot.segments.size(); ++segmentIndex)
+	{
+		const auto segmentDocsCount = snapshot.segments[segmentIndex].segment->GetDocsCount();
+		for (size_t first = 0; first < segmentDocsCount; first += rangeSize)
+		{
+			ranges.push_back({ segmentIndex,
+				static_cast<uint32_t>(first),
+				static_cast<uint32_t>(std::min(first + rangeSize, segmentDocsCount)) });
+		}
+	}
+	return ranges;
+}
+
+MtSearch::FileInfo MtSearch::ScatterRanges(
+	const IndexSnapshot& snapshot,
+	const std::vector<ScoreRange>& ranges,
+	const std::function<FileInfo(const ScoreRange& range)>& matchRange,
+	const size_t top)
+{
+	// Диапазоны выполняются в пулах своих шардов; шарды отбирают лучшие у себя, затем их выдачи сливаются
+	std::vector<FileInfo> partitionTops(ranges.size());
+	std::vector<size_t> partitionShards(ranges.size());
+	std::vector<std::unique_ptr<ThreadPool::TaskGroup>> shardGroups(m_shards.size());
+	for (size_t partition = 0; partition < ranges.size(); ++partition)
+	{
+		const auto shard = GetSegmentShard(snapshot.segments[ranges[partition].segmentIndex]);
+		partitionShards[partition] = shard;
+		if (shardGroups[shard] == nullptr)
+		{
+			shardGroups[shard] = std::make_unique<ThreadPool::TaskGroup>(m_shards[shard]->pool);
+		}
+		shardGroups[shard]->Run([&, partition] {
+			partitionTops[partition] = matchRange(ranges[partition]);
 		});
+	}
+	for (const auto& group : shardGroups)
+	{
+		if (group != nullptr)
+		{
+			group->Wait();
+		}
+	}
+
+	std::vector<std::vector<FileInfo>> shardPartitionTops(m_shards.size());
+	for (size_t partition = 0; partition < ranges.size(); ++partition)
+	{
+		shardPartitionTops[partitionShards[partition]].push_back(std::move(partitionTops[partition]));
+	}
+	std::vector<FileInfo> shardTops;
+	for (const auto& tops : shardPartitionTops)
+	{
+		shardTops.push_back(MergeTopItems(tops, top));
+	}
+	return MergeShardTops(shardTops, top);
+}
+
+MtSearch::FileInfo MtSearch::ScoreDocRange(
+	const IndexSnapshot& snapshot,
+	const std::vector<WordData>& wordDataList,
+	const ScoreRange& range,
+	const ScoreFunction& scoreFunction,
+	const size_t top)
+{
+	const auto& view = snapshot.segments[range.segmentIndex];
+	const auto& segment = *view.segment;
+
+	std::vector<double> scores(range.lastDocId - range.firstDocId, 0.0);
+	std::vector<uint8_t> isMatched(range.lastDocId - range.firstDocId, 0);
+	std::array<double, PostingList::BLOCK_SIZE> contributions{};
+
+	for (const auto& wordData : wordDataList)
+	{
+		const auto termOrdinal = wordData.segmentTerms[range.segmentIndex];
+		if (!termOrdinal)
+		{
+			continue;
+		}
+
+		// Удалённые документы отбрасываются при отборе, чтобы внутренний цикл обходился без ветвлений
+		segment.GetPostings(*termOrdinal).ForEachBlockInRange(range.firstDocId, range.lastDocId, [&](const PostingList::Block& block) {
+			scoreFunction.ScoreBlock(block, wordData.idf, contributions);
+			for (size_t i = 0; i < block.count; ++i)
+			{
+				const auto offset = block.docIds[i] - range.firstDocId;
+				scores[offset] += contributions[i];
+				isMatched[offset] = 1;
+			}
+		});
+	}
 
-		if (auto it = m_invertIndex.find(result); it != m_invertIndex.end())
+	// Куча не вырастает больше диапазона, даже если запрошено больше документов
+	std::vector<ScoredDoc> heap;
+	heap.reserve(std::min(top, scores.size()));
+	for (uint32_t offset = 0; offset < scores.size(); ++offset)
+	{
+		if (!isMatched[offset] || view.IsDeleted(range.firstDocId + offset))
+		{
+			continue;
+		}
+		const ScoredDoc candidate{ segment.GetGlobalDocId(range.firstDocId + offset), scores[offset] };
+		if (heap.size() < top)
 		{
-			const auto docsWithTermCount = it->second.size();
-			wordDataList.push_back({ std::log(static_cast<double>(totalDocsCount) / docsWithTermCount),
-				it->second });
+			heap.push_back(candidate);
+			std::ranges::push_heap(heap, IsMoreRelevant);
+		}
+		else if (!heap.empty() && IsMoreRelevant(candidate, heap.front()))
+		{
+			std::ranges::pop_heap(heap, IsMoreRelevant);
+			heap.back() = candidate;
+			std::ranges::push_heap(heap, IsMoreRelevant);
 		}
 	}
-	return wordDataList;
+	return heap;
 }
 
-std::vector<std::pair<uint64_t, double>> MtSearch::FindMostRelevantDocIds(const std::vector<std::string>& words)
+MtSearch::FileInfo MtSearch::PruneDocRange(
+	const IndexSnapshot& snapshot,
+	const std::vector<WordData>& wordDataList,
+	const ScoreRange& range,
+	const ScoreFunction& scoreFunction,
+	const size_t top,
+	const QueryAlgorithm algorithm,
+	std::atomic<double>& sharedThreshold)
 {
-	const auto wordDataList = GetWordsDataFromIndex(words);
+	const auto& view = snapshot.segments[range.segmentIndex];
+	const auto& segment = *view.segment;
 
-	std::unordered_map<uint64_t, double> fileRelevant;
-	std::mutex relevantMutex;
-	boost::asio::thread_pool threadPool(m_threads);
+	std::vector<DocAtATimeScorer::Term> terms;
+	for (const auto& wordData : wordDataList)
+	{
+		if (const auto termOrdinal = wordData.segmentTerms[range.segmentIndex])
+		{
+			terms.push_back({ wordData.queryIndex,
+				wordData.idf,
+				segment.GetPostings(*termOrdinal),
+				segment.GetMaxTermFrequency(*termOrdinal),
+				segment.GetBlockMaxTermFrequencies(*termOrdinal) });
+		}
+	}
+
+	DocAtATimeScorer scorer(view, scoreFunction, wordDataList.size(), top, sharedThreshold);
+	return scorer.Score(terms, range.firstDocId, range.lastDocId, algorithm);
+}
+
+MtSearch::FileInfo MtSearch::MatchDocRange(
+	const IndexSnapshot& snapshot,
+	const std::vector<WordData>& wordDataList,
+	const ScoreRange& range,
+	const ScoreFunction& scoreFunction,
+	const PhraseMatcher::Mode mode,
+	const uint32_t maxDistance)
+{
+	const auto& view = snapshot.segments[range.segmentIndex];
 
-	// TODO тредпул, возможно, лучше прикрутить снаружи
+	std::vector<uint32_t> termOrdinals;
 	for (const auto& wordData : wordDataList)
 	{
-		for (const auto& doc : wordData.docs)
+		const auto termOrdinal = wordData.segmentTerms[range.segmentIndex];
+		if (!termOrdinal)
 		{
-			boost::asio::post(threadPool, [&fileRelevant, &relevantMutex, wordData, doc]() { // TODO либо в один поток, либо разбить на более крупные крупные
-				const double wordRelevant = doc.termFrequency * wordData.idf;
+			return {};
+		}
+		termOrdinals.push_back(*termOrdinal);
+	}
 
-				std::unique_lock lock(relevantMutex);
-				fileRelevant[doc.docId] += wordRelevant;
-			});
+	FileInfo matches;
+	PhraseMatcher matcher(view, termOrdinals, mode, maxDistance);
+	// Релевантность совпадения та же, что у обычного поиска по этим словам
+	matcher.ForEachMatch(range.firstDocId, range.lastDocId, [&](const uint32_t localDocId, const std::span<const uint32_t> termCounts) {
+		double score = 0;
+		for (size_t i = 0; i < termCounts.size(); ++i)
+		{
+			score += scoreFunction.GetContribution(termCounts[i], localDocId, wordDataList[i].idf);
 		}
+		matches.emplace_back(view.segment->GetGlobalDocId(localDocId), score);
+	});
+	return matches;
+}
+
+MtSearch::FileInfo MtSearch::MatchBooleanRange(
+	const IndexSnapshot& snapshot,
+	const BooleanQuery& query,
+	const std::vector<WordData>& wordDataList,
+	const ScoreRange& range,
+	const ScoreFunction& scoreFunction)
+{
+	const auto& view = snapshot.segments[range.segmentIndex];
+
+	std::vector<std::optional<uint32_t>> termOrdinals;
+	for (const auto& wordData : wordDataList)
+	{
+		termOrdinals.push_back(wordData.segmentTerms[range.segmentIndex]);
 	}
-	threadPool.join();
 
-	return GetTopMapItems(fileRelevant, 10);
+	FileInfo matches;
+	BooleanMatcher matcher(view, query, termOrdinals);
+	matcher.ForEachMatch(range.firstDocId, range.lastDocId, [&](const uint32_t localDocId, const std::span<const uint32_t> termCounts) {
+		double score = 0;
+		for (size_t i = 0; i < termCounts.size(); ++i)
+		{
+			if (termCounts[i] > 0)
+			{
+				score += scoreFunction.GetContribution(termCounts[i], localDocId, wordDataList[i].idf);
+			}
+		}
+		matches.emplace_back(view.segment->GetGlobalDocId(localDocId), score);
+	});
+	return matches;
 }
 
-std::vector<std::pair<uint64_t, double>> GetTopMapItems(
-	const std::unordered_map<uint64_t, double>& inputMap,
-	const int top)
+MtSearch::FileInfo MtSearch::MergeTopItems(const std::vector<FileInfo>& partitionTops, const size_t top)
 {
-	std::vector<std::pair<uint64_t, double>> pairs(inputMap.begin(), inputMap.end());
-	const auto n = std::min<size_t>(top, pairs.size());
+	FileInfo result;
+	for (const auto& partitionTop : partitionTops)
+	{
+		result.insert(result.end(), partitionTop.begin(), partitionTop.end());
+	}
 
-	std::partial_sort(
-		pairs.begin(),
-		pairs.begin() + n,
-		pairs.end(),
-		[](const auto& a, const auto& b) {
-			return a.second > b.second;
-		});
+	const auto n = std::min(top, result.size());
+	std::partial_sort(result.begin(), result.begin() + n, result.end(), IsMoreRelevant);
+	result.resize(n);
+	return result;
+}
+
+MtSearch::FileInfo MtSearch::MergeShardTops(const std::vector<FileInfo>& shardTops, const size_t top)
+{
+	// Выдачи шардов уже упорядочены, поэтому достаточно k-путевого слияния по их началам
+	using Cursor = std::pair<size_t, size_t>;
+	auto isLessRelevant = [&shardTops](const Cursor& a, const Cursor& b) {
+		return IsMoreRelevant(shardTops[b.first][b.second], shardTops[a.first][a.second]);
+	};
+	std::priority_queue<Cursor, std::vector<Cursor>, decltype(isLessRelevant)> heads(isLessRelevant);
+	for (size_t shard = 0; shard < shardTops.size(); ++shard)
+	{
+		if (!shardTops[shard].empty())
+		{
+			heads.emplace(shard, 0);
+		}
+	}
 
-	if (pairs.size() > n)
+	FileInfo result;
+	while (!heads.empty() && result.size() < top)
 	{
-		pairs.resize(n);
+		const auto [shard, position] = heads.top();
+		heads.pop();
+		result.push_back(shardTops[shard][position]);
+		if (position + 1 < shardTops[shard].size())
+		{
+			heads.emplace(shard, position + 1);
+		}
 	}
-	return pairs;
+	return result;
 }
 
 void MtSearch::PrintFilesRelevantInfo(const std::vector<std::pair<uint64_t, double>>& filesRelevantInfo)
 {
+	const auto snapshot = m_snapshot.load();
 	int n = 1;
 	for (const auto& [docId, relevant] : filesRelevantInfo)
 	{
-		std::shared_lock lock(m_indexMutex);
-		auto fileUrl = m_files[docId];
+		const auto location = snapshot->FindDocument(docId);
+		const auto fileUrl = location
+			? std::string(snapshot->segments[location->segmentIndex].segment->GetPath(location->localDocId))
+			: std::string();
 		m_output << n << ". " << "id: " << docId << ", relevance: " << relevant << ", path: " << fileUrl << std::endl;
 		n++;
 	}
@@ -306,32 +1106,131 @@ void MtSearch::PrintFilesRelevantInfo(const std::vector<std::pair<uint64_t, doub
 
 void MtSearch::PrintAllFiles()
 {
+	const auto snapshot = m_snapshot.load();
 	int n = 1;
-	std::shared_lock lock(m_indexMutex);
-	for (const auto& [docId, file] : m_files)
+	for (const auto& view : snapshot->segments)
 	{
-		m_output << n << ") id: " << docId << ", path: " << file << std::endl;
-		++n;
+		for (uint32_t localDocId = 0; localDocId < view.segment->GetDocsCount(); ++localDocId)
+		{
+			if (view.IsDeleted(localDocId))
+			{
+				continue;
+			}
+			m_output << n << ") id: " << view.segment->GetGlobalDocId(localDocId) << ", path: " << view.segment->GetPath(localDocId) << std::endl;
+			++n;
+		}
 	}
 }
 
 void MtSearch::PrintIndexInfo()
 {
+	const auto snapshot = m_snapshot.load();
+	std::map<std::string, std::vector<uint64_t>> index;
+	for (const auto& view : snapshot->segments)
+	{
+		for (TermDictionary::Iterator it(view.segment->GetTermDictionary(), 0); it.IsValid(); it.Next())
+		{
+			auto& docIds = index[std::string(it.GetTerm())];
+			view.segment->GetPostings(it.GetOrdinal()).ForEach([&](const uint64_t localDocId, uint32_t) {
+				if (!view.IsDeleted(localDocId))
+				{
+					docIds.push_back(view.segment->GetGlobalDocId(localDocId));
+				}
+			});
+		}
+	}
+
 	int n = 1;
-	std::shared_lock lock(m_indexMutex);
-	for (const auto& [word, fileInfo] : m_invertIndex)
+	for (const auto& [word, docIds] : index)
 	{
+		if (docIds.empty())
+		{
+			continue;
+		}
 		m_output << n << ") word: " << word << " [";
-
-		for (const auto& file : fileInfo)
+		for (const auto docId : docIds)
 		{
-			m_output << file.docId << ", ";
+			m_output << docId << ", ";
 		}
 		m_output << "]" << std::endl;
 		n++;
 	}
 }
 
+void MtSearch::PrintIndexStats()
+{
+	const auto snapshot = m_snapshot.load();
+
+	size_t postingsCount = 0;
+	size_t deletedDocsCount = 0;
+	size_t indexMemory = 0;
+	size_t termDictionaryMemory = 0;
+	std::unordered_set<std::string> terms;
+	for (const auto& view : snapshot->segments)
+	{
+		const auto& termDictionary = view.segment->GetTermDictionary();
+		for (TermDictionary::Iterator it(termDictionary, 0); it.IsValid(); it.Next())
+		{
+			terms.emplace(it.GetTerm());
+			postingsCount += view.segment->GetPostings(it.GetOrdinal()).GetSize();
+		}
+		deletedDocsCount += view.deletes != nullptr ? view.deletes->count : 0;
+		indexMemory += view.segment->GetMemoryUsage();
+		termDictionaryMemory += termDictionary.GetMemoryUsage();
+	}
+
+	m_output << "documents: " << snapshot->GetLiveDocsCount() << std::endl;
+	m_output << "segments: " << snapshot->segments.size() << std::endl;
+	std::vector<std::pair<size_t, size_t>> shardSizes(m_shards.size());
+	for (const auto& view : snapshot->segments)
+	{
+		auto& [segmentsCount, docsCount] = shardSizes[GetSegmentShard(view)];
+		++segmentsCount;
+		docsCount += view.GetLiveDocsCount();
+	}
+	for (size_t shard = 0; shard < shardSizes.size(); ++shard)
+	{
+		m_output << "shard " << shard << ": segments " << shardSizes[shard].first
+				 << ", documents " << shardSizes[shard].second
+				 << ", threads " << m_shards[shard]->pool.GetThreadCount()
+				 << ", cpus " << m_shards[shard]->cpus.size() << std::endl;
+	}
+	m_output << "terms: " << terms.size() << std::endl;
+	m_output << "postings: " << postingsCount << std::endl;
+	m_output << "deleted documents: " << deletedDocsCount << std::endl;
+	m_output << "index bytes: " << indexMemory << std::endl;
+	m_output << "term dictionary bytes: " << termDictionaryMemory << std::endl;
+
+	const auto cacheStats = m_queryCache.GetStats();
+	m_output << "query cache hits: " << cacheStats.hits << std::endl;
+	m_output << "query cache misses: " << cacheStats.misses << std::endl;
+	m_output << "query cache entries: " << cacheStats.entriesCount << std::endl;
+	m_output << "query cache bytes: " << cacheStats.memoryUsage << std::endl;
+}
+
+void MtSearch::PrintIngestStats()
+{
+	const auto stats = GetIngestStats();
+	const auto wallSeconds = std::max(stats.wallSeconds, std::numeric_limits<double>::min());
+	m_output << "ingest seconds: " << stats.wallSeconds << std::endl;
+	for (const auto& stage : stats.stages)
+	{
+		m_output << "stage " << stage.name << ": workers " << stage.workers
+				 << ", items " << stage.items
+				 << ", items/s " << static_cast<double>(stage.items) / wallSeconds
+				 << ", MB/s " << static_cast<double>(stage.bytes) / wallSeconds / (1 << 20)
+				 << ", busy seconds " << stage.busySeconds << std::endl;
+	}
+	for (const auto& [name, queue] : stats.queues)
+	{
+		m_output << "queue " << name << ": capacity " << queue.capacity
+				 << ", max depth " << queue.maxDepth
+				 << ", average depth " << queue.averageDepth
+				 << ", push wait seconds " << queue.pushWaitSeconds
+				 << ", pop wait seconds " << queue.popWaitSeconds << std::endl;
+	}
+}
+
 void MtSearch::ProcessFindBatch(const std::string& fileUrl)
 {
 	std::ifstream file(fileUrl);
@@ -343,14 +1242,15 @@ void MtSearch::ProcessFindBatch(const std::string& fileUrl)
 
 	int queryNum = 0;
 	std::string line;
-	boost::asio::thread_pool threadPool(m_threads);
+	// Запросы пачки раздаёт пул первого шарда, а каждый запрос всё равно рассылается по всем шардам
+	ThreadPool::TaskGroup queries(m_shards.front()->pool);
 
 	while (std::getline(file, line))
 	{
 		auto words = SplitBySpaces(line);
 		queryNum++;
 
-		boost::asio::post(threadPool, [this, words, queryNum, line]() {
+		queries.Run([this, words, queryNum, line]() {
 			const auto startTime = std::chrono::high_resolution_clock::now();
 			const auto filesInfo = FindMostRelevantDocIds(words);
 			const auto endTime = std::chrono::high_resolution_clock::now();
@@ -361,81 +1261,291 @@ void MtSearch::ProcessFindBatch(const std::string& fileUrl)
 			PrintFilesRelevantInfo(filesInfo);
 		});
 	}
-	threadPool.join();
+	queries.Wait();
 }
 
-uint64_t MtSearch::GetFileIdByUrl(const std::string& fileUrl)
+void MtSearch::SaveIndex(const std::string& indexPath)
 {
-	std::shared_lock lock(m_indexMutex);
-	for (const auto& [docId, file] : m_files)
+	const auto snapshot = m_snapshot.load();
+
+	// По сегменту на шард: диапазоны идентификаторов шардов сохраняются и при загрузке
+	std::vector<std::shared_ptr<const Segment>> segments;
+	for (const auto& [first, last] : GetShardRuns(*snapshot))
 	{
-		if (file == fileUrl)
+		if (last - first == 1 && snapshot->segments[first].deletes == nullptr)
+		{
+			segments.push_back(snapshot->segments[first].segment);
+			continue;
+		}
+		std::vector<Segment::MergePart> parts;
+		for (size_t i = first; i < last; ++i)
 		{
-			return docId;
+			parts.push_back({ snapshot->segments[i].segment.get(), snapshot->segments[i].deletes.get() });
+		}
+		if (auto merged = Segment::Merge(parts); merged->GetDocsCount() > 0)
+		{
+			segments.push_back(std::move(merged));
 		}
 	}
-	throw std::invalid_argument("File does not exist");
+
+	IndexFile::Save(indexPath, segments);
+}
+
+void MtSearch::LoadIndex(const std::string& indexPath)
+{
+	const auto segments = IndexFile::Load(indexPath);
+
+	auto snapshot = std::make_shared<IndexSnapshot>();
+	std::unordered_map<std::string, uint64_t> fileIds;
+	std::vector<uint64_t> nextDocIds;
+	for (size_t shard = 0; shard < m_shards.size(); ++shard)
+	{
+		nextDocIds.push_back(uint64_t{ shard } << SHARD_DOC_ID_SHIFT);
+	}
+	uint64_t minDocId = 0;
+	for (const auto& segment : segments)
+	{
+		if (segment->GetDocsCount() == 0)
+		{
+			continue;
+		}
+		if (segment->GetGlobalDocId(0) < minDocId)
+		{
+			throw std::runtime_error("Corrupted index data");
+		}
+		for (uint32_t localDocId = 0; localDocId < segment->GetDocsCount(); ++localDocId)
+		{
+			fileIds.insert_or_assign(std::string(segment->GetPath(localDocId)), segment->GetGlobalDocId(localDocId));
+		}
+		minDocId = segment->GetLastGlobalDocId() + 1;
+		// Новые документы шарда получают идентификаторы после уже загруженных из его диапазона
+		if (const auto shard = segment->GetLastGlobalDocId() >> SHARD_DOC_ID_SHIFT; shard < nextDocIds.size())
+		{
+			nextDocIds[shard] = std::max(nextDocIds[shard], minDocId);
+		}
+		snapshot->segments.push_back({ segment, nullptr });
+	}
+
+	std::lock_guard mergeLock(m_mergeMutex);
+	std::lock_guard lock(m_writeMutex);
+	m_fileIds = std::move(fileIds);
+	for (size_t shard = 0; shard < m_shards.size(); ++shard)
+	{
+		m_shards[shard]->nextDocId = nextDocIds[shard];
+	}
+	snapshot->epoch = m_snapshot.load()->epoch + 1;
+	m_snapshot.store(std::move(snapshot));
+}
+
+uint64_t MtSearch::GetFileIdByUrl(const std::string& fileUrl)
+{
+	std::lock_guard lock(m_writeMutex);
+	const auto it = m_fileIds.find(fileUrl);
+	if (it == m_fileIds.end())
+	{
+		throw std::invalid_argument("File does not exist");
+	}
+	return it->second;
 }
 
 void MtSearch::RemoveFileFromIndex(const std::string& fileUrl)
 {
-	std::unique_lock lock(m_indexMutex);
+	RemoveFilesFromIndex({ fileUrl });
+}
+
+void MtSearch::RemoveDirFromIndex(const std::string& dirPath, const bool recursively)
+{
+	RemoveFilesFromIndex(ListDirectoryFiles(dirPath, recursively));
+}
 
-	uint64_t docId = 0;
-	for (const auto& [id, file] : m_files)
+void MtSearch::RemoveFilesFromIndex(const std::vector<std::string>& fileUrls)
+{
 	{
-		if (file == fileUrl)
+		std::lock_guard lock(m_writeMutex);
+
+		std::vector<uint64_t> docIds;
+		for (const auto& fileUrl : fileUrls)
 		{
-			docId = id;
-			break;
+			const auto it = m_fileIds.find(fileUrl);
+			if (it == m_fileIds.end())
+			{
+				std::cerr << "File is not indexed: " << fileUrl << std::endl;
+				continue;
+			}
+			docIds.push_back(it->second);
+			m_fileIds.erase(it);
+		}
+		if (docIds.empty())
+		{
+			return;
 		}
+
+		auto snapshot = std::make_shared<IndexSnapshot>(*m_snapshot.load());
+		DeleteDocuments(*snapshot, docIds);
+		++snapshot->epoch;
+		m_snapshot.store(std::move(snapshot));
 	}
-	m_files.erase(docId);
+	RequestMerge();
+}
 
-	for (auto it = m_invertIndex.begin(); it != m_invertIndex.end();)
+std::optional<std::pair<size_t, size_t>> MtSearch::SelectSegmentsToMerge(const IndexSnapshot& snapshot) const
+{
+	const auto& segments = snapshot.segments;
+	for (size_t i = 0; i < segments.size(); ++i)
 	{
-		auto& files = it->second;
+		const auto docsCount = segments[i].segment->GetDocsCount();
+		if (segments[i].deletes != nullptr && segments[i].deletes->count >= docsCount * MAX_DELETED_DOCS_RATIO)
+		{
+			return std::pair{ i, i + 1 };
+		}
+	}
+
+	auto getTier = [](const IndexSnapshot::SegmentView& view) {
+		int tier = 0;
+		for (auto docsCount = view.GetLiveDocsCount() / MIN_SEGMENT_DOCS; docsCount >= MERGE_FACTOR; docsCount /= MERGE_FACTOR)
+		{
+			++tier;
+		}
+		return tier;
+	};
+
+	// Сливаются только сегменты одного шарда, иначе шарды перестанут лежать в снимке подряд
+	for (size_t first = 0; first + MERGE_FACTOR <= segments.size(); ++first)
+	{
+		const auto tier = getTier(segments[first]);
+		const auto shard = GetSegmentShard(segments[first]);
+		const auto last = first + MERGE_FACTOR;
+		if (std::all_of(segments.begin() + first + 1, segments.begin() + last, [&](const auto& view) {
+				return getTier(view) == tier && GetSegmentShard(view) == shard;
+			}))
+		{
+			return std::pair{ first, last };
+		}
+	}
+	return std::nullopt;
+}
+
+void MtSearch::MergeSegments(const bool mergeAll)
+{
+	std::lock_guard mergeLock(m_mergeMutex);
+
+	if (mergeAll)
+	{
+		// Каждый шард сжимается в свой сегмент
+		const auto snapshot = m_snapshot.load();
+		for (const auto& range : GetShardRuns(*snapshot))
+		{
+			if (range.second - range.first > 1 || snapshot->segments[range.first].deletes != nullptr)
+			{
+				MergeSegmentRange(*snapshot, range);
+			}
+		}
+		return;
+	}
+
+	while (true)
+	{
+		const auto snapshot = m_snapshot.load();
+		const auto range = SelectSegmentsToMerge(*snapshot);
+		if (!range)
+		{
+			return;
+		}
+		MergeSegmentRange(*snapshot, *range);
+	}
+}
 
-		std::erase_if(files, [docId](const DocInfo& docInfo) {
-			return docInfo.docId == docId;
+void MtSearch::MergeSegmentRange(const IndexSnapshot& snapshot, const std::pair<size_t, size_t> range)
+{
+	const std::vector views(snapshot.segments.begin() + range.first, snapshot.segments.begin() + range.second);
+	std::vector<Segment::MergePart> parts;
+	for (const auto& view : views)
+	{
+		parts.push_back({ view.segment.get(), view.deletes.get() });
+	}
+
+	// У привязанного шарда слияние идёт в его пуле, и память нового сегмента выделяется на его NUMA-узле
+	std::shared_ptr<Segment> merged;
+	if (auto& shard = *m_shards[GetSegmentShard(views.front())]; !shard.cpus.empty())
+	{
+		ThreadPool::TaskGroup merge(shard.pool);
+		merge.Run([&] {
+			merged = Segment::Merge(parts);
 		});
+		merge.Wait();
+	}
+	else
+	{
+		merged = Segment::Merge(parts);
+	}
+
+	std::lock_guard lock(m_writeMutex);
+	auto current = std::make_shared<IndexSnapshot>(*m_snapshot.load());
+	const auto first = std::ranges::find(current->segments, views.front().segment, &IndexSnapshot::SegmentView::segment)
+		- current->segments.begin();
 
-		if (files.empty())
+	std::vector<uint64_t> lateDeletedDocIds;
+	for (size_t i = 0; i < views.size(); ++i)
+	{
+		const auto& before = views[i];
+		const auto& after = current->segments[first + i];
+		if (before.deletes == after.deletes)
 		{
-			it = m_invertIndex.erase(it);
+			continue;
 		}
-		else
+		for (uint32_t localDocId = 0; localDocId < before.segment->GetDocsCount(); ++localDocId)
 		{
-			++it;
+			if (after.IsDeleted(localDocId) && !before.IsDeleted(localDocId))
+			{
+				lateDeletedDocIds.push_back(before.segment->GetGlobalDocId(localDocId));
+			}
 		}
 	}
+
+	const auto begin = current->segments.begin() + first;
+	const auto it = current->segments.erase(begin, begin + static_cast<std::ptrdiff_t>(views.size()));
+	if (merged->GetDocsCount() > 0)
+	{
+		current->segments.insert(it, { merged, nullptr });
+	}
+	DeleteDocuments(*current, lateDeletedDocIds);
+	m_snapshot.store(std::move(current));
 }
 
-void MtSearch::RemoveDirFromIndex(const std::string& dirPath, const bool recursively)
+void MtSearch::RequestMerge()
 {
-	MtProcessDirectory(
-		dirPath,
-		[this](const std::string& filePath) {
-			RemoveFileFromIndex(filePath);
-		},
-		recursively);
+	std::lock_guard lock(m_mergeRequestMutex);
+	m_mergeRequested = true;
+	m_cvMergeRequested.notify_one();
 }
 
-void MtSearch::MtProcessDirectory(
-	const std::string& dirPath,
-	std::function<void(const std::string&)> callback,
-	const bool recursively) const
+void MtSearch::MergeLoop(const std::stop_token& stopToken)
 {
-	boost::asio::thread_pool threadPool(m_threads);
+	while (!stopToken.stop_requested())
+	{
+		{
+			std::unique_lock lock(m_mergeRequestMutex);
+			m_cvMergeRequested.wait_for(lock, stopToken, MERGE_INTERVAL, [this] {
+				return m_mergeRequested;
+			});
+			m_mergeRequested = false;
+		}
+		if (!stopToken.stop_requested())
+		{
+			MergeSegments(false);
+		}
+	}
+}
+
+std::vector<std::string> MtSearch::ListDirectoryFiles(const std::string& dirPath, const bool recursively)
+{
+	std::vector<std::string> files;
 
 	auto processEntry = [&](const auto& entry) {
-		if (!entry.is_regular_file())
+		if (entry.is_regular_file())
 		{
-			return;
+			files.push_back(entry.path());
 		}
-		boost::asio::post(threadPool, [path = entry.path(), callback]() {
-			callback(path);
-		});
 	};
 
 	if (recursively)
@@ -452,5 +1562,5 @@ void MtSearch::MtProcessDirectory(
 			processEntry(entry);
 		}
 	}
-	threadPool.join();
+	return files;
 }
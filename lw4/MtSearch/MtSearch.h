@@ -1,38 +1,112 @@
 #pragma once
+#include "Index/IndexSnapshot.h"
+#include "Index/PostingList.h"
+#include "Index/Segment.h"
+#include "Index/ShardOptions.h"
+#include "Ingest/IngestPipeline.h"
+#include "Query/BooleanQuery.h"
+#include "Query/PhraseMatcher.h"
+#include "Query/QueryAlgorithm.h"
+#include "Query/QueryCache.h"
+#include "Query/ScoreFunction.h"
+#include "Query/ScoringModel.h"
+#include "ThreadPool/ThreadPool.h"
+#include "Watcher/DirectoryWatcher.h"
+
 #include <atomic>
-#include <shared_mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <stop_token>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
-#include <functional>
+
+class CollectionStatistics;
 
 class MtSearch
 {
 private:
-	struct DocInfo
+	struct WordData
 	{
-		uint64_t docId;
-		double termFrequency;
-		int totalWordCount;
+		size_t queryIndex;
+		double idf;
+		std::vector<std::optional<uint32_t>> segmentTerms;
 	};
 
-	struct WordData
+	struct ScoreRange
 	{
-		double idf;
-		std::vector<DocInfo> docs;
+		size_t segmentIndex;
+		uint32_t firstDocId;
+		uint32_t lastDocId;
+	};
+
+	struct IndexShard
+	{
+		IndexShard(int threads, std::vector<int> cpus, uint64_t firstDocId);
+
+		// Процессоры NUMA-узла шарда; пусто, если шард не привязан
+		std::vector<int> cpus;
+		ThreadPool pool;
+		// Идентификаторы шарда выдаются подряд из его диапазона; защищено m_writeMutex
+		uint64_t nextDocId;
 	};
 
-	using InvertIndex = std::unordered_map<std::string, std::vector<DocInfo>>;
 	using FileInfo = std::vector<std::pair<uint64_t, double>>;
+	using RangeMatcher = std::function<FileInfo(const ScoreRange& range, const ScoreFunction& scoreFunction)>;
 
 public:
+	// Документ не из файла: путь служит его адресом, повторное добавление по тому же пути заменяет документ
+	struct Document
+	{
+		std::string path;
+		std::string content;
+	};
+
 	// TODO отделить ввод-вывод от самого индекса
-	explicit MtSearch(std::istream& input, std::ostream& output, int threads);
+	MtSearch(std::istream& input, std::ostream& output, int threads, const ShardOptions& shardOptions = {});
 	void Run();
 	void AddFileToIndex(const std::string& filePath);
 	void AddDirToIndex(const std::string& dirPath, bool recursively);
-	FileInfo FindMostRelevantDocIds(const std::vector<std::string>& words);
+	void AddFilesToIndex(const std::vector<std::string>& filePaths);
+	// Все документы попадают в индекс одним сегментом, то есть одним обновлением снимка
+	void AddDocumentsToIndex(std::vector<Document> documents);
+	// Эпоха текущего снимка: растёт с каждым добавлением и удалением документов
+	uint64_t GetIndexEpoch() const;
+	FileInfo FindMostRelevantDocIds(
+		const std::vector<std::string>& words,
+		QueryAlgorithm algorithm = QueryAlgorithm::Exhaustive);
+	// Ранжированный список строится не глубже этого, дальние страницы пусты
+	static constexpr size_t MAX_RESULTS_DEPTH = 10000;
+
+	// Страница [from, to) ранжированного списка; список кэшируется и страницы берутся срезами из него
+	FileInfo FindRelevantDocIdsRange(
+		const std::vector<std::string>& words,
+		size_t from,
+		size_t to,
+		QueryAlgorithm algorithm = QueryAlgorithm::Exhaustive);
+	// Документы со словами подряд (Phrase) или в окне maxDistance позиций (Near); нужны позиционные постинги
+	FileInfo FindPhraseDocIds(
+		const std::vector<std::string>& words,
+		PhraseMatcher::Mode mode,
+		uint32_t maxDistance = 0);
+	// Запрос с AND, OR, NOT и скобками; совпавшие документы ранжируются по словам вне NOT
+	FileInfo FindBooleanDocIds(const std::string& queryText);
+	void SetScoringModel(ScoringModel model);
+	void SetIndexPositions(bool indexPositions);
+	QueryCache::Stats GetQueryCacheStats() const;
+	// Статистика стадий последнего запуска конвейера индексации
+	IngestPipeline::Stats GetIngestStats() const;
+	void ClearQueryCache();
+	void SaveIndex(const std::string& indexPath);
+	void LoadIndex(const std::string& indexPath);
+	void SyncDir(const std::string& dirPath);
+	void WatchDir(const std::string& dirPath);
+	void UnwatchDir(const std::string& dirPath);
 
 private:
 	void ProcessLine(const std::string& line);
@@ -40,25 +114,117 @@ private:
 	void ProcessFindBatch(const std::string& fileUrl);
 	void RemoveFileFromIndex(const std::string& fileUrl);
 	void RemoveDirFromIndex(const std::string& dirPath, bool recursively);
+	void RemoveFilesFromIndex(const std::vector<std::string>& fileUrls);
 	uint64_t GetFileIdByUrl(const std::string& fileUrl);
-	std::vector<WordData> GetWordsDataFromIndex(const std::vector<std::string>& words);
 
-	void MtProcessDirectory(
-		const std::string& dirPath,
-		std::function<void(const std::string&)> callback,
-		bool recursively) const;
+	void IndexFiles(const std::vector<std::string>& files, bool onlyChanged);
+	void RunIngestPipeline(IngestPipeline::Input input, const IngestPipeline::FindIndexedState& findIndexedState);
+	std::vector<std::optional<FileState>> GetIndexedFileStates(const std::vector<std::string>& files);
+	std::vector<std::string> GetIndexedFiles(const std::string& path);
+	void SyncPaths(const std::vector<std::string>& paths);
+
+	static std::vector<std::unique_ptr<IndexShard>> CreateShards(int threads, const ShardOptions& shardOptions);
+	static IngestPipeline::Options GetIngestOptions(int threads);
+	void PublishSegment(const std::shared_ptr<Segment>& segment);
+	static void DeleteDocuments(IndexSnapshot& snapshot, const std::vector<uint64_t>& docIds);
+	size_t GetSegmentShard(const IndexSnapshot::SegmentView& view) const;
+	size_t SelectShardForSegment(const IndexSnapshot& snapshot) const;
+	std::vector<std::pair<size_t, size_t>> GetShardRuns(const IndexSnapshot& snapshot) const;
+	std::optional<std::pair<size_t, size_t>> SelectSegmentsToMerge(const IndexSnapshot& snapshot) const;
+	void MergeSegments(bool mergeAll);
+	void MergeSegmentRange(const IndexSnapshot& snapshot, std::pair<size_t, size_t> range);
+	void RequestMerge();
+	void MergeLoop(const std::stop_token& stopToken);
+
+	std::shared_ptr<const QueryCache::RankedDocs> FindRankedDocs(
+		const std::vector<std::string>& words,
+		size_t count,
+		QueryAlgorithm algorithm);
+	FileInfo ScoreQuery(
+		const IndexSnapshot& snapshot,
+		const std::vector<std::string>& terms,
+		size_t top,
+		QueryAlgorithm algorithm,
+		ScoringModel model);
+	std::shared_ptr<CollectionStatistics> GetCollectionStatistics(const IndexSnapshot& snapshot);
+	static std::vector<std::string> ExpandTermPatterns(const IndexSnapshot& snapshot, const std::vector<std::string>& terms);
+	static std::vector<WordData> GetWordsDataFromIndex(
+		const IndexSnapshot& snapshot,
+		CollectionStatistics& statistics,
+		ScoringModel model,
+		const std::vector<std::string>& words);
+	std::vector<ScoreRange> SplitIntoScoreRanges(const IndexSnapshot& snapshot) const;
+	FileInfo ScatterRanges(
+		const IndexSnapshot& snapshot,
+		const std::vector<ScoreRange>& ranges,
+		const std::function<FileInfo(const ScoreRange& range)>& matchRange,
+		size_t top);
+	static FileInfo ScoreDocRange(
+		const IndexSnapshot& snapshot,
+		const std::vector<WordData>& wordDataList,
+		const ScoreRange& range,
+		const ScoreFunction& scoreFunction,
+		size_t top);
+	static FileInfo PruneDocRange(
+		const IndexSnapshot& snapshot,
+		const std::vector<WordData>& wordDataList,
+		const ScoreRange& range,
+		const ScoreFunction& scoreFunction,
+		size_t top,
+		QueryAlgorithm algorithm,
+		std::atomic<double>& sharedThreshold);
+	FileInfo MatchRanges(
+		const IndexSnapshot& snapshot,
+		CollectionStatistics& statistics,
+		ScoringModel model,
+		const RangeMatcher& matchRange);
+	static FileInfo MatchDocRange(
+		const IndexSnapshot& snapshot,
+		const std::vector<WordData>& wordDataList,
+		const ScoreRange& range,
+		const ScoreFunction& scoreFunction,
+		PhraseMatcher::Mode mode,
+		uint32_t maxDistance);
+	static FileInfo MatchBooleanRange(
+		const IndexSnapshot& snapshot,
+		const BooleanQuery& query,
+		const std::vector<WordData>& wordDataList,
+		const ScoreRange& range,
+		const ScoreFunction& scoreFunction);
+	static FileInfo MergeTopItems(const std::vector<FileInfo>& partitionTops, size_t top);
+	static FileInfo MergeShardTops(const std::vector<FileInfo>& shardTops, size_t top);
+
+	static std::vector<std::string> ListDirectoryFiles(const std::string& dirPath, bool recursively);
 
 	void PrintAllFiles();
 	void PrintIndexInfo();
+	void PrintIndexStats();
+	void PrintIngestStats();
 
-	std::unordered_map<uint64_t, std::string> m_files;
-
-	std::atomic<uint64_t> m_docIndex{ 0 };
-	InvertIndex m_invertIndex;
+	std::atomic<std::shared_ptr<const IndexSnapshot>> m_snapshot{ std::make_shared<const IndexSnapshot>() };
+	std::unordered_map<std::string, uint64_t> m_fileIds;
 
 	std::istream& m_input;
 	std::ostream& m_output;
 
-	std::shared_mutex m_indexMutex;
+	std::mutex m_writeMutex;
 	int m_threads;
+	std::vector<std::unique_ptr<IndexShard>> m_shards;
+	QueryCache m_queryCache;
+	mutable std::mutex m_ingestStatsMutex;
+	IngestPipeline::Stats m_ingestStats;
+	std::atomic<ScoringModel> m_scoringModel{ ScoringModel::TfIdf };
+	std::atomic<bool> m_indexPositions{ true };
+	std::atomic<std::shared_ptr<CollectionStatistics>> m_statistics;
+
+	std::mutex m_mergeMutex;
+	std::mutex m_mergeRequestMutex;
+	std::condition_variable_any m_cvMergeRequested;
+	bool m_mergeRequested = false;
+	std::jthread m_mergeThread;
+	// Потоки стадий индексации создаются один раз; запуски из команд и наблюдателей идут по очереди
+	IngestPipeline m_ingestPipeline;
+
+	std::mutex m_watchersMutex;
+	std::vector<std::unique_ptr<DirectoryWatcher>> m_watchers;
 };
@@ -0,0 +1,193 @@
+#include "Index/IndexSnapshot.h"
+#include "Query/PhraseMatcher.h"
+#include "Tokenizer/Tokenizer.h"
+#include <algorithm>
+#include <catch2/catch_all.hpp>
+#include <random>
+#include <string>
+
+namespace
+{
+constexpr uint32_t DOCS_COUNT = 2000;
+constexpr uint32_t VOCABULARY_SIZE = 12;
+
+using Docs = std::vector<std::vector<std::string>>;
+
+// Маленький словарь, чтобы фразы и близкие вхождения встречались часто, а списки занимали много блоков
+Docs MakeDocs(std::mt19937& random)
+{
+	Docs docs(DOCS_COUNT);
+	for (auto& words : docs)
+	{
+		const auto length = 1 + random() % 40;
+		for (uint32_t i = 0; i < length; ++i)
+		{
+			words.push_back(std::string(1, static_cast<char>('a' + random() % VOCABULARY_SIZE)) + "w");
+		}
+	}
+	return docs;
+}
+
+std::shared_ptr<Segment> BuildSegment(const Docs& docs, const bool recordPositions)
+{
+	Segment::Builder builder;
+	TermCounter counter(recordPositions);
+	for (size_t docId = 0; docId < docs.size(); ++docId)
+	{
+		std::string text;
+		for (const auto& word : docs[docId])
+		{
+			text += word + " ";
+		}
+		Tokenizer::CountTerms(text, counter);
+		builder.AddDocument("doc" + std::to_string(docId), counter.GetEntries(), counter.GetTotalCount(), FileState{});
+		counter.Clear();
+	}
+	return builder.Build();
+}
+
+bool MatchesReference(
+	const std::vector<std::string>& words,
+	const std::vector<std::string>& phrase,
+	const PhraseMatcher::Mode mode,
+	const uint32_t maxDistance)
+{
+	if (mode == PhraseMatcher::Mode::Phrase)
+	{
+		return std::ranges::search(words, phrase).begin() != words.end();
+	}
+	for (size_t first = 0; first < words.size(); ++first)
+	{
+		const auto last = std::min(words.size(), first + maxDistance + 1);
+		const auto isCovered = std::ranges::all_of(phrase, [&](const std::string& word) {
+			return std::find(words.begin() + first, words.begin() + last, word) != words.begin() + last;
+		});
+		if (isCovered)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<uint32_t> Match(
+	const IndexSnapshot::SegmentView& view,
+	const std::vector<std::string>& phrase,
+	const PhraseMatcher::Mode mode,
+	const uint32_t maxDistance)
+{
+	std::vector<uint32_t> termOrdinals;
+	for (const auto& word : phrase)
+	{
+		const auto termOrdinal = view.segment->FindTerm(word);
+		if (!termOrdinal)
+		{
+			return {};
+		}
+		termOrdinals.push_back(*termOrdinal);
+	}
+
+	std::vector<uint32_t> result;
+	PhraseMatcher matcher(view, termOrdinals, mode, maxDistance);
+	matcher.ForEachMatch(0, static_cast<uint32_t>(view.segment->GetDocsCount()), [&](const uint32_t localDocId, const std::span<const uint32_t> termCounts) {
+		REQUIRE(termCounts.size() == phrase.size());
+		result.push_back(localDocId);
+	});
+	return result;
+}
+
+std::vector<uint32_t> MatchReference(
+	const Docs& docs,
+	const IndexSnapshot::SegmentView& view,
+	const std::vector<std::string>& phrase,
+	const PhraseMatcher::Mode mode,
+	const uint32_t maxDistance)
+{
+	std::vector<uint32_t> result;
+	for (uint32_t docId = 0; docId < docs.size(); ++docId)
+	{
+		if (!view.IsDeleted(docId) && MatchesReference(docs[docId], phrase, mode, maxDistance))
+		{
+			result.push_back(docId);
+		}
+	}
+	return result;
+}
+} // namespace
+
+TEST_CASE("Phrase and proximity matching")
+{
+	std::mt19937 random(11);
+	const auto docs = MakeDocs(random);
+	const auto segment = BuildSegment(docs, true);
+	REQUIRE(segment->HasPositions());
+
+	auto deletes = std::make_shared<SegmentDeletes>();
+	deletes->docs.assign(DOCS_COUNT, false);
+	for (uint32_t docId = 0; docId < DOCS_COUNT; docId += 4)
+	{
+		deletes->docs[docId] = true;
+		++deletes->count;
+	}
+
+	SECTION("Matches reference on random phrases")
+	{
+		for (const auto hasDeletes : { false, true })
+		{
+			const IndexSnapshot::SegmentView view{ segment, hasDeletes ? deletes : nullptr };
+			for (int query = 0; query < 300; ++query)
+			{
+				std::vector<std::string> phrase;
+				const auto wordsCount = 1 + random() % 3;
+				for (uint32_t i = 0; i < wordsCount; ++i)
+				{
+					phrase.push_back(std::string(1, static_cast<char>('a' + random() % VOCABULARY_SIZE)) + "w");
+				}
+				const auto mode = query % 2 == 0 ? PhraseMatcher::Mode::Phrase : PhraseMatcher::Mode::Near;
+				const auto maxDistance = static_cast<uint32_t>(random() % 6);
+
+				REQUIRE(Match(view, phrase, mode, maxDistance) == MatchReference(docs, view, phrase, mode, maxDistance));
+			}
+		}
+	}
+
+	SECTION("Positions survive merge and mapping")
+	{
+		// Слияние оставляет только живые документы, поэтому сравниваем со сжатым списком документов
+		Docs liveDocs;
+		for (uint32_t docId = 0; docId < DOCS_COUNT; ++docId)
+		{
+			if (!deletes->docs[docId])
+			{
+				liveDocs.push_back(docs[docId]);
+			}
+		}
+
+		const auto merged = Segment::Merge({ { segment.get(), deletes.get() }, { segment.get(), nullptr } });
+		const auto bytes = std::make_shared<std::vector<std::byte>>(merged->GetBytes().begin(), merged->GetBytes().end());
+		const auto mapped = Segment::Open(bytes, *bytes);
+		REQUIRE(mapped->HasPositions());
+
+		auto mergedDocs = liveDocs;
+		mergedDocs.insert(mergedDocs.end(), docs.begin(), docs.end());
+		const IndexSnapshot::SegmentView view{ mapped, nullptr };
+		for (const auto& phrase : { std::vector<std::string>{ "aw", "bw" }, { "cw", "cw", "dw" }, { "ew", "aw", "fw" } })
+		{
+			REQUIRE(Match(view, phrase, PhraseMatcher::Mode::Phrase, 0)
+				== MatchReference(mergedDocs, view, phrase, PhraseMatcher::Mode::Phrase, 0));
+			REQUIRE(Match(view, phrase, PhraseMatcher::Mode::Near, 3)
+				== MatchReference(mergedDocs, view, phrase, PhraseMatcher::Mode::Near, 3));
+		}
+	}
+
+	SECTION("Positions are optional")
+	{
+		const auto plain = BuildSegment(docs, false);
+		REQUIRE_FALSE(plain->HasPositions());
+		REQUIRE_FALSE(Segment::Merge({ { segment.get(), nullptr }, { plain.get(), nullptr } })->HasPositions());
+
+		const IndexSnapshot::SegmentView view{ plain, nullptr };
+		REQUIRE(Match(view, { "aw" }, PhraseMatcher::Mode::Phrase, 0).size() == MatchReference(docs, view, { "aw" }, PhraseMatcher::Mode::Phrase, 0).size());
+		REQUIRE_THROWS(Match(view, { "aw", "bw" }, PhraseMatcher::Mode::Phrase, 0));
+	}
+}
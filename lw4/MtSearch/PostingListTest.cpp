@@ -0,0 +1,137 @@
+#include "Index/PostingList.h"
+#include <catch2/catch_all.hpp>
+#include <utility>
+
+namespace
+{
+std::vector<std::pair<uint64_t, uint32_t>> Collect(const PostingList& list, const uint64_t firstDocId, const uint64_t lastDocId)
+{
+	std::vector<std::pair<uint64_t, uint32_t>> result;
+	list.ForEachBlockInRange(firstDocId, lastDocId, [&result](const PostingList::Block& block) {
+		for (size_t i = 0; i < block.count; ++i)
+		{
+			result.emplace_back(block.docIds[i], block.termCounts[i]);
+		}
+	});
+	return result;
+}
+} // namespace
+
+TEST_CASE("Posting list encoding")
+{
+	SECTION("Empty list")
+	{
+		PostingList list;
+		REQUIRE(list.GetSize() == 0);
+		REQUIRE(Collect(list, 0, UINT64_MAX).empty());
+	}
+
+	SECTION("Round trip across several blocks")
+	{
+		PostingList list;
+		std::vector<std::pair<uint64_t, uint32_t>> expected;
+		uint64_t docId = 0;
+		for (uint32_t i = 0; i < PostingList::BLOCK_SIZE * 3 + 17; ++i)
+		{
+			docId += 1 + (i * 7919) % 1000;
+			expected.emplace_back(docId, 1 + i % 300);
+			list.Add(docId, 1 + i % 300);
+		}
+
+		REQUIRE(list.GetSize() == expected.size());
+		REQUIRE(Collect(list, 0, UINT64_MAX) == expected);
+	}
+
+	SECTION("Range lookup")
+	{
+		PostingList list;
+		for (uint64_t docId = 0; docId < 1000; docId += 2)
+		{
+			list.Add(docId, 1);
+		}
+
+		const auto range = Collect(list, 301, 600);
+		REQUIRE(range.size() == 149);
+		REQUIRE(range.front().first == 302);
+		REQUIRE(range.back().first == 598);
+		REQUIRE(Collect(list, 1000, 2000).empty());
+	}
+
+	SECTION("Postings must be sorted")
+	{
+		PostingList list;
+		list.Add(10, 1);
+		REQUIRE_THROWS(list.Add(10, 1));
+		REQUIRE_THROWS(list.Add(5, 1));
+	}
+
+	SECTION("Remove")
+	{
+		PostingList list;
+		for (uint64_t docId = 0; docId < 300; ++docId)
+		{
+			list.Add(docId, 1);
+		}
+
+		REQUIRE(list.Remove(150));
+		REQUIRE_FALSE(list.Remove(150));
+		REQUIRE(list.GetSize() == 299);
+		REQUIRE(Collect(list, 149, 152).size() == 2);
+	}
+
+	SECTION("Mapped view")
+	{
+		PostingList list;
+		for (uint64_t docId = 0; docId < 1000; docId += 3)
+		{
+			list.Add(docId, static_cast<uint32_t>(docId % 7 + 1));
+		}
+
+		std::vector<std::byte> bytes;
+		list.Serialize(bytes);
+		const auto mapped = PostingList::Map(bytes);
+
+		REQUIRE(mapped.GetSize() == list.GetSize());
+		REQUIRE(Collect(mapped, 0, UINT64_MAX) == Collect(list, 0, UINT64_MAX));
+		REQUIRE(Collect(mapped, 500, 700) == Collect(list, 500, 700));
+		REQUIRE_THROWS(PostingList::Map(std::span(bytes).first(8)));
+	}
+
+	SECTION("Cursor")
+	{
+		PostingList list;
+		for (uint64_t docId = 0; docId < 1000; docId += 5)
+		{
+			list.Add(docId, static_cast<uint32_t>(docId % 11 + 1));
+		}
+
+		PostingList::Cursor cursor(list);
+		REQUIRE(cursor.GetDocId() == 0);
+		cursor.Next();
+		REQUIRE(cursor.GetDocId() == 5);
+
+		cursor.Advance(641);
+		REQUIRE(cursor.GetDocId() == 645);
+		REQUIRE(cursor.GetTermCount() == 645 % 11 + 1);
+		cursor.Advance(100);
+		REQUIRE(cursor.GetDocId() == 645);
+
+		REQUIRE(cursor.FindBlock(0) == 0);
+		REQUIRE(cursor.FindBlock(995) == 1);
+		REQUIRE(cursor.GetBlockLastDocId(0) == (PostingList::BLOCK_SIZE - 1) * 5);
+		REQUIRE(cursor.GetBlockLastDocId(cursor.FindBlock(1000)) == PostingList::Cursor::END);
+
+		cursor.Advance(996);
+		REQUIRE(cursor.GetDocId() == PostingList::Cursor::END);
+	}
+
+	SECTION("Compressed size")
+	{
+		PostingList list;
+		for (uint64_t docId = 0; docId < 100000; docId += 3)
+		{
+			list.Add(docId, 2);
+		}
+		REQUIRE(list.GetMemoryUsage() < list.GetSize() * 6);
+	}
+}
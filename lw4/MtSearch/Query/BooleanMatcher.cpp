@@ -0,0 +1,225 @@
+#include "BooleanMatcher.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+constexpr size_t NO_CURSOR = SIZE_MAX;
+} // namespace
+
+BooleanMatcher::BooleanMatcher(
+	const IndexSnapshot::SegmentView& view,
+	const BooleanQuery& query,
+	const std::span<const std::optional<uint32_t>> termOrdinals)
+	: m_view(view)
+	, m_termCounts(query.GetTerms().size(), 0)
+{
+	if (termOrdinals.size() != query.GetTerms().size())
+	{
+		throw std::invalid_argument("Term ordinals must be given for every query term");
+	}
+
+	const auto& nodes = query.GetNodes();
+	m_nodeCursors.assign(nodes.size(), NO_CURSOR);
+	for (size_t node = 0; node < nodes.size(); ++node)
+	{
+		if (nodes[node].type == BooleanQuery::NodeType::Term && termOrdinals[nodes[node].termIndex])
+		{
+			m_nodeCursors[node] = m_postings.size();
+			m_postings.push_back(view.segment->GetPostings(*termOrdinals[nodes[node].termIndex]));
+		}
+	}
+	// Курсоры держат указатели на списки, поэтому создаются, когда m_postings уже не растёт
+	m_cursors.reserve(m_postings.size());
+	for (const auto& postings : m_postings)
+	{
+		m_cursors.emplace_back(postings);
+	}
+
+	m_root = Build(query, query.GetRoot());
+}
+
+size_t BooleanMatcher::Build(const BooleanQuery& query, const size_t node)
+{
+	const auto& nodes = query.GetNodes();
+	switch (nodes[node].type)
+	{
+	case BooleanQuery::NodeType::Term: {
+		if (m_nodeCursors[node] == NO_CURSOR)
+		{
+			return AddIterator({ IteratorType::Empty });
+		}
+		Iterator iterator{ IteratorType::Term };
+		iterator.termIndex = nodes[node].termIndex;
+		iterator.cursorIndex = m_nodeCursors[node];
+		iterator.cost = m_postings[iterator.cursorIndex].GetSize();
+		return AddIterator(std::move(iterator));
+	}
+	case BooleanQuery::NodeType::Not:
+		return MakeAnd({}, { Build(query, nodes[node].children.front()) });
+	case BooleanQuery::NodeType::And: {
+		std::vector<size_t> children;
+		std::vector<size_t> excluded;
+		for (const auto child : nodes[node].children)
+		{
+			if (nodes[child].type == BooleanQuery::NodeType::Not)
+			{
+				excluded.push_back(Build(query, nodes[child].children.front()));
+			}
+			else
+			{
+				children.push_back(Build(query, child));
+			}
+		}
+		return MakeAnd(std::move(children), std::move(excluded));
+	}
+	case BooleanQuery::NodeType::Or: {
+		Iterator iterator{ IteratorType::Or };
+		for (const auto child : nodes[node].children)
+		{
+			iterator.children.push_back(Build(query, child));
+			iterator.cost += m_iterators[iterator.children.back()].cost;
+		}
+		return AddIterator(std::move(iterator));
+	}
+	}
+	throw std::logic_error("Unknown boolean query node");
+}
+
+size_t BooleanMatcher::AddIterator(Iterator iterator)
+{
+	m_iterators.push_back(std::move(iterator));
+	return m_iterators.size() - 1;
+}
+
+size_t BooleanMatcher::MakeAnd(std::vector<size_t> children, std::vector<size_t> excluded)
+{
+	// Одни исключения ограничиваются всеми документами сегмента
+	if (children.empty())
+	{
+		Iterator all{ IteratorType::All };
+		all.cost = m_view.segment->GetDocsCount();
+		children.push_back(AddIterator(std::move(all)));
+	}
+	std::ranges::stable_sort(children, {}, [this](const size_t child) {
+		return m_iterators[child].cost;
+	});
+
+	Iterator iterator{ IteratorType::And };
+	iterator.cost = m_iterators[children.front()].cost;
+	iterator.children = std::move(children);
+	iterator.excluded = std::move(excluded);
+	return AddIterator(std::move(iterator));
+}
+
+uint64_t BooleanMatcher::FindMatch(uint64_t docId, const uint32_t lastDocId)
+{
+	for (;;)
+	{
+		const auto candidate = Advance(m_root, docId);
+		if (candidate >= lastDocId)
+		{
+			return PostingList::Cursor::END;
+		}
+		if (m_view.IsDeleted(static_cast<uint32_t>(candidate)))
+		{
+			docId = candidate + 1;
+			continue;
+		}
+
+		std::ranges::fill(m_termCounts, 0);
+		CollectTermCounts(m_root, candidate);
+		return candidate;
+	}
+}
+
+uint64_t BooleanMatcher::Advance(const size_t index, const uint64_t target)
+{
+	auto& iterator = m_iterators[index];
+	if (iterator.isPositioned && iterator.docId >= target)
+	{
+		return iterator.docId;
+	}
+	iterator.isPositioned = true;
+
+	switch (iterator.type)
+	{
+	case IteratorType::Empty:
+		iterator.docId = PostingList::Cursor::END;
+		break;
+	case IteratorType::All:
+		iterator.docId = target < m_view.segment->GetDocsCount() ? target : PostingList::Cursor::END;
+		break;
+	case IteratorType::Term: {
+		auto& cursor = m_cursors[iterator.cursorIndex];
+		cursor.Advance(target);
+		iterator.docId = cursor.GetDocId();
+		break;
+	}
+	case IteratorType::And:
+		iterator.docId = AdvanceAnd(iterator, target);
+		break;
+	case IteratorType::Or:
+		iterator.docId = PostingList::Cursor::END;
+		for (const auto child : iterator.children)
+		{
+			iterator.docId = std::min(iterator.docId, Advance(child, target));
+		}
+		break;
+	}
+	return iterator.docId;
+}
+
+uint64_t BooleanMatcher::AdvanceAnd(Iterator& iterator, const uint64_t target)
+{
+	const auto& children = iterator.children;
+	auto candidate = Advance(children.front(), target);
+	size_t i = 1;
+	while (candidate != PostingList::Cursor::END)
+	{
+		if (i < children.size())
+		{
+			const auto docId = Advance(children[i], candidate);
+			if (docId == candidate)
+			{
+				++i;
+				continue;
+			}
+			// Кандидат не подошёл: самый дешёвый ребёнок прыгает вперёд, и проверка начинается заново
+			candidate = Advance(children.front(), docId);
+			i = 1;
+			continue;
+		}
+
+		const auto isExcluded = std::ranges::any_of(iterator.excluded, [&](const size_t excluded) {
+			return Advance(excluded, candidate) == candidate;
+		});
+		if (!isExcluded)
+		{
+			return candidate;
+		}
+		candidate = Advance(children.front(), candidate + 1);
+		i = 1;
+	}
+	return PostingList::Cursor::END;
+}
+
+void BooleanMatcher::CollectTermCounts(const size_t index, const uint64_t docId)
+{
+	const auto& iterator = m_iterators[index];
+	if (iterator.docId != docId)
+	{
+		return;
+	}
+
+	if (iterator.type == IteratorType::Term)
+	{
+		m_termCounts[iterator.termIndex] = m_cursors[iterator.cursorIndex].GetTermCount();
+		return;
+	}
+	for (const auto child : iterator.children)
+	{
+		CollectTermCounts(child, docId);
+	}
+}
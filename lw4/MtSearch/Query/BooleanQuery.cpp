@@ -0,0 +1,186 @@
+#include "BooleanQuery.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+constexpr std::string_view AND_OPERATOR = "AND";
+constexpr std::string_view OR_OPERATOR = "OR";
+constexpr std::string_view NOT_OPERATOR = "NOT";
+
+std::vector<std::string_view> SplitTokens(const std::string_view text)
+{
+	std::vector<std::string_view> tokens;
+	size_t i = 0;
+	while (i < text.size())
+	{
+		if (std::isspace(static_cast<unsigned char>(text[i])))
+		{
+			++i;
+		}
+		else if (text[i] == '(' || text[i] == ')')
+		{
+			tokens.push_back(text.substr(i, 1));
+			++i;
+		}
+		else
+		{
+			const auto start = i;
+			while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])) && text[i] != '(' && text[i] != ')')
+			{
+				++i;
+			}
+			tokens.push_back(text.substr(start, i - start));
+		}
+	}
+	return tokens;
+}
+} // namespace
+
+// Рекурсивный спуск: Or := And {OR And}; And := Unary {[AND] Unary}; Unary := NOT Unary | ( Or ) | слово
+class BooleanQuery::Parser
+{
+public:
+	Parser(BooleanQuery& query, std::vector<std::string_view> tokens)
+		: m_query(query)
+		, m_tokens(std::move(tokens))
+	{
+	}
+
+	size_t ParseQuery()
+	{
+		if (m_tokens.empty())
+		{
+			throw std::invalid_argument("Empty boolean query");
+		}
+		const auto root = ParseOr();
+		if (m_position != m_tokens.size())
+		{
+			throw std::invalid_argument("Unexpected token in boolean query: " + std::string(m_tokens[m_position]));
+		}
+		return root;
+	}
+
+private:
+	size_t ParseOr()
+	{
+		std::vector<size_t> children{ ParseAnd() };
+		while (Accept(OR_OPERATOR))
+		{
+			children.push_back(ParseAnd());
+		}
+		return MakeNode(NodeType::Or, std::move(children));
+	}
+
+	size_t ParseAnd()
+	{
+		std::vector<size_t> children{ ParseUnary() };
+		for (;;)
+		{
+			if (Accept(AND_OPERATOR))
+			{
+				children.push_back(ParseUnary());
+			}
+			else if (m_position < m_tokens.size() && m_tokens[m_position] != ")" && m_tokens[m_position] != OR_OPERATOR)
+			{
+				children.push_back(ParseUnary());
+			}
+			else
+			{
+				return MakeNode(NodeType::And, std::move(children));
+			}
+		}
+	}
+
+	size_t ParseUnary()
+	{
+		if (m_position == m_tokens.size())
+		{
+			throw std::invalid_argument("Unexpected end of boolean query");
+		}
+		if (Accept(NOT_OPERATOR))
+		{
+			return MakeNode(NodeType::Not, { ParseUnary() });
+		}
+		if (Accept("("))
+		{
+			const auto node = ParseOr();
+			if (!Accept(")"))
+			{
+				throw std::invalid_argument("Unbalanced parentheses in boolean query");
+			}
+			return node;
+		}
+
+		const auto token = m_tokens[m_position];
+		if (token == ")" || token == AND_OPERATOR || token == OR_OPERATOR)
+		{
+			throw std::invalid_argument("Unexpected token in boolean query: " + std::string(token));
+		}
+		++m_position;
+
+		std::string term(token);
+		std::ranges::transform(term, term.begin(), [](const unsigned char c) {
+			return std::tolower(c);
+		});
+		auto& terms = m_query.m_terms;
+		const auto it = std::ranges::find(terms, term);
+		const auto termIndex = static_cast<size_t>(it - terms.begin());
+		if (it == terms.end())
+		{
+			terms.push_back(std::move(term));
+		}
+		m_query.m_nodes.push_back({ NodeType::Term, termIndex, {} });
+		return m_query.m_nodes.size() - 1;
+	}
+
+	bool Accept(const std::string_view token)
+	{
+		if (m_position < m_tokens.size() && m_tokens[m_position] == token)
+		{
+			++m_position;
+			return true;
+		}
+		return false;
+	}
+
+	size_t MakeNode(const NodeType type, std::vector<size_t> children)
+	{
+		if (type != NodeType::Not && children.size() == 1)
+		{
+			return children.front();
+		}
+		m_query.m_nodes.push_back({ type, 0, std::move(children) });
+		return m_query.m_nodes.size() - 1;
+	}
+
+	BooleanQuery& m_query;
+	std::vector<std::string_view> m_tokens;
+	size_t m_position = 0;
+};
+
+BooleanQuery BooleanQuery::Parse(const std::string_view text)
+{
+	BooleanQuery query;
+	Parser parser(query, SplitTokens(text));
+	query.m_root = parser.ParseQuery();
+	return query;
+}
+
+const std::vector<std::string>& BooleanQuery::GetTerms() const
+{
+	return m_terms;
+}
+
+const std::vector<BooleanQuery::Node>& BooleanQuery::GetNodes() const
+{
+	return m_nodes;
+}
+
+size_t BooleanQuery::GetRoot() const
+{
+	return m_root;
+}
@@ -0,0 +1,95 @@
+#include "CollectionStatistics.h"
+#include "ScoreFunction.h"
+
+#include <algorithm>
+
+CollectionStatistics::CollectionStatistics(const IndexSnapshot& snapshot)
+	: m_epoch(snapshot.epoch)
+	, m_docsCount(snapshot.GetLiveDocsCount())
+	, m_averageDocLength(static_cast<double>(snapshot.GetLiveDocLength()) / static_cast<double>(std::max<size_t>(m_docsCount, 1)))
+{
+}
+
+uint64_t CollectionStatistics::GetEpoch() const
+{
+	return m_epoch;
+}
+
+size_t CollectionStatistics::GetDocsCount() const
+{
+	return m_docsCount;
+}
+
+double CollectionStatistics::GetAverageDocLength() const
+{
+	return m_averageDocLength;
+}
+
+std::optional<double> CollectionStatistics::FindIdf(
+	const IndexSnapshot& snapshot,
+	const ScoringModel model,
+	const std::string_view term)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		if (const auto it = m_termIdfs.find(term); it != m_termIdfs.end())
+		{
+			return SelectIdf(it->second, model);
+		}
+	}
+
+	size_t docsWithTermCount = 0;
+	for (const auto& view : snapshot.segments)
+	{
+		if (const auto termOrdinal = view.segment->FindTerm(term))
+		{
+			docsWithTermCount += view.GetLiveTermDocsCount(*termOrdinal);
+		}
+	}
+	std::optional<TermIdf> termIdf;
+	if (docsWithTermCount > 0)
+	{
+		termIdf = TermIdf{
+			ScoreFunction::GetIdf(ScoringModel::TfIdf, m_docsCount, docsWithTermCount),
+			ScoreFunction::GetIdf(ScoringModel::Bm25, m_docsCount, docsWithTermCount),
+		};
+	}
+
+	{
+		std::lock_guard lock(m_mutex);
+		m_termIdfs.try_emplace(std::string(term), termIdf);
+	}
+	return SelectIdf(termIdf, model);
+}
+
+std::optional<double> CollectionStatistics::SelectIdf(const std::optional<TermIdf>& termIdf, const ScoringModel model)
+{
+	if (!termIdf)
+	{
+		return std::nullopt;
+	}
+	return model == ScoringModel::Bm25 ? termIdf->bm25 : termIdf->tfIdf;
+}
+
+std::shared_ptr<const std::vector<float>> CollectionStatistics::GetLengthNorms(const std::shared_ptr<const Segment>& segment)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		// Сегмент мог быть слит и освобождён внутри эпохи, а его адрес занят новым
+		if (const auto it = m_segmentNorms.find(segment.get()); it != m_segmentNorms.end() && it->second.segment.lock() == segment)
+		{
+			return it->second.norms;
+		}
+	}
+
+	auto norms = std::make_shared<std::vector<float>>();
+	norms->reserve(segment->GetDocsCount());
+	for (const auto docLength : segment->GetDocLengths())
+	{
+		norms->push_back(ScoreFunction::GetBm25LengthNorm(docLength, m_averageDocLength));
+	}
+
+	std::lock_guard lock(m_mutex);
+	m_segmentNorms.insert_or_assign(segment.get(), SegmentNorms{ segment, norms });
+	return norms;
+}
@@ -0,0 +1,304 @@
+#include "DocAtATimeScorer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+// Запас на погрешность сложения верхних границ в другом порядке, чем у точной оценки
+constexpr double BOUND_EPSILON = 1e-9;
+} // namespace
+
+uint64_t DocAtATimeScorer::TermCursor::GetDocId(const uint32_t lastDocId) const
+{
+	const auto docId = cursor.GetDocId();
+	return docId < lastDocId ? docId : PostingList::Cursor::END;
+}
+
+DocAtATimeScorer::DocAtATimeScorer(
+	const IndexSnapshot::SegmentView& view,
+	const ScoreFunction& scoreFunction,
+	const size_t queryTermsCount,
+	const size_t top,
+	std::atomic<double>& sharedThreshold)
+	: m_view(view)
+	, m_scoreFunction(scoreFunction)
+	, m_top(top)
+	, m_sharedThreshold(sharedThreshold)
+	, m_contributions(queryTermsCount, 0.0)
+{
+}
+
+DocAtATimeScorer::ScoredDocs DocAtATimeScorer::Score(
+	const std::vector<Term>& terms,
+	const uint32_t firstDocId,
+	const uint32_t lastDocId,
+	const QueryAlgorithm algorithm)
+{
+	m_heap.clear();
+	if (m_top == 0)
+	{
+		return {};
+	}
+
+	std::vector<TermCursor> cursors;
+	cursors.reserve(terms.size());
+	for (const auto& term : terms)
+	{
+		TermCursor termCursor{ &term,
+			PostingList::Cursor(term.postings),
+			m_scoreFunction.GetUpperBound(term.maxTermFrequency, term.idf) };
+		termCursor.cursor.Advance(firstDocId);
+		if (termCursor.GetDocId(lastDocId) != PostingList::Cursor::END)
+		{
+			cursors.push_back(std::move(termCursor));
+		}
+	}
+
+	switch (algorithm)
+	{
+	case QueryAlgorithm::MaxScore:
+		ScoreMaxScore(cursors, lastDocId);
+		break;
+	case QueryAlgorithm::Wand:
+		ScoreWand(cursors, lastDocId, false);
+		break;
+	case QueryAlgorithm::BlockMaxWand:
+		ScoreWand(cursors, lastDocId, true);
+		break;
+	default:
+		throw std::invalid_argument("Document-at-a-time scoring requires a pruning algorithm");
+	}
+	return m_heap;
+}
+
+void DocAtATimeScorer::ScoreMaxScore(std::vector<TermCursor>& cursors, const uint32_t lastDocId)
+{
+	std::ranges::sort(cursors, {}, &TermCursor::maxScore);
+
+	std::vector<double> upperBounds;
+	double upperBound = 0;
+	for (const auto& termCursor : cursors)
+	{
+		upperBound += termCursor.maxScore;
+		upperBounds.push_back(upperBound);
+	}
+
+	// Термины [0, firstEssential) не могут сами по себе вывести документ в top-k, кандидатов дают только остальные
+	size_t firstEssential = 0;
+	while (true)
+	{
+		while (firstEssential < cursors.size() && !CanEnterTop(upperBounds[firstEssential]))
+		{
+			++firstEssential;
+		}
+		if (firstEssential == cursors.size())
+		{
+			return;
+		}
+
+		auto candidate = PostingList::Cursor::END;
+		for (auto i = firstEssential; i < cursors.size(); ++i)
+		{
+			candidate = std::min(candidate, cursors[i].GetDocId(lastDocId));
+		}
+		if (candidate == PostingList::Cursor::END)
+		{
+			return;
+		}
+
+		double partialScore = 0;
+		for (auto i = firstEssential; i < cursors.size(); ++i)
+		{
+			if (cursors[i].GetDocId(lastDocId) == candidate)
+			{
+				partialScore += GetContribution(cursors[i], candidate);
+			}
+		}
+
+		bool isPruned = false;
+		for (auto i = firstEssential; i-- > 0;)
+		{
+			if (!CanEnterTop(partialScore + upperBounds[i]))
+			{
+				isPruned = true;
+				break;
+			}
+			cursors[i].cursor.Advance(candidate);
+			if (cursors[i].GetDocId(lastDocId) == candidate)
+			{
+				partialScore += GetContribution(cursors[i], candidate);
+			}
+		}
+
+		if (isPruned)
+		{
+			std::ranges::fill(m_contributions, 0.0);
+		}
+		else
+		{
+			Collect(candidate);
+		}
+
+		for (auto i = firstEssential; i < cursors.size(); ++i)
+		{
+			if (cursors[i].GetDocId(lastDocId) == candidate)
+			{
+				cursors[i].cursor.Next();
+			}
+		}
+	}
+}
+
+void DocAtATimeScorer::ScoreWand(std::vector<TermCursor>& cursors, const uint32_t lastDocId, const bool useBlockMax)
+{
+	const auto end = PostingList::Cursor::END;
+
+	// Курсоры держат раскодированный блок, поэтому переупорядочиваются указатели на них
+	std::vector<TermCursor*> order;
+	for (auto& termCursor : cursors)
+	{
+		order.push_back(&termCursor);
+	}
+
+	while (true)
+	{
+		std::ranges::sort(order, {}, [lastDocId](const TermCursor* termCursor) {
+			return termCursor->GetDocId(lastDocId);
+		});
+
+		auto pivot = order.size();
+		double upperBound = 0;
+		for (size_t i = 0; i < order.size() && order[i]->GetDocId(lastDocId) != end; ++i)
+		{
+			upperBound += order[i]->maxScore;
+			if (CanEnterTop(upperBound))
+			{
+				pivot = i;
+				break;
+			}
+		}
+		if (pivot == order.size())
+		{
+			return;
+		}
+
+		const auto pivotDocId = order[pivot]->GetDocId(lastDocId);
+		while (pivot + 1 < order.size() && order[pivot + 1]->GetDocId(lastDocId) == pivotDocId)
+		{
+			++pivot;
+		}
+
+		if (useBlockMax)
+		{
+			double blockUpperBound = 0;
+			auto nextDocId = pivot + 1 < order.size() ? order[pivot + 1]->GetDocId(lastDocId) : end;
+			for (size_t i = 0; i <= pivot; ++i)
+			{
+				const auto& termCursor = *order[i];
+				const auto block = termCursor.cursor.FindBlock(pivotDocId);
+				if (block < termCursor.term->blockMaxTermFrequencies.size())
+				{
+					blockUpperBound += m_scoreFunction.GetUpperBound(
+						termCursor.term->blockMaxTermFrequencies[block],
+						termCursor.term->idf);
+					nextDocId = std::min(nextDocId, termCursor.cursor.GetBlockLastDocId(block) + 1);
+				}
+			}
+
+			if (!CanEnterTop(blockUpperBound))
+			{
+				nextDocId = std::max(nextDocId, pivotDocId + 1);
+				for (size_t i = 0; i <= pivot; ++i)
+				{
+					order[i]->cursor.Advance(nextDocId);
+				}
+				continue;
+			}
+		}
+
+		if (order.front()->GetDocId(lastDocId) == pivotDocId)
+		{
+			for (size_t i = 0; i <= pivot; ++i)
+			{
+				GetContribution(*order[i], pivotDocId);
+			}
+			Collect(pivotDocId);
+			for (size_t i = 0; i <= pivot; ++i)
+			{
+				order[i]->cursor.Next();
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < pivot && order[i]->GetDocId(lastDocId) < pivotDocId; ++i)
+			{
+				order[i]->cursor.Advance(pivotDocId);
+			}
+		}
+	}
+}
+
+double DocAtATimeScorer::GetContribution(const TermCursor& termCursor, const uint64_t docId)
+{
+	const auto contribution = m_scoreFunction.GetContribution(
+		termCursor.cursor.GetTermCount(),
+		static_cast<uint32_t>(docId),
+		termCursor.term->idf);
+	m_contributions[termCursor.term->queryIndex] = contribution;
+	return contribution;
+}
+
+void DocAtATimeScorer::Collect(const uint64_t docId)
+{
+	const auto localDocId = static_cast<uint32_t>(docId);
+	double score = 0.0;
+	for (auto& contribution : m_contributions)
+	{
+		score += contribution;
+		contribution = 0.0;
+	}
+	if (m_view.IsDeleted(localDocId))
+	{
+		return;
+	}
+
+	const ScoredDoc candidate{ m_view.segment->GetGlobalDocId(localDocId), score };
+	if (m_heap.size() < m_top)
+	{
+		m_heap.push_back(candidate);
+		std::ranges::push_heap(m_heap, IsMoreRelevant);
+	}
+	else if (IsMoreRelevant(candidate, m_heap.front()))
+	{
+		std::ranges::pop_heap(m_heap, IsMoreRelevant);
+		m_heap.back() = candidate;
+		std::ranges::push_heap(m_heap, IsMoreRelevant);
+	}
+	else
+	{
+		return;
+	}
+
+	if (m_heap.size() == m_top)
+	{
+		const auto threshold = m_heap.front().second;
+		auto sharedThreshold = m_sharedThreshold.load(std::memory_order_relaxed);
+		while (threshold > sharedThreshold
+			&& !m_sharedThreshold.compare_exchange_weak(sharedThreshold, threshold, std::memory_order_relaxed))
+		{
+		}
+	}
+}
+
+bool DocAtATimeScorer::CanEnterTop(const double scoreBound) const
+{
+	auto threshold = m_sharedThreshold.load(std::memory_order_relaxed);
+	if (m_heap.size() == m_top)
+	{
+		threshold = std::max(threshold, m_heap.front().second);
+	}
+	const auto margin = std::isfinite(threshold) ? std::abs(threshold) * BOUND_EPSILON : 0.0;
+	return scoreBound >= threshold - margin;
+}
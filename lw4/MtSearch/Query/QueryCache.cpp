@@ -0,0 +1,136 @@
+#include "QueryCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+namespace
+{
+// Приблизительная цена узлов списка и хэш-таблицы на одну запись
+constexpr size_t ENTRY_OVERHEAD = 96;
+} // namespace
+
+QueryCache::QueryCache(const size_t memoryBudget)
+	: m_shardMemoryBudget(memoryBudget / SHARDS_COUNT)
+{
+}
+
+std::vector<std::string> QueryCache::NormalizeTerms(const std::vector<std::string>& words)
+{
+	std::vector<std::string> terms = words;
+	for (auto& term : terms)
+	{
+		std::ranges::transform(term, term.begin(), [](const unsigned char c) {
+			return static_cast<char>(std::tolower(c));
+		});
+	}
+	std::ranges::sort(terms);
+	return terms;
+}
+
+std::string QueryCache::MakeKey(const ScoringModel model, const std::vector<std::string>& terms)
+{
+	std::string key = std::to_string(static_cast<int>(model)) + ':';
+	for (const auto& term : terms)
+	{
+		key += term;
+		key += ' ';
+	}
+	return key;
+}
+
+std::shared_ptr<const QueryCache::RankedDocs> QueryCache::Find(
+	const std::string& key,
+	const uint64_t epoch,
+	const size_t count)
+{
+	auto& shard = GetShard(key);
+	{
+		std::lock_guard lock(shard.mutex);
+		if (const auto it = shard.index.find(key); it != shard.index.end())
+		{
+			const auto entry = it->second;
+			if (entry->epoch != epoch)
+			{
+				if (entry->epoch < epoch)
+				{
+					Erase(shard, entry);
+				}
+			}
+			else if (entry->rankedDocs->isComplete || entry->rankedDocs->docs.size() >= count)
+			{
+				shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+				m_hits.fetch_add(1, std::memory_order_relaxed);
+				return entry->rankedDocs;
+			}
+		}
+	}
+	m_misses.fetch_add(1, std::memory_order_relaxed);
+	return nullptr;
+}
+
+void QueryCache::Insert(const std::string& key, const uint64_t epoch, std::shared_ptr<const RankedDocs> rankedDocs)
+{
+	const auto memoryUsage = sizeof(Entry) + sizeof(RankedDocs) + ENTRY_OVERHEAD + key.capacity()
+		+ rankedDocs->docs.capacity() * sizeof(ScoredDoc);
+	if (memoryUsage > m_shardMemoryBudget)
+	{
+		return;
+	}
+
+	auto& shard = GetShard(key);
+	std::lock_guard lock(shard.mutex);
+	if (const auto it = shard.index.find(key); it != shard.index.end())
+	{
+		// Запрос по старому снимку не должен вытеснять результат, уже посчитанный по новому
+		if (it->second->epoch > epoch)
+		{
+			return;
+		}
+		Erase(shard, it->second);
+	}
+
+	while (!shard.entries.empty() && shard.memoryUsage + memoryUsage > m_shardMemoryBudget)
+	{
+		Erase(shard, std::prev(shard.entries.end()));
+	}
+
+	shard.entries.push_front({ key, epoch, std::move(rankedDocs), memoryUsage });
+	shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+	shard.memoryUsage += memoryUsage;
+}
+
+void QueryCache::Clear()
+{
+	for (auto& shard : m_shards)
+	{
+		std::lock_guard lock(shard.mutex);
+		shard.index.clear();
+		shard.entries.clear();
+		shard.memoryUsage = 0;
+	}
+}
+
+QueryCache::Stats QueryCache::GetStats() const
+{
+	Stats stats{ m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed), 0, 0 };
+	for (const auto& shard : m_shards)
+	{
+		std::lock_guard lock(shard.mutex);
+		stats.entriesCount += shard.entries.size();
+		stats.memoryUsage += shard.memoryUsage;
+	}
+	return stats;
+}
+
+QueryCache::Shard& QueryCache::GetShard(const std::string& key)
+{
+	return m_shards[std::hash<std::string>{}(key) % SHARDS_COUNT];
+}
+
+void QueryCache::Erase(Shard& shard, const std::list<Entry>::iterator it)
+{
+	shard.memoryUsage -= it->memoryUsage;
+	shard.index.erase(it->key);
+	shard.entries.erase(it);
+}
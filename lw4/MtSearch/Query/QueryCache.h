@@ -0,0 +1,79 @@
+#pragma once
+#include "ScoredDoc.h"
+#include "ScoringModel.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Кэш ранжированных результатов запросов. LRU разбит на шарды по хэшу ключа, чтобы параллельные запросы
+// не упирались в один мьютекс. Записи помечены эпохой индекса и после любого изменения индекса не выдаются
+class QueryCache
+{
+public:
+	struct RankedDocs
+	{
+		std::vector<ScoredDoc> docs;
+		// В списке все найденные документы, а не только первые
+		bool isComplete;
+	};
+
+	struct Stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		size_t entriesCount;
+		size_t memoryUsage;
+	};
+
+	static constexpr size_t SHARDS_COUNT = 16;
+
+	explicit QueryCache(size_t memoryBudget);
+
+	QueryCache(const QueryCache&) = delete;
+	QueryCache& operator=(const QueryCache&) = delete;
+
+	// Слова в нижнем регистре и по порядку: запросы из одних и тех же слов делят одну запись
+	static std::vector<std::string> NormalizeTerms(const std::vector<std::string>& words);
+	static std::string MakeKey(ScoringModel model, const std::vector<std::string>& terms);
+
+	// Запись подходит, если построена для той же эпохи и содержит не меньше count документов
+	std::shared_ptr<const RankedDocs> Find(const std::string& key, uint64_t epoch, size_t count);
+	void Insert(const std::string& key, uint64_t epoch, std::shared_ptr<const RankedDocs> rankedDocs);
+	void Clear();
+
+	Stats GetStats() const;
+
+private:
+	struct Entry
+	{
+		std::string key;
+		uint64_t epoch;
+		std::shared_ptr<const RankedDocs> rankedDocs;
+		size_t memoryUsage;
+	};
+
+	struct Shard
+	{
+		mutable std::mutex mutex;
+		std::list<Entry> entries;
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+		size_t memoryUsage = 0;
+	};
+
+	Shard& GetShard(const std::string& key);
+	static void Erase(Shard& shard, std::list<Entry>::iterator it);
+
+	size_t m_shardMemoryBudget;
+	std::array<Shard, SHARDS_COUNT> m_shards;
+	std::atomic<uint64_t> m_hits{ 0 };
+	std::atomic<uint64_t> m_misses{ 0 };
+};
@@ -0,0 +1,82 @@
+#include "Query/QueryCache.h"
+#include <catch2/catch_all.hpp>
+
+namespace
+{
+std::shared_ptr<const QueryCache::RankedDocs> MakeRankedDocs(const size_t count, const bool isComplete)
+{
+	QueryCache::RankedDocs rankedDocs{ {}, isComplete };
+	for (size_t i = 0; i < count; ++i)
+	{
+		rankedDocs.docs.emplace_back(i, 1.0 / static_cast<double>(i + 1));
+	}
+	return std::make_shared<const QueryCache::RankedDocs>(std::move(rankedDocs));
+}
+} // namespace
+
+TEST_CASE("Query cache")
+{
+	SECTION("Normalized key")
+	{
+		const auto key = QueryCache::MakeKey(ScoringModel::TfIdf, QueryCache::NormalizeTerms({ "Lead", "deal", "LEAD" }));
+		REQUIRE(key == QueryCache::MakeKey(ScoringModel::TfIdf, QueryCache::NormalizeTerms({ "lead", "lead", "Deal" })));
+		REQUIRE(key != QueryCache::MakeKey(ScoringModel::TfIdf, QueryCache::NormalizeTerms({ "lead", "deal" })));
+		REQUIRE(key != QueryCache::MakeKey(ScoringModel::Bm25, QueryCache::NormalizeTerms({ "Lead", "deal", "LEAD" })));
+	}
+
+	SECTION("Hits and misses")
+	{
+		QueryCache cache(1 << 20);
+		REQUIRE(cache.Find("deal ", 1, 10) == nullptr);
+
+		const auto rankedDocs = MakeRankedDocs(20, false);
+		cache.Insert("deal ", 1, rankedDocs);
+		REQUIRE(cache.Find("deal ", 1, 10) == rankedDocs);
+		REQUIRE(cache.Find("deal ", 1, 20) == rankedDocs);
+		REQUIRE(cache.Find("deal ", 1, 30) == nullptr);
+
+		const auto stats = cache.GetStats();
+		REQUIRE(stats.hits == 2);
+		REQUIRE(stats.misses == 2);
+		REQUIRE(stats.entriesCount == 1);
+		REQUIRE(stats.memoryUsage > 0);
+	}
+
+	SECTION("Complete list serves any page")
+	{
+		QueryCache cache(1 << 20);
+		cache.Insert("lead ", 1, MakeRankedDocs(3, true));
+		REQUIRE(cache.Find("lead ", 1, 1000) != nullptr);
+	}
+
+	SECTION("Epoch invalidation")
+	{
+		QueryCache cache(1 << 20);
+		cache.Insert("deal ", 1, MakeRankedDocs(10, true));
+		REQUIRE(cache.Find("deal ", 2, 10) == nullptr);
+		REQUIRE(cache.GetStats().entriesCount == 0);
+
+		cache.Insert("deal ", 3, MakeRankedDocs(10, true));
+		cache.Insert("deal ", 2, MakeRankedDocs(5, true));
+		REQUIRE(cache.Find("deal ", 3, 10)->docs.size() == 10);
+	}
+
+	SECTION("Memory budget evicts least recently used")
+	{
+		QueryCache cache(QueryCache::SHARDS_COUNT * 64 * 1024);
+		for (int i = 0; i < 2000; ++i)
+		{
+			cache.Insert("query" + std::to_string(i), 1, MakeRankedDocs(100, false));
+		}
+
+		const auto stats = cache.GetStats();
+		REQUIRE(stats.memoryUsage <= QueryCache::SHARDS_COUNT * 64 * 1024);
+		REQUIRE(stats.entriesCount < 2000);
+		REQUIRE(cache.Find("query1999", 1, 10) != nullptr);
+		REQUIRE(cache.Find("query0", 1, 10) == nullptr);
+
+		cache.Clear();
+		REQUIRE(cache.GetStats().entriesCount == 0);
+		REQUIRE(cache.GetStats().memoryUsage == 0);
+	}
+}
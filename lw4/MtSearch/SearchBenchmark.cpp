@@ -1,9 +1,63 @@
 #include "MtSearch.h"
+#include "Tokenizer/Tokenizer.h"
 #include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
 
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
 
+namespace
+{
+constexpr int SYNTHETIC_DOCS_COUNT = 40000;
+constexpr int SYNTHETIC_WORDS_PER_DOC = 200;
+constexpr int SYNTHETIC_VOCABULARY_SIZE = 5000;
+
+std::string GetSyntheticWord(const int index)
+{
+	std::string word;
+	for (int n = index + 1; n > 0; n /= 26)
+	{
+		word += static_cast<char>('a' + n % 26);
+	}
+	return word;
+}
+
+std::string CreateSyntheticCorpus()
+{
+	const auto dir = std::filesystem::temp_directory_path() / "mtsearch_bench_corpus";
+	if (std::filesystem::exists(dir / (std::to_string(SYNTHETIC_DOCS_COUNT - 1) + ".txt")))
+	{
+		return dir.string();
+	}
+	std::filesystem::create_directories(dir);
+
+	std::mt19937 random(42);
+	std::geometric_distribution<int> wordDistribution(0.002);
+	const std::vector<std::string> queryWords = { "deal", "lead", "qualify" };
+
+	for (int doc = 0; doc < SYNTHETIC_DOCS_COUNT; ++doc)
+	{
+		std::ofstream file(dir / (std::to_string(doc) + ".txt"));
+		for (int i = 0; i < SYNTHETIC_WORDS_PER_DOC; ++i)
+		{
+			if (random() % 50 == 0)
+			{
+				file << queryWords[random() % queryWords.size()] << ' ';
+				continue;
+			}
+			file << GetSyntheticWord(wordDistribution(random) % SYNTHETIC_VOCABULARY_SIZE) << ' ';
+		}
+	}
+	return dir.string();
+}
+} // namespace
+
 TEST_CASE("Search benchmark")
 {
 	std::stringstream input;
@@ -31,6 +85,30 @@ TEST_CASE("Search benchmark")
 }
 // TODO оценить степень параллелизма (закон Амдала)
 
+TEST_CASE("Search scaling benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+
+	for (int i = 1; i <= 16; i *= 2)
+	{
+		MtSearch search(input, output, i);
+		search.AddDirToIndex(dirUrl, false);
+
+		BENCHMARK_ADVANCED("Synthetic search with " + std::to_string(i) + " threads")(Catch::Benchmark::Chronometer meter)
+		{
+			meter.measure([&] {
+				return search.FindMostRelevantDocIds({
+					"deal",
+					"lead",
+					"qualify" });
+			});
+		};
+	}
+}
+
 TEST_CASE("Index benchmark")
 {
 	std::stringstream input;
@@ -51,3 +129,384 @@ TEST_CASE("Index benchmark")
 		};
 	}
 }
+
+TEST_CASE("Index scaling benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+
+	for (int i = 1; i <= 16; i *= 2)
+	{
+		BENCHMARK_ADVANCED("Synthetic indexing with " + std::to_string(i) + " threads")(Catch::Benchmark::Chronometer meter)
+		{
+			MtSearch search(input, output, i);
+			meter.measure([&] {
+				search.AddDirToIndex(dirUrl, false);
+			});
+		};
+	}
+}
+
+TEST_CASE("Search during indexing benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+
+	MtSearch search(input, output, 8);
+	search.AddDirToIndex(dirUrl, false);
+
+	std::atomic<bool> stop{ false };
+	std::jthread writer([&] {
+		while (!stop)
+		{
+			search.AddDirToIndex(dirUrl, false);
+		}
+	});
+
+	BENCHMARK_ADVANCED("Synthetic search while reindexing")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			return search.FindMostRelevantDocIds({
+				"deal",
+				"lead",
+				"qualify" });
+		});
+	};
+	stop = true;
+}
+
+TEST_CASE("Cold start benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	const auto indexPath = (std::filesystem::temp_directory_path() / "mtsearch_bench.idx").string();
+	{
+		MtSearch search(input, output, 8);
+		search.AddDirToIndex(dirUrl, false);
+		search.SaveIndex(indexPath);
+	}
+
+	BENCHMARK_ADVANCED("Reindex synthetic corpus")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			MtSearch search(input, output, 8);
+			search.AddDirToIndex(dirUrl, false);
+			return search.FindMostRelevantDocIds({ "deal" });
+		});
+	};
+
+	BENCHMARK_ADVANCED("Load synthetic index")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			MtSearch search(input, output, 8);
+			search.LoadIndex(indexPath);
+			return search.FindMostRelevantDocIds({ "deal" });
+		});
+	};
+}
+
+TEST_CASE("Sync benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	MtSearch search(input, output, 8);
+	search.SyncDir(dirUrl);
+
+	BENCHMARK_ADVANCED("Sync unchanged synthetic corpus")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			search.SyncDir(dirUrl);
+		});
+	};
+}
+
+TEST_CASE("Ingestion throughput benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+
+	uint64_t corpusBytes = 0;
+	std::string corpusText;
+	for (const auto& entry : std::filesystem::directory_iterator(dirUrl))
+	{
+		corpusBytes += entry.file_size();
+		std::ifstream file(entry.path(), std::ios::binary);
+		corpusText.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	BENCHMARK_ADVANCED("Tokenize synthetic corpus")(Catch::Benchmark::Chronometer meter)
+	{
+		TermCounter counter;
+		auto text = corpusText;
+		meter.measure([&] {
+			Tokenizer::CountTerms(text, counter);
+			const auto total = counter.GetTotalCount();
+			counter.Clear();
+			return total;
+		});
+	};
+
+	for (int i = 1; i <= 16; i *= 2)
+	{
+		MtSearch search(input, output, i);
+		const auto start = std::chrono::steady_clock::now();
+		search.AddDirToIndex(dirUrl, false);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		std::cout << "Ingestion with " << i << " threads: "
+				  << corpusBytes / elapsed.count() / (1 << 20) << " MiB/s" << std::endl;
+
+		// Узкое место — стадия с наибольшей занятостью на поток; перед ней очередь полна, после — пуста
+		const auto stats = search.GetIngestStats();
+		for (const auto& stage : stats.stages)
+		{
+			std::cout << "  " << stage.name << ": " << stage.items / stats.wallSeconds << " files/s, "
+					  << stage.bytes / stats.wallSeconds / (1 << 20) << " MiB/s, busy "
+					  << 100 * stage.busySeconds / stage.workers / stats.wallSeconds << "%" << std::endl;
+		}
+		for (const auto& [name, queue] : stats.queues)
+		{
+			std::cout << "  " << name << " queue: average depth " << queue.averageDepth << " of " << queue.capacity << std::endl;
+		}
+	}
+}
+
+TEST_CASE("Query algorithm benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	MtSearch search(input, output, 1);
+	search.AddDirToIndex(dirUrl, false);
+
+	const std::vector<std::vector<std::string>> queries = {
+		{ "deal", "lead", "qualify" },
+		{ "deal", GetSyntheticWord(0), GetSyntheticWord(1) },
+		{ GetSyntheticWord(3), GetSyntheticWord(500), GetSyntheticWord(2000), "qualify" },
+	};
+
+	for (const auto& [name, algorithm] : std::vector<std::pair<std::string, QueryAlgorithm>>{
+			 { "exhaustive", QueryAlgorithm::Exhaustive },
+			 { "maxscore", QueryAlgorithm::MaxScore },
+			 { "wand", QueryAlgorithm::Wand },
+			 { "bmw", QueryAlgorithm::BlockMaxWand } })
+	{
+		BENCHMARK_ADVANCED("Top-10 search with " + name)(Catch::Benchmark::Chronometer meter)
+		{
+			meter.measure([&] {
+				size_t found = 0;
+				for (const auto& query : queries)
+				{
+					search.ClearQueryCache();
+					found += search.FindMostRelevantDocIds(query, algorithm).size();
+				}
+				return found;
+			});
+		};
+	}
+}
+
+TEST_CASE("Query cache benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	MtSearch search(input, output, 4);
+	search.AddDirToIndex(dirUrl, false);
+
+	const std::vector<std::string> query = { "deal", "lead", "qualify" };
+	constexpr size_t PAGE_SIZE = 10;
+	constexpr size_t PAGES_COUNT = 10;
+
+	BENCHMARK_ADVANCED("Paginated search without cache")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			size_t found = 0;
+			for (size_t page = 0; page < PAGES_COUNT; ++page)
+			{
+				search.ClearQueryCache();
+				found += search.FindRelevantDocIdsRange(query, page * PAGE_SIZE, (page + 1) * PAGE_SIZE).size();
+			}
+			return found;
+		});
+	};
+
+	search.FindRelevantDocIdsRange(query, 0, PAGE_SIZE);
+	BENCHMARK_ADVANCED("Paginated search with cache hits")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			size_t found = 0;
+			for (size_t page = 0; page < PAGES_COUNT; ++page)
+			{
+				found += search.FindRelevantDocIdsRange(query, page * PAGE_SIZE, (page + 1) * PAGE_SIZE).size();
+			}
+			return found;
+		});
+	};
+
+	const auto stats = search.GetQueryCacheStats();
+	std::cout << "Query cache hits: " << stats.hits << ", misses: " << stats.misses << std::endl;
+}
+
+TEST_CASE("Scoring model benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	MtSearch search(input, output, 1);
+	search.AddDirToIndex(dirUrl, false);
+
+	for (const auto& [name, model] : std::vector<std::pair<std::string, ScoringModel>>{
+			 { "TF-IDF", ScoringModel::TfIdf },
+			 { "BM25", ScoringModel::Bm25 } })
+	{
+		search.SetScoringModel(model);
+		BENCHMARK_ADVANCED("Exhaustive search with " + name)(Catch::Benchmark::Chronometer meter)
+		{
+			meter.measure([&] {
+				search.ClearQueryCache();
+				return search.FindMostRelevantDocIds({ "deal", "lead", "qualify", GetSyntheticWord(0) });
+			});
+		};
+	}
+}
+
+TEST_CASE("Phrase query benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	for (const auto indexPositions : { false, true })
+	{
+		MtSearch search(input, output, 1);
+		search.SetIndexPositions(indexPositions);
+		const auto start = std::chrono::steady_clock::now();
+		search.AddDirToIndex(dirUrl, false);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Indexing " << (indexPositions ? "with" : "without") << " positions: " << elapsed.count() << " s" << std::endl;
+	}
+
+	MtSearch search(input, output, 1);
+	search.AddDirToIndex(dirUrl, false);
+
+	BENCHMARK_ADVANCED("Bag-of-words search")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			search.ClearQueryCache();
+			return search.FindMostRelevantDocIds({ "deal", "lead" });
+		});
+	};
+
+	BENCHMARK_ADVANCED("Phrase search")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			return search.FindPhraseDocIds({ "deal", "lead" }, PhraseMatcher::Mode::Phrase);
+		});
+	};
+
+	BENCHMARK_ADVANCED("Proximity search")(Catch::Benchmark::Chronometer meter)
+	{
+		meter.measure([&] {
+			return search.FindPhraseDocIds({ "deal", "lead", "qualify" }, PhraseMatcher::Mode::Near, 10);
+		});
+	};
+}
+
+TEST_CASE("Boolean query benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	MtSearch search(input, output, 1);
+	search.AddDirToIndex(dirUrl, false);
+
+	// Редкое слово в пересечении с частыми: время должно определяться самым коротким списком
+	const auto rareWord = GetSyntheticWord(2000);
+	for (const auto& query : std::vector<std::string>{
+			 rareWord + " AND " + GetSyntheticWord(0) + " AND " + GetSyntheticWord(1),
+			 "deal AND lead AND NOT qualify",
+			 "(deal OR lead) AND " + GetSyntheticWord(3),
+			 "deal OR lead OR qualify" })
+	{
+		BENCHMARK_ADVANCED("Boolean search: " + query)(Catch::Benchmark::Chronometer meter)
+		{
+			meter.measure([&] {
+				return search.FindBooleanDocIds(query);
+			});
+		};
+	}
+}
+
+TEST_CASE("Term pattern benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	MtSearch search(input, output, 1);
+	search.AddDirToIndex(dirUrl, false);
+
+	// Без кэша каждый запрос заново раскрывает шаблон по словарям всех сегментов
+	for (const auto& word : std::vector<std::string>{ "deal", "de*", "d?al", "*al", "deal~1", "qualifi~2" })
+	{
+		BENCHMARK_ADVANCED("Top-10 search for " + word)(Catch::Benchmark::Chronometer meter)
+		{
+			meter.measure([&] {
+				search.ClearQueryCache();
+				return search.FindMostRelevantDocIds({ word });
+			});
+		};
+	}
+}
+
+TEST_CASE("Sharded search benchmark")
+{
+	std::stringstream input;
+	std::stringstream output;
+
+	const auto dirUrl = CreateSyntheticCorpus();
+	const std::vector<std::string> query = { "deal", "lead", GetSyntheticWord(3) };
+	const auto threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+	std::vector<double> expectedScores;
+	for (const size_t shards : { 1, 2, 4, 8 })
+	{
+		MtSearch search(input, output, threads, { shards, true });
+		search.AddDirToIndex(dirUrl, false);
+
+		// Идентификаторы документов зависят от шарда, а оценки и их порядок — нет
+		std::vector<double> scores;
+		for (const auto& [docId, score] : search.FindMostRelevantDocIds(query))
+		{
+			scores.push_back(score);
+		}
+		if (expectedScores.empty())
+		{
+			expectedScores = scores;
+		}
+		REQUIRE(scores == expectedScores);
+
+		BENCHMARK_ADVANCED("Top-10 search with " + std::to_string(shards) + " shards")(Catch::Benchmark::Chronometer meter)
+		{
+			meter.measure([&] {
+				search.ClearQueryCache();
+				return search.FindMostRelevantDocIds(query, QueryAlgorithm::BlockMaxWand);
+			});
+		};
+	}
+}
@@ -0,0 +1,213 @@
+#include "Query/TermPattern.h"
+#include <algorithm>
+#include <catch2/catch_all.hpp>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+
+namespace
+{
+struct Dictionary
+{
+	std::vector<std::string> terms;
+	TermDictionary::Encoded encoded;
+	TermDictionary dictionary;
+};
+
+std::unique_ptr<Dictionary> MakeDictionary(std::vector<std::string> terms)
+{
+	std::ranges::sort(terms);
+	terms.erase(std::ranges::unique(terms).begin(), terms.end());
+
+	auto result = std::make_unique<Dictionary>();
+	result->terms = std::move(terms);
+	result->encoded = TermDictionary::Encode(result->terms);
+	result->dictionary = TermDictionary(result->terms.size(), result->encoded.blockOffsets, result->encoded.bytes);
+	return result;
+}
+
+std::vector<std::string> MakeRandomTerms(std::mt19937& random, const size_t count)
+{
+	// Маленький алфавит даёт много общих префиксов
+	std::vector<std::string> terms;
+	for (size_t i = 0; i < count; ++i)
+	{
+		std::string term(1 + random() % 8, 'a');
+		for (auto& c : term)
+		{
+			c = static_cast<char>('a' + random() % 5);
+		}
+		terms.push_back(std::move(term));
+	}
+	return terms;
+}
+
+uint32_t GetEditDistance(const std::string_view left, const std::string_view right)
+{
+	std::vector<uint32_t> previous(right.size() + 1);
+	std::vector<uint32_t> current(right.size() + 1);
+	std::iota(previous.begin(), previous.end(), 0u);
+	for (size_t i = 1; i <= left.size(); ++i)
+	{
+		current[0] = static_cast<uint32_t>(i);
+		for (size_t j = 1; j <= right.size(); ++j)
+		{
+			current[j] = std::min({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (left[i - 1] == right[j - 1] ? 0u : 1u) });
+		}
+		std::swap(previous, current);
+	}
+	return previous.back();
+}
+
+bool MatchesWildcard(const std::string_view text, const std::string_view pattern)
+{
+	if (pattern.empty())
+	{
+		return text.empty();
+	}
+	if (pattern[0] == '*')
+	{
+		return MatchesWildcard(text, pattern.substr(1)) || (!text.empty() && MatchesWildcard(text.substr(1), pattern));
+	}
+	return !text.empty() && (pattern[0] == '?' || pattern[0] == text[0]) && MatchesWildcard(text.substr(1), pattern.substr(1));
+}
+
+template <typename Predicate>
+std::vector<uint32_t> FilterTerms(const std::vector<std::string>& terms, Predicate&& predicate)
+{
+	std::vector<uint32_t> result;
+	for (uint32_t ordinal = 0; ordinal < terms.size(); ++ordinal)
+	{
+		if (predicate(terms[ordinal]))
+		{
+			result.push_back(ordinal);
+		}
+	}
+	return result;
+}
+} // namespace
+
+TEST_CASE("Term dictionary lookup")
+{
+	std::mt19937 random(3);
+	const auto data = MakeDictionary(MakeRandomTerms(random, 2000));
+	const auto& terms = data->terms;
+	const auto& dictionary = data->dictionary;
+	REQUIRE(dictionary.GetSize() == terms.size());
+
+	SECTION("Sequential and random access")
+	{
+		uint32_t ordinal = 0;
+		for (TermDictionary::Iterator it(dictionary, 0); it.IsValid(); it.Next())
+		{
+			REQUIRE(it.GetOrdinal() == ordinal);
+			REQUIRE(it.GetTerm() == terms[ordinal]);
+			++ordinal;
+		}
+		REQUIRE(ordinal == terms.size());
+
+		for (uint32_t i = 0; i < terms.size(); i += 7)
+		{
+			REQUIRE(dictionary.GetTerm(i) == terms[i]);
+			REQUIRE(dictionary.Find(terms[i]) == i);
+		}
+	}
+
+	SECTION("Missing terms")
+	{
+		REQUIRE_FALSE(dictionary.Find("").has_value());
+		REQUIRE_FALSE(dictionary.Find("z").has_value());
+		REQUIRE_FALSE(dictionary.Find("aaaaaaaaa").has_value());
+		REQUIRE(dictionary.LowerBound("") == 0);
+		REQUIRE(dictionary.LowerBound("z") == terms.size());
+	}
+
+	SECTION("Prefix and wildcard expansion")
+	{
+		for (const std::string prefix : { "", "a", "ab", "edc", "bbbbbbbb" })
+		{
+			REQUIRE(dictionary.FindByPrefix(prefix) == FilterTerms(terms, [&](const std::string& term) {
+				return term.starts_with(prefix);
+			}));
+		}
+		for (const std::string pattern : { "a*", "*b", "a?c*", "*c?d*", "?", "e*a*e", "*", "abcde" })
+		{
+			REQUIRE(dictionary.FindByWildcard(pattern) == FilterTerms(terms, [&](const std::string& term) {
+				return MatchesWildcard(term, pattern);
+			}));
+		}
+	}
+
+	SECTION("Edit distance expansion")
+	{
+		for (int i = 0; i < 50; ++i)
+		{
+			const auto query = MakeRandomTerms(random, 1).front();
+			const auto maxEdits = static_cast<uint32_t>(i % 3);
+			REQUIRE(dictionary.FindByEditDistance(query, maxEdits) == FilterTerms(terms, [&](const std::string& term) {
+				return GetEditDistance(term, query) <= maxEdits;
+			}));
+		}
+	}
+}
+
+TEST_CASE("Term dictionary edge cases")
+{
+	SECTION("Empty dictionary")
+	{
+		const auto data = MakeDictionary({});
+		REQUIRE(data->dictionary.GetSize() == 0);
+		REQUIRE_FALSE(data->dictionary.Find("deal").has_value());
+		REQUIRE(data->dictionary.FindByWildcard("*").empty());
+		REQUIRE(data->dictionary.FindByEditDistance("deal", 2).empty());
+	}
+
+	SECTION("Front coding shrinks shared prefixes")
+	{
+		std::vector<std::string> terms;
+		for (int i = 0; i < 1000; ++i)
+		{
+			terms.push_back("international" + std::to_string(i));
+		}
+		const auto data = MakeDictionary(terms);
+		size_t plainSize = 0;
+		for (const auto& term : terms)
+		{
+			plainSize += term.size() + sizeof(uint64_t);
+		}
+		REQUIRE(data->dictionary.GetMemoryUsage() * 3 < plainSize);
+	}
+
+	SECTION("Corrupted offsets")
+	{
+		const auto data = MakeDictionary({ "deal", "lead" });
+		REQUIRE_THROWS(TermDictionary(TermDictionary::BLOCK_SIZE + 1, data->encoded.blockOffsets, data->encoded.bytes));
+		REQUIRE_THROWS(TermDictionary(2, data->encoded.blockOffsets, std::span(data->encoded.bytes).first(3)));
+	}
+}
+
+TEST_CASE("Term pattern parsing")
+{
+	const auto exact = TermPattern::Parse("Deal");
+	REQUIRE(exact.type == TermPattern::Type::Exact);
+	REQUIRE(exact.text == "deal");
+
+	REQUIRE(TermPattern::Parse("de*l").type == TermPattern::Type::Wildcard);
+	REQUIRE(TermPattern::Parse("de?l").type == TermPattern::Type::Wildcard);
+
+	const auto fuzzy = TermPattern::Parse("deal~");
+	REQUIRE(fuzzy.type == TermPattern::Type::Fuzzy);
+	REQUIRE(fuzzy.text == "deal");
+	REQUIRE(fuzzy.maxEdits == 1);
+	REQUIRE(TermPattern::Parse("deal~2").maxEdits == 2);
+	REQUIRE(TermPattern::Parse("deal~9").maxEdits == TermPattern::MAX_EDITS);
+	REQUIRE(TermPattern::Parse("deal~x").type == TermPattern::Type::Exact);
+	REQUIRE(TermPattern::Parse("~").type == TermPattern::Type::Exact);
+
+	const auto data = MakeDictionary({ "deal", "dial", "lead", "leads" });
+	REQUIRE(TermPattern::Parse("lea*").Expand(data->dictionary) == std::vector<uint32_t>{ 2, 3 });
+	REQUIRE(TermPattern::Parse("deal~").Expand(data->dictionary) == std::vector<uint32_t>{ 0, 1 });
+	REQUIRE(TermPattern::Parse("lead").Expand(data->dictionary) == std::vector<uint32_t>{ 2 });
+	REQUIRE(TermPattern::Parse("lean").Expand(data->dictionary).empty());
+}
@@ -0,0 +1,325 @@
+#include "ThreadPool.h"
+#include "NumaTopology.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace
+{
+thread_local const ThreadPool* t_currentPool = nullptr;
+thread_local size_t t_workerIndex = 0;
+} // namespace
+
+ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool)
+	: m_pool(pool)
+{
+}
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+	WaitForTasks();
+}
+
+void ThreadPool::TaskGroup::Run(std::function<void()> task)
+{
+	m_pending.fetch_add(1);
+	if (m_pool.IsCurrentThreadWorker() && m_pool.AreAllWorkersBusy())
+	{
+		Execute(task);
+		return;
+	}
+	m_pool.Enqueue({ std::move(task), this });
+}
+
+void ThreadPool::TaskGroup::Wait()
+{
+	WaitForTasks();
+
+	std::lock_guard lock(m_mutex);
+	if (m_exception)
+	{
+		std::rethrow_exception(std::exchange(m_exception, nullptr));
+	}
+}
+
+void ThreadPool::TaskGroup::WaitForTasks()
+{
+	if (m_pool.IsCurrentThreadWorker())
+	{
+		m_pool.RunTasksUntilDone(*this);
+	}
+
+	std::unique_lock lock(m_mutex);
+	m_cvDone.wait(lock, [this] {
+		return m_pending.load() == 0;
+	});
+}
+
+void ThreadPool::TaskGroup::Execute(const std::function<void()>& task)
+{
+	std::exception_ptr exception;
+	try
+	{
+		task();
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	std::lock_guard lock(m_mutex);
+	if (exception && !m_exception)
+	{
+		m_exception = exception;
+	}
+	if (m_pending.fetch_sub(1) == 1)
+	{
+		m_cvDone.notify_all();
+		m_pool.NotifyGroupDone(*this);
+	}
+}
+
+ThreadPool::ThreadPool(const int threads)
+	: ThreadPool(threads, {})
+{
+}
+
+ThreadPool::ThreadPool(const int threads, std::vector<int> cpus)
+	: m_cpus(std::move(cpus))
+{
+	const auto threadsCount = static_cast<size_t>(std::max(threads, 1));
+	for (size_t i = 0; i < threadsCount; ++i)
+	{
+		m_workerQueues.push_back(std::make_unique<WorkerQueue>());
+	}
+	for (size_t i = 0; i < threadsCount; ++i)
+	{
+		m_workers.emplace_back([this, i] {
+			WorkerLoop(i);
+		});
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_sleepMutex);
+		m_stop = true;
+	}
+	m_cvTaskQueued.notify_all();
+	m_workers.clear();
+}
+
+void ThreadPool::Post(std::function<void()> task)
+{
+	Enqueue({ std::move(task), nullptr });
+}
+
+void ThreadPool::ParallelFor(const size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	TaskGroup group(*this);
+	for (size_t i = 1; i < count; ++i)
+	{
+		group.Run([&body, i] {
+			body(i);
+		});
+	}
+	body(0);
+	group.Wait();
+}
+
+int ThreadPool::GetThreadCount() const
+{
+	return static_cast<int>(m_workers.size());
+}
+
+void ThreadPool::WorkerLoop(const size_t index)
+{
+	t_currentPool = this;
+	t_workerIndex = index;
+	if (!m_cpus.empty() && !PinCurrentThread(m_cpus))
+	{
+		std::cerr << "Cannot pin thread pool worker to CPUs" << std::endl;
+	}
+
+	while (true)
+	{
+		if (auto task = TryPopTask(index))
+		{
+			RunTask(*task);
+			continue;
+		}
+
+		std::unique_lock lock(m_sleepMutex);
+		if (m_stop && m_queuedTasks.load() == 0)
+		{
+			return;
+		}
+		m_idleWorkers.fetch_add(1);
+		m_cvTaskQueued.wait(lock, [this] {
+			return m_stop || m_queuedTasks.load() > 0;
+		});
+		m_idleWorkers.fetch_sub(1);
+	}
+}
+
+void ThreadPool::Enqueue(Task task)
+{
+	m_queuedTasks.fetch_add(1);
+
+	auto& queue = IsCurrentThreadWorker()
+		? *m_workerQueues[t_workerIndex]
+		: m_sharedQueue;
+	{
+		std::lock_guard lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	NotifyTaskQueued();
+}
+
+std::optional<ThreadPool::Task> ThreadPool::TryPopTask(const size_t workerIndex)
+{
+	auto popFrom = [this](WorkerQueue& queue, const bool fromBack) -> std::optional<Task> {
+		std::lock_guard lock(queue.mutex);
+		if (queue.tasks.empty())
+		{
+			return std::nullopt;
+		}
+		Task task;
+		if (fromBack)
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		m_queuedTasks.fetch_sub(1);
+		return task;
+	};
+
+	if (auto task = popFrom(*m_workerQueues[workerIndex], true))
+	{
+		return task;
+	}
+	if (auto task = popFrom(m_sharedQueue, false))
+	{
+		return task;
+	}
+	for (size_t i = 1; i < m_workerQueues.size(); ++i)
+	{
+		const auto victim = (workerIndex + i) % m_workerQueues.size();
+		if (auto task = popFrom(*m_workerQueues[victim], false))
+		{
+			return task;
+		}
+	}
+	return std::nullopt;
+}
+
+std::optional<ThreadPool::Task> ThreadPool::TryPopGroupTask(const size_t workerIndex, const TaskGroup* group)
+{
+	auto& queue = *m_workerQueues[workerIndex];
+	std::lock_guard lock(queue.mutex);
+	if (queue.tasks.empty() || queue.tasks.back().group != group)
+	{
+		return std::nullopt;
+	}
+	auto task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	m_queuedTasks.fetch_sub(1);
+	return task;
+}
+
+// Ждущий рабочий поток не просто спит: задачи группы могут стоять за чужими задачами в очередях других потоков,
+// и если все потоки пула ждут, выполнить их больше некому
+void ThreadPool::RunTasksUntilDone(TaskGroup& group)
+{
+	while (group.m_pending.load() > 0)
+	{
+		auto task = TryPopGroupTask(t_workerIndex, &group);
+		if (!task)
+		{
+			task = TryPopTask(t_workerIndex);
+		}
+		if (task)
+		{
+			RunTask(*task);
+			continue;
+		}
+
+		std::unique_lock lock(m_sleepMutex);
+		group.m_workerWaiters.fetch_add(1);
+		m_idleWorkers.fetch_add(1);
+		m_cvTaskQueued.wait(lock, [this, &group] {
+			return group.m_pending.load() == 0 || m_queuedTasks.load() > 0;
+		});
+		m_idleWorkers.fetch_sub(1);
+		group.m_workerWaiters.fetch_sub(1);
+	}
+}
+
+void ThreadPool::NotifyGroupDone(const TaskGroup& group)
+{
+	if (group.m_workerWaiters.load() == 0)
+	{
+		return;
+	}
+	{
+		std::lock_guard lock(m_sleepMutex);
+	}
+	// notify_one мог бы достаться простаивающему потоку, который снова уснёт
+	m_cvTaskQueued.notify_all();
+}
+
+void ThreadPool::RunTask(Task& task)
+{
+	if (task.group != nullptr)
+	{
+		task.group->Execute(task.function);
+		return;
+	}
+
+	try
+	{
+		task.function();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Thread pool task failed: " << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << "Thread pool task failed with unknown exception" << std::endl;
+	}
+}
+
+void ThreadPool::NotifyTaskQueued()
+{
+	if (m_idleWorkers.load() == 0)
+	{
+		return;
+	}
+	{
+		std::lock_guard lock(m_sleepMutex);
+	}
+	m_cvTaskQueued.notify_one();
+}
+
+bool ThreadPool::IsCurrentThreadWorker() const
+{
+	return t_currentPool == this;
+}
+
+bool ThreadPool::AreAllWorkersBusy() const
+{
+	return m_idleWorkers.load() == 0;
+}
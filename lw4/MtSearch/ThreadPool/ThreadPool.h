@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	class TaskGroup
+	{
+	public:
+		explicit TaskGroup(ThreadPool& pool);
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		void Run(std::function<void()> task);
+		void Wait();
+
+	private:
+		friend class ThreadPool;
+
+		void WaitForTasks();
+		void Execute(const std::function<void()>& task);
+
+		ThreadPool& m_pool;
+		std::atomic<size_t> m_pending{ 0 };
+		// Рабочие потоки пула, которые ждут группу вместе с простаивающими
+		std::atomic<size_t> m_workerWaiters{ 0 };
+		std::mutex m_mutex;
+		std::condition_variable m_cvDone;
+		std::exception_ptr m_exception;
+	};
+
+	explicit ThreadPool(int threads);
+	// Рабочие потоки привязываются к перечисленным процессорам, например к процессорам одного NUMA-узла
+	ThreadPool(int threads, std::vector<int> cpus);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Post(std::function<void()> task);
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	int GetThreadCount() const;
+
+private:
+	struct Task
+	{
+		std::function<void()> function;
+		TaskGroup* group = nullptr;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void WorkerLoop(size_t index);
+	void Enqueue(Task task);
+	std::optional<Task> TryPopTask(size_t workerIndex);
+	std::optional<Task> TryPopGroupTask(size_t workerIndex, const TaskGroup* group);
+	void RunTasksUntilDone(TaskGroup& group);
+	void NotifyGroupDone(const TaskGroup& group);
+	static void RunTask(Task& task);
+	void NotifyTaskQueued();
+	bool IsCurrentThreadWorker() const;
+	bool AreAllWorkersBusy() const;
+
+	std::vector<int> m_cpus;
+	std::vector<std::unique_ptr<WorkerQueue>> m_workerQueues;
+	WorkerQueue m_sharedQueue;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_cvTaskQueued;
+	std::atomic<size_t> m_queuedTasks{ 0 };
+	std::atomic<size_t> m_idleWorkers{ 0 };
+	bool m_stop = false;
+
+	std::vector<std::jthread> m_workers;
+};
@@ -0,0 +1,96 @@
+#include "TermCounter.h"
+
+#include <functional>
+
+TermCounter::TermCounter(const bool recordPositions)
+	: m_recordPositions(recordPositions)
+{
+}
+
+void TermCounter::Add(const std::string_view term)
+{
+	const auto hash = std::hash<std::string_view>{}(term);
+	const auto slot = FindSlot(term, hash);
+	const auto position = m_totalCount++;
+
+	if (m_slots[slot] != 0)
+	{
+		const auto index = m_slots[slot] - 1;
+		++m_entries[index].count;
+		if (m_recordPositions)
+		{
+			m_entryPositions[index].push_back(position);
+			m_entries[index].positions = m_entryPositions[index];
+		}
+		return;
+	}
+
+	m_entries.push_back({ term, 1, {} });
+	m_entryHashes.push_back(hash);
+	m_slots[slot] = static_cast<uint32_t>(m_entries.size());
+	if (m_recordPositions)
+	{
+		if (m_entryPositions.size() < m_entries.size())
+		{
+			m_entryPositions.emplace_back();
+		}
+		m_entryPositions[m_entries.size() - 1].push_back(position);
+		m_entries.back().positions = m_entryPositions[m_entries.size() - 1];
+	}
+	if (m_entries.size() * 2 > m_slots.size())
+	{
+		Grow();
+	}
+}
+
+void TermCounter::Clear()
+{
+	// Освобождаем слоты в обратном порядке вставки, чтобы цепочки проб более ранних терминов оставались целыми
+	for (auto i = m_entries.size(); i-- > 0;)
+	{
+		m_slots[FindSlot(m_entries[i].term, m_entryHashes[i])] = 0;
+		if (m_recordPositions)
+		{
+			m_entryPositions[i].clear();
+		}
+	}
+	m_entries.clear();
+	m_entryHashes.clear();
+	m_totalCount = 0;
+}
+
+std::span<const TermCounter::Entry> TermCounter::GetEntries() const
+{
+	return m_entries;
+}
+
+uint32_t TermCounter::GetTotalCount() const
+{
+	return m_totalCount;
+}
+
+void TermCounter::Grow()
+{
+	m_slots.assign(m_slots.size() * 2, 0);
+	for (size_t i = 0; i < m_entries.size(); ++i)
+	{
+		m_slots[FindSlot(m_entries[i].term, m_entryHashes[i])] = static_cast<uint32_t>(i + 1);
+	}
+}
+
+size_t TermCounter::FindSlot(const std::string_view term, const size_t hash) const
+{
+	const auto mask = m_slots.size() - 1;
+	for (auto slot = hash & mask;; slot = (slot + 1) & mask)
+	{
+		if (m_slots[slot] == 0)
+		{
+			return slot;
+		}
+		const auto index = m_slots[slot] - 1;
+		if (m_entryHashes[index] == hash && m_entries[index].term == term)
+		{
+			return slot;
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#include "Tokenizer.h"
+
+#include <bit>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr size_t CHUNK_SIZE = 64;
+constexpr char CASE_BIT = 0x20;
+
+uint64_t ClassifyBytes(char* data, const size_t count)
+{
+	uint64_t letters = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto lowered = static_cast<char>(data[i] | CASE_BIT);
+		if (lowered >= 'a' && lowered <= 'z')
+		{
+			data[i] = lowered;
+			letters |= uint64_t{ 1 } << i;
+		}
+	}
+	return letters;
+}
+
+// Возвращает маску букв среди CHUNK_SIZE байт и переводит эти буквы в нижний регистр
+uint64_t ClassifyChunk(char* data)
+{
+#if defined(__AVX2__)
+	const auto caseBit = _mm256_set1_epi8(CASE_BIT);
+	const auto firstLetter = _mm256_set1_epi8('a');
+	const auto lettersRange = _mm256_set1_epi8('z' - 'a');
+
+	uint64_t letters = 0;
+	for (size_t i = 0; i < CHUNK_SIZE; i += 32)
+	{
+		auto* ptr = reinterpret_cast<__m256i*>(data + i);
+		const auto bytes = _mm256_loadu_si256(ptr);
+		const auto lowered = _mm256_or_si256(bytes, caseBit);
+		const auto offset = _mm256_sub_epi8(lowered, firstLetter);
+		const auto isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, lettersRange), offset);
+
+		_mm256_storeu_si256(ptr, _mm256_blendv_epi8(bytes, lowered, isLetter));
+		letters |= uint64_t{ static_cast<uint32_t>(_mm256_movemask_epi8(isLetter)) } << i;
+	}
+	return letters;
+#elif defined(__SSE2__)
+	const auto caseBit = _mm_set1_epi8(CASE_BIT);
+	const auto firstLetter = _mm_set1_epi8('a');
+	const auto lettersRange = _mm_set1_epi8('z' - 'a');
+
+	uint64_t letters = 0;
+	for (size_t i = 0; i < CHUNK_SIZE; i += 16)
+	{
+		auto* ptr = reinterpret_cast<__m128i*>(data + i);
+		const auto bytes = _mm_loadu_si128(ptr);
+		const auto lowered = _mm_or_si128(bytes, caseBit);
+		const auto offset = _mm_sub_epi8(lowered, firstLetter);
+		const auto isLetter = _mm_cmpeq_epi8(_mm_min_epu8(offset, lettersRange), offset);
+
+		_mm_storeu_si128(ptr, _mm_or_si128(_mm_and_si128(isLetter, lowered), _mm_andnot_si128(isLetter, bytes)));
+		letters |= uint64_t{ static_cast<uint16_t>(_mm_movemask_epi8(isLetter)) } << i;
+	}
+	return letters;
+#else
+	return ClassifyBytes(data, CHUNK_SIZE);
+#endif
+}
+} // namespace
+
+void Tokenizer::CountTerms(const std::span<char> text, TermCounter& counter)
+{
+	auto* data = text.data();
+	size_t wordStart = 0;
+	bool inWord = false;
+
+	auto processChunk = [&](const uint64_t letters, const size_t chunkStart, const size_t chunkSize) {
+		const auto validBits = chunkSize == CHUNK_SIZE ? ~uint64_t{ 0 } : (uint64_t{ 1 } << chunkSize) - 1;
+		size_t offset = 0;
+		while (offset < chunkSize)
+		{
+			const auto boundaries = (inWord ? ~letters : letters) & validBits & (~uint64_t{ 0 } << offset);
+			if (boundaries == 0)
+			{
+				return;
+			}
+			offset = std::countr_zero(boundaries);
+			if (inWord)
+			{
+				counter.Add(std::string_view(data + wordStart, chunkStart + offset - wordStart));
+			}
+			else
+			{
+				wordStart = chunkStart + offset;
+			}
+			inWord = !inWord;
+		}
+	};
+
+	size_t pos = 0;
+	for (; pos + CHUNK_SIZE <= text.size(); pos += CHUNK_SIZE)
+	{
+		processChunk(ClassifyChunk(data + pos), pos, CHUNK_SIZE);
+	}
+	processChunk(ClassifyBytes(data + pos, text.size() - pos), pos, text.size() - pos);
+
+	if (inWord)
+	{
+		counter.Add(std::string_view(data + wordStart, text.size() - wordStart));
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "TermCounter.h"
+
+#include <span>
+
+class Tokenizer
+{
+public:
+	// Слово — непрерывная серия латинских букв. Буквы переводятся в нижний регистр прямо в буфере,
+	// а счётчик получает string_view на этот буфер
+	static void CountTerms(std::span<char> text, TermCounter& counter);
+};
@@ -0,0 +1,125 @@
+#include "Tokenizer/Tokenizer.h"
+#include <catch2/catch_all.hpp>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::map<std::string, uint32_t> CountTerms(std::string text)
+{
+	TermCounter counter;
+	Tokenizer::CountTerms(text, counter);
+
+	std::map<std::string, uint32_t> result;
+	for (const auto& entry : counter.GetEntries())
+	{
+		result[std::string(entry.term)] = entry.count;
+	}
+	return result;
+}
+
+std::map<std::string, uint32_t> CountTermsScalar(const std::string& text)
+{
+	std::map<std::string, uint32_t> result;
+	std::string word;
+	for (const auto c : text)
+	{
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+		{
+			word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			continue;
+		}
+		if (!word.empty())
+		{
+			++result[word];
+			word.clear();
+		}
+	}
+	if (!word.empty())
+	{
+		++result[word];
+	}
+	return result;
+}
+} // namespace
+
+TEST_CASE("Tokenizer")
+{
+	SECTION("Words are lowercased latin runs")
+	{
+		const auto terms = CountTerms("Deal, deal; LEAD@qualify[x]`y` {z} привет\n");
+		REQUIRE(terms == std::map<std::string, uint32_t>{
+					{ "deal", 2 }, { "lead", 1 }, { "qualify", 1 }, { "x", 1 }, { "y", 1 }, { "z", 1 } });
+	}
+
+	SECTION("Empty and separator-only text")
+	{
+		REQUIRE(CountTerms("").empty());
+		REQUIRE(CountTerms(std::string(200, ' ')).empty());
+	}
+
+	SECTION("Words crossing chunk boundaries")
+	{
+		const std::string word(150, 'a');
+		REQUIRE(CountTerms(word) == std::map<std::string, uint32_t>{ { word, 1 } });
+		REQUIRE(CountTerms(std::string(63, ' ') + "Ab" + std::string(63, ' ') + "ab") == std::map<std::string, uint32_t>{ { "ab", 2 } });
+	}
+
+	SECTION("Matches scalar reference on random text")
+	{
+		std::mt19937 random(1);
+		const std::string alphabet = "abcXYZ @[`{09\n\xd0\xbf";
+		for (int i = 0; i < 200; ++i)
+		{
+			std::string text(random() % 1000, ' ');
+			for (auto& c : text)
+			{
+				c = alphabet[random() % alphabet.size()];
+			}
+			REQUIRE(CountTerms(text) == CountTermsScalar(text));
+		}
+	}
+
+	SECTION("Counter is reusable")
+	{
+		TermCounter counter;
+		std::string first = "one two two";
+		Tokenizer::CountTerms(first, counter);
+		REQUIRE(counter.GetTotalCount() == 3);
+		counter.Clear();
+
+		std::string second;
+		for (int i = 0; i < 1000; ++i)
+		{
+			second += "w" + std::string(1, static_cast<char>('a' + i % 26)) + std::string(1, static_cast<char>('a' + i / 26 % 26)) + " ";
+		}
+		Tokenizer::CountTerms(second, counter);
+		REQUIRE(counter.GetTotalCount() == 1000);
+		REQUIRE(counter.GetEntries().size() == 676);
+	}
+
+	SECTION("Positions are recorded on request")
+	{
+		TermCounter counter(true);
+		std::string text = "To be, or not to BE";
+		Tokenizer::CountTerms(text, counter);
+
+		std::map<std::string, std::vector<uint32_t>> positions;
+		for (const auto& entry : counter.GetEntries())
+		{
+			REQUIRE(entry.positions.size() == entry.count);
+			positions[std::string(entry.term)].assign(entry.positions.begin(), entry.positions.end());
+		}
+		REQUIRE(positions == std::map<std::string, std::vector<uint32_t>>{
+					{ "to", { 0, 4 } }, { "be", { 1, 5 } }, { "or", { 2 } }, { "not", { 3 } } });
+
+		counter.Clear();
+		std::string next = "be be";
+		Tokenizer::CountTerms(next, counter);
+		REQUIRE(counter.GetEntries().size() == 1);
+		REQUIRE(std::vector<uint32_t>(counter.GetEntries()[0].positions.begin(), counter.GetEntries()[0].positions.end())
+			== std::vector<uint32_t>{ 0, 1 });
+	}
+}
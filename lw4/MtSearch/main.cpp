@@ -2,12 +2,17 @@
 
 #include <chrono>
 #include <iostream>
+#include <string>
 
-int main()
+// MtSearch [шардов [numa]]
+int main(int argc, char* argv[])
 {
 	try
 	{
-		MtSearch search(std::cin, std::cout, 16);
+		ShardOptions shardOptions;
+		shardOptions.count = argc > 1 ? std::stoul(argv[1]) : 1;
+		shardOptions.pinToNumaNodes = argc > 2 && std::string(argv[2]) == "numa";
+		MtSearch search(std::cin, std::cout, 16, shardOptions);
 		search.Run();
 	}
 	catch (const std::exception& e)
@@ -0,0 +1,207 @@
+#include "backend/FileInfoOutput.h"
+#include "backend/JsonConverter.h"
+#include "backend/Server/BufferBody.h"
+#include "backend/Server/BufferPool.h"
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/write.hpp>
+#include <boost/json.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace http = boost::beast::http;
+namespace json = boost::json;
+
+namespace
+{
+constexpr size_t REQUESTS_PER_THREAD = 2000;
+
+std::atomic<size_t> g_allocations{ 0 };
+
+// Вместо сокета: ответ сериализуется так же, как при отправке, но байты только считаются
+struct NullStream
+{
+	size_t bytesWritten = 0;
+
+	template <class ConstBufferSequence>
+	size_t write_some(const ConstBufferSequence& buffers)
+	{
+		const auto size = boost::asio::buffer_size(buffers);
+		bytesWritten += size;
+		return size;
+	}
+
+	template <class ConstBufferSequence>
+	size_t write_some(const ConstBufferSequence& buffers, boost::beast::error_code& errorCode)
+	{
+		errorCode = {};
+		return write_some(buffers);
+	}
+};
+
+std::vector<FileInfoOutput> CreatePage(const size_t size)
+{
+	std::vector<FileInfoOutput> page;
+	for (size_t i = 0; i < size; ++i)
+	{
+		page.push_back({ i * 7919, 1.0 / static_cast<double>(i + 1),
+			"/home/user/projects/crm/crm-app/lib/module" + std::to_string(i % 37) + "/Service" + std::to_string(i) + ".php" });
+	}
+	return page;
+}
+
+// Прежний путь: копия и пересортировка выдачи, дерево json::value и строка-тело
+size_t WriteDomResponse(const std::vector<FileInfoOutput>& filesInfo, NullStream& stream)
+{
+	auto filesData = filesInfo;
+	std::ranges::sort(filesData, std::ranges::greater{}, &FileInfoOutput::relevant);
+
+	json::array fileLinks;
+	for (const auto& fileInfo : filesData)
+	{
+		fileLinks.push_back(json::object{
+			{ "fileId", fileInfo.id },
+			{ "fileRelevant", fileInfo.relevant },
+			{ "fileUrl", fileInfo.fileUrl },
+		});
+	}
+
+	http::response<http::string_body> res{ http::status::ok, 11 };
+	res.set(http::field::content_type, "application/json");
+	res.body() = json::serialize(json::object{ { "data", std::move(fileLinks) } });
+	res.prepare_payload();
+	http::write(stream, res);
+	return res.body().size();
+}
+
+// Новый путь: JSON пишется сразу в буфер сессии, ответ ссылается на него
+size_t WriteStreamingResponse(const std::vector<FileInfoOutput>& filesInfo, std::string& buffer, NullStream& stream)
+{
+	buffer.clear();
+	JsonWriter writer(buffer);
+	writer.BeginObject();
+	writer.Key("data");
+	writer.BeginArray();
+	for (const auto& fileInfo : filesInfo)
+	{
+		JsonConverter::WriteFileInfo(writer, fileInfo);
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	http::response<BufferBody> res{ http::status::ok, 11 };
+	res.set(http::field::content_type, "application/json");
+	res.body() = &buffer;
+	res.prepare_payload();
+	http::write(stream, res);
+	return buffer.size();
+}
+
+// Потоки вычислительного пула одновременно готовят ответы, как под нагрузкой; у каждого свой буфер
+// из общего пула, как у keep-alive сессии
+template <typename WriteResponse>
+void RunLoad(const std::string& name, const size_t pageSize, const WriteResponse& writeResponse)
+{
+	const auto page = CreatePage(pageSize);
+	const auto threads = std::max(std::thread::hardware_concurrency(), 1u);
+	BufferPool bufferPool(threads, 1 << 20);
+
+	const auto allocationsBefore = g_allocations.load();
+	const auto start = std::chrono::steady_clock::now();
+	{
+		std::vector<std::jthread> workers;
+		for (unsigned i = 0; i < threads; ++i)
+		{
+			workers.emplace_back([&] {
+				auto buffer = bufferPool.Acquire();
+				NullStream stream;
+				for (size_t request = 0; request < REQUESTS_PER_THREAD; ++request)
+				{
+					writeResponse(page, buffer, stream);
+				}
+				bufferPool.Release(std::move(buffer));
+			});
+		}
+	}
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const auto requests = static_cast<double>(threads * REQUESTS_PER_THREAD);
+
+	std::cout << name << ", page " << pageSize
+			  << ": requests/s " << requests / seconds
+			  << ", allocations/request " << static_cast<double>(g_allocations.load() - allocationsBefore) / requests
+			  << std::endl;
+}
+} // namespace
+
+void* operator new(const size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (auto* pointer = std::malloc(size != 0 ? size : 1))
+	{
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+TEST_CASE("Streaming JSON matches DOM serialization")
+{
+	const auto page = CreatePage(3);
+	std::string buffer;
+	NullStream stream;
+	WriteStreamingResponse(page, buffer, stream);
+	REQUIRE(json::parse(buffer) == json::parse(json::serialize(json::object{ { "data", json::array{
+		json::object{ { "fileId", page[0].id }, { "fileRelevant", page[0].relevant }, { "fileUrl", page[0].fileUrl } },
+		json::object{ { "fileId", page[1].id }, { "fileRelevant", page[1].relevant }, { "fileUrl", page[1].fileUrl } },
+		json::object{ { "fileId", page[2].id }, { "fileRelevant", page[2].relevant }, { "fileUrl", page[2].fileUrl } },
+	} } })));
+
+	buffer.clear();
+	JsonWriter writer(buffer);
+	writer.String("quote \" slash \\ line\n\x01");
+	REQUIRE(buffer == R"("quote \" slash \\ line\n\u0001")");
+}
+
+TEST_CASE("Response load benchmark")
+{
+	for (const size_t pageSize : { 10, 100, 1000 })
+	{
+		RunLoad("dom", pageSize, [](const auto& page, std::string&, NullStream& stream) {
+			return WriteDomResponse(page, stream);
+		});
+		RunLoad("streaming", pageSize, [](const auto& page, std::string& buffer, NullStream& stream) {
+			return WriteStreamingResponse(page, buffer, stream);
+		});
+
+		const auto page = CreatePage(pageSize);
+		std::string buffer;
+		NullStream stream;
+		BENCHMARK("DOM response, page " + std::to_string(pageSize))
+		{
+			return WriteDomResponse(page, stream);
+		};
+		BENCHMARK("Streaming response, page " + std::to_string(pageSize))
+		{
+			return WriteStreamingResponse(page, buffer, stream);
+		};
+	}
+}
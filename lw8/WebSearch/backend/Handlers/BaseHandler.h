@@ -1,4 +1,6 @@
 #pragma once
+#include "../Server/BufferBody.h"
+
 #include <boost/beast/http/message_generator.hpp>
 #include <boost/beast/http/string_body.hpp>
 #include <boost/json/serialize.hpp>
@@ -9,18 +11,47 @@ namespace http = boost::beast::http;
 class BaseHandler
 {
 protected:
+	// Ответ крупнее порога отправляется чанками, не дожидаясь подсчёта длины всего тела клиентом
+	static constexpr size_t CHUNKED_RESPONSE_THRESHOLD = 64 << 10;
+
 	static http::message_generator GetJsonResponse(
 		const http::status& status,
 		const unsigned version,
 		const boost::json::value& jsonValue)
 	{
 		http::response<http::string_body> res{ status, version };
+		SetJsonHeaders(res);
+		res.body() = serialize(jsonValue);
+		res.prepare_payload();
+		return res;
+	}
+
+	// JSON уже записан в буфер сессии; ответ ссылается на него без копирования
+	static http::message_generator GetBufferedJsonResponse(
+		const http::status& status,
+		const unsigned version,
+		const std::string& body)
+	{
+		http::response<BufferBody> res{ status, version };
+		SetJsonHeaders(res);
+		res.body() = &body;
+		if (body.size() > CHUNKED_RESPONSE_THRESHOLD)
+		{
+			res.chunked(true);
+		}
+		else
+		{
+			res.prepare_payload();
+		}
+		return res;
+	}
+
+	template <class Body>
+	static void SetJsonHeaders(http::response<Body>& res)
+	{
 		res.set(http::field::content_type, "application/json");
 		res.set(http::field::access_control_allow_origin, "*");
 		res.set(http::field::access_control_allow_headers, "Content-Type, Authorization");
 		res.set(http::field::access_control_allow_methods, "GET, POST, OPTIONS");
-		res.body() = serialize(jsonValue);
-		res.prepare_payload();
-		return res;
 	}
 };
@@ -0,0 +1,25 @@
+#pragma once
+#include "BaseHandler.h"
+
+class ServiceUnavailableHandler : public BaseHandler
+{
+public:
+	template <class Body, class Allocator>
+	static http::message_generator Handle(
+		const std::string& message,
+		const http::request<Body, http::basic_fields<Allocator>>& request)
+	{
+		http::response<http::string_body> res{ http::status::service_unavailable, request.version() };
+		SetJsonHeaders(res);
+		res.set(http::field::retry_after, RETRY_AFTER_SECONDS);
+		res.body() = serialize(boost::json::value{
+			{ "error", "Service unavailable" },
+			{ "message", message },
+		});
+		res.prepare_payload();
+		return res;
+	}
+
+private:
+	static constexpr auto RETRY_AFTER_SECONDS = "1";
+};
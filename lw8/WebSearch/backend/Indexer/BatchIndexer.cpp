@@ -0,0 +1,162 @@
+#include "BatchIndexer.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+BatchIndexer::BatchIndexer(MtSearch& search, const Options& options)
+	: m_search(search)
+	, m_options(options)
+	, m_status{ 0, options.queueCapacity, 0, 0, 0, search.GetIndexEpoch(), options.indexPath.empty() ? 0 : search.GetIndexEpoch(), {} }
+	, m_thread([this](const std::stop_token& stopToken) {
+		IndexLoop(stopToken);
+	})
+{
+}
+
+BatchIndexer::~BatchIndexer()
+{
+	m_thread.request_stop();
+}
+
+bool BatchIndexer::Enqueue(std::vector<MtSearch::Document> pages, std::vector<std::string> filePaths)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		const auto queued = m_pages.size() + m_filePaths.size();
+		if (queued + pages.size() + filePaths.size() > m_options.queueCapacity)
+		{
+			return false;
+		}
+		std::move(pages.begin(), pages.end(), std::back_inserter(m_pages));
+		std::move(filePaths.begin(), filePaths.end(), std::back_inserter(m_filePaths));
+		m_status.queueDepth = m_pages.size() + m_filePaths.size();
+	}
+	m_cvQueued.notify_one();
+	return true;
+}
+
+BatchIndexer::Status BatchIndexer::GetStatus() const
+{
+	std::lock_guard lock(m_mutex);
+	return m_status;
+}
+
+void BatchIndexer::IndexLoop(const std::stop_token& stopToken)
+{
+	// Ожидание с stopToken возвращает false только при пустой очереди, так что остаток дописывается до выхода.
+	// Пока есть несохранённые пачки, ожидание ограничено сроком контрольной точки
+	for (;;)
+	{
+		std::vector<MtSearch::Document> pages;
+		std::vector<std::string> filePaths;
+		{
+			std::unique_lock lock(m_mutex);
+			const auto isQueued = [this] {
+				return !m_pages.empty() || !m_filePaths.empty();
+			};
+			const auto hasQueued = m_unsavedBatches > 0
+				? m_cvQueued.wait_until(lock, stopToken, m_nextSaveTime, isQueued)
+				: m_cvQueued.wait(lock, stopToken, isQueued);
+			if (!hasQueued)
+			{
+				lock.unlock();
+				SaveCheckpoint();
+				if (stopToken.stop_requested())
+				{
+					return;
+				}
+				continue;
+			}
+			// Мелкие документы идут потоком: короткое ожидание собирает их в одно обновление индекса
+			m_cvQueued.wait_for(lock, stopToken, m_options.maxBatchDelay, [this] {
+				return m_pages.size() + m_filePaths.size() >= m_options.maxBatchDocs;
+			});
+
+			const auto pagesCount = std::min(m_pages.size(), m_options.maxBatchDocs);
+			const auto filesCount = std::min(m_filePaths.size(), m_options.maxBatchDocs - pagesCount);
+			pages.assign(std::make_move_iterator(m_pages.begin()), std::make_move_iterator(m_pages.begin() + pagesCount));
+			m_pages.erase(m_pages.begin(), m_pages.begin() + pagesCount);
+			filePaths.assign(std::make_move_iterator(m_filePaths.begin()), std::make_move_iterator(m_filePaths.begin() + filesCount));
+			m_filePaths.erase(m_filePaths.begin(), m_filePaths.begin() + filesCount);
+			m_status.queueDepth = m_pages.size() + m_filePaths.size();
+			m_status.indexingDocs = pagesCount + filesCount;
+		}
+
+		IndexBatch(pages, filePaths);
+		if (m_unsavedBatches >= m_options.maxUnsavedBatches || std::chrono::steady_clock::now() >= m_nextSaveTime)
+		{
+			SaveCheckpoint();
+		}
+	}
+}
+
+void BatchIndexer::IndexBatch(std::vector<MtSearch::Document>& pages, std::vector<std::string>& filePaths)
+{
+	const auto docsCount = pages.size() + filePaths.size();
+	std::string error;
+	try
+	{
+		if (!pages.empty())
+		{
+			m_search.AddDocumentsToIndex(std::move(pages));
+		}
+		if (!filePaths.empty())
+		{
+			m_search.AddFilesToIndex(filePaths);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		error = e.what();
+		std::cerr << "Cannot index batch: " << error << std::endl;
+	}
+
+	// Срок контрольной точки отсчитывается от первой несохранённой пачки
+	if (m_unsavedBatches++ == 0)
+	{
+		m_nextSaveTime = std::chrono::steady_clock::now() + m_options.saveInterval;
+	}
+
+	std::lock_guard lock(m_mutex);
+	m_status.indexingDocs = 0;
+	m_status.lastCommittedEpoch = m_search.GetIndexEpoch();
+	if (!error.empty())
+	{
+		m_status.lastError = std::move(error);
+		return;
+	}
+	++m_status.batchesCommitted;
+	m_status.docsCommitted += docsCount;
+}
+
+void BatchIndexer::SaveCheckpoint()
+{
+	if (std::exchange(m_unsavedBatches, 0) == 0 || m_options.indexPath.empty())
+	{
+		return;
+	}
+
+	// Эпоха читается до сохранения: сохраняемый снимок не старше неё
+	const auto epoch = m_search.GetIndexEpoch();
+	std::string error;
+	try
+	{
+		m_search.SaveIndex(m_options.indexPath);
+	}
+	catch (const std::exception& e)
+	{
+		error = e.what();
+		std::cerr << "Cannot save index: " << error << std::endl;
+	}
+
+	std::lock_guard lock(m_mutex);
+	if (!error.empty())
+	{
+		m_status.lastError = std::move(error);
+		return;
+	}
+	m_status.lastSavedEpoch = epoch;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "../MtSearch/MtSearch.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Фоновая индексация для POST /add. Запросы только ставятся в очередь, а отдельный поток забирает их
+// пачками: страницы из пачки попадают в индекс одним сегментом, файлы — одним запуском конвейера.
+// Поиск читает снимки индекса без блокировок, поэтому индексация не задерживает /list.
+// Файл индекса переписывается целиком, поэтому сохраняется не каждая пачка, а контрольная точка:
+// через saveInterval после первой несохранённой пачки или сразу, когда их набралось maxUnsavedBatches.
+// При остановке поток дописывает в индекс всё, что уже стоит в очереди, и сохраняет его
+class BatchIndexer
+{
+public:
+	struct Options
+	{
+		// Больше в очереди не принимается, клиент получает отказ
+		size_t queueCapacity = 100000;
+		size_t maxBatchDocs = 1000;
+		// Сколько ждать, пока пачка наберётся, после прихода первого документа
+		std::chrono::milliseconds maxBatchDelay{ 200 };
+		// Файл контрольных точек индекса, к запуску уже хранящий текущий снимок; пусто — индекс не сохраняется
+		std::string indexPath;
+		std::chrono::seconds saveInterval{ 30 };
+		// Столько несохранённых пачек сохраняются, не дожидаясь saveInterval
+		size_t maxUnsavedBatches = 100;
+	};
+
+	struct Status
+	{
+		size_t queueDepth = 0;
+		size_t queueCapacity = 0;
+		size_t indexingDocs = 0;
+		uint64_t batchesCommitted = 0;
+		uint64_t docsCommitted = 0;
+		uint64_t lastCommittedEpoch = 0;
+		// Сохранённый в файле снимок не старше этой эпохи
+		uint64_t lastSavedEpoch = 0;
+		std::string lastError;
+	};
+
+	BatchIndexer(MtSearch& search, const Options& options);
+	~BatchIndexer();
+
+	BatchIndexer(const BatchIndexer&) = delete;
+	BatchIndexer& operator=(const BatchIndexer&) = delete;
+
+	// false, если очередь переполнена; тогда не ставится ничего из переданного
+	bool Enqueue(std::vector<MtSearch::Document> pages, std::vector<std::string> filePaths);
+	Status GetStatus() const;
+
+private:
+	void IndexLoop(const std::stop_token& stopToken);
+	void IndexBatch(std::vector<MtSearch::Document>& pages, std::vector<std::string>& filePaths);
+	void SaveCheckpoint();
+
+	MtSearch& m_search;
+	const Options m_options;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable_any m_cvQueued;
+	std::vector<MtSearch::Document> m_pages;
+	std::vector<std::string> m_filePaths;
+	Status m_status;
+
+	// Только для потока индексации
+	size_t m_unsavedBatches = 0;
+	std::chrono::steady_clock::time_point m_nextSaveTime;
+
+	std::jthread m_thread;
+};
@@ -1,17 +1,19 @@
 #pragma once
 #include "FileInfoOutput.h"
-
-#include <boost/json/array.hpp>
+#include "JsonWriter.h"
 
 class JsonConverter
 {
 public:
-	static boost::json::object ConvertFileInfoToJson(const FileInfoOutput& fileInfo)
+	static void WriteFileInfo(JsonWriter& writer, const FileInfoOutput& fileInfo)
 	{
-		return {
-			{"fileId", fileInfo.id},
-			{"fileRelevant", fileInfo.relevant},
-			{"fileUrl", fileInfo.fileUrl},
-		};
+		writer.BeginObject();
+		writer.Key("fileId");
+		writer.Number(static_cast<uint64_t>(fileInfo.id));
+		writer.Key("fileRelevant");
+		writer.Number(fileInfo.relevant);
+		writer.Key("fileUrl");
+		writer.String(fileInfo.fileUrl);
+		writer.EndObject();
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,143 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Потоковая запись JSON прямо в строку-буфер без промежуточного дерева значений. Буфер не очищается:
+// владелец переиспользует его ёмкость между ответами
+class JsonWriter
+{
+public:
+	explicit JsonWriter(std::string& out)
+		: m_out(out)
+	{
+	}
+
+	void BeginObject()
+	{
+		BeginValue();
+		m_out.push_back('{');
+		m_needsComma = false;
+	}
+
+	void EndObject()
+	{
+		m_out.push_back('}');
+		m_needsComma = true;
+	}
+
+	void BeginArray()
+	{
+		BeginValue();
+		m_out.push_back('[');
+		m_needsComma = false;
+	}
+
+	void EndArray()
+	{
+		m_out.push_back(']');
+		m_needsComma = true;
+	}
+
+	void Key(const std::string_view key)
+	{
+		BeginValue();
+		WriteEscaped(key);
+		m_out.push_back(':');
+		m_needsComma = false;
+	}
+
+	void String(const std::string_view value)
+	{
+		BeginValue();
+		WriteEscaped(value);
+		m_needsComma = true;
+	}
+
+	void Number(const uint64_t value)
+	{
+		BeginValue();
+		WriteChars(value);
+		m_needsComma = true;
+	}
+
+	void Number(const double value)
+	{
+		BeginValue();
+		// В JSON нет бесконечностей и NaN
+		if (std::isfinite(value))
+		{
+			WriteChars(value);
+		}
+		else
+		{
+			m_out.append("null");
+		}
+		m_needsComma = true;
+	}
+
+private:
+	void BeginValue()
+	{
+		if (m_needsComma)
+		{
+			m_out.push_back(',');
+		}
+	}
+
+	template <typename T>
+	void WriteChars(const T value)
+	{
+		char chars[32];
+		const auto [end, error] = std::to_chars(chars, chars + sizeof(chars), value);
+		m_out.append(chars, end);
+	}
+
+	void WriteEscaped(const std::string_view text)
+	{
+		static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+		m_out.push_back('"');
+		// Обычные символы копируются кусками между экранируемыми
+		size_t plainStart = 0;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			const auto c = static_cast<unsigned char>(text[i]);
+			if (c >= 0x20 && c != '"' && c != '\\')
+			{
+				continue;
+			}
+			m_out.append(text.substr(plainStart, i - plainStart));
+			plainStart = i + 1;
+			switch (c)
+			{
+			case '"':
+				m_out.append("\\\"");
+				break;
+			case '\\':
+				m_out.append("\\\\");
+				break;
+			case '\n':
+				m_out.append("\\n");
+				break;
+			case '\r':
+				m_out.append("\\r");
+				break;
+			case '\t':
+				m_out.append("\\t");
+				break;
+			default:
+				m_out.append("\\u00");
+				m_out.push_back(HEX_DIGITS[c >> 4]);
+				m_out.push_back(HEX_DIGITS[c & 0xF]);
+			}
+		}
+		m_out.append(text.substr(plainStart));
+		m_out.push_back('"');
+	}
+
+	std::string& m_out;
+	bool m_needsComma = false;
+};
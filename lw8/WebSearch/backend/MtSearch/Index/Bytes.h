@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+constexpr size_t BYTES_ALIGNMENT = 8;
+
+inline void AlignBytes(std::vector<std::byte>& out)
+{
+	out.resize((out.size() + BYTES_ALIGNMENT - 1) / BYTES_ALIGNMENT * BYTES_ALIGNMENT);
+}
+
+template <typename T>
+void AppendBytes(std::vector<std::byte>& out, std::span<const T> values)
+{
+	const auto offset = out.size();
+	out.resize(offset + values.size_bytes());
+	if (!values.empty())
+	{
+		std::memcpy(out.data() + offset, values.data(), values.size_bytes());
+	}
+}
+
+template <typename T>
+void AppendBytes(std::vector<std::byte>& out, const T& value)
+{
+	AppendBytes(out, std::span<const T>(&value, 1));
+}
+
+inline void WriteVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(value) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t ReadVarint(const uint8_t*& in)
+{
+	uint64_t value = 0;
+	int shift = 0;
+	while (*in & 0x80)
+	{
+		value |= static_cast<uint64_t>(*in++ & 0x7F) << shift;
+		shift += 7;
+	}
+	value |= static_cast<uint64_t>(*in++) << shift;
+	return value;
+}
+
+// Типизированное представление участка байтов без копирования; границы и выравнивание проверяются
+template <typename T>
+std::span<const T> ViewBytes(std::span<const std::byte> bytes, const uint64_t offset, const uint64_t count)
+{
+	if (offset % alignof(T) != 0 || offset > bytes.size() || count > (bytes.size() - offset) / sizeof(T))
+	{
+		throw std::runtime_error("Corrupted index data");
+	}
+	return { reinterpret_cast<const T*>(bytes.data() + offset), static_cast<size_t>(count) };
+}
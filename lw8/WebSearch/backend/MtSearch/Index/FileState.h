@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+// Запись манифеста о проиндексированном файле: по метаданным решаем, нужно ли перечитывать файл,
+// а по хешу содержимого — нужно ли его переиндексировать
+struct FileState
+{
+	uint64_t inode = 0;
+	uint64_t size = 0;
+	int64_t modificationTime = 0;
+	uint64_t contentHash = 0;
+
+	bool HasSameMetadata(const FileState& other) const
+	{
+		return inode == other.inode && size == other.size && modificationTime == other.modificationTime;
+	}
+};
+
+inline uint64_t HashContent(const std::span<const char> content)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const auto c : content)
+	{
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "Segment.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Формат файла: заголовок с сигнатурой и версией, таблица сегментов и образы сегментов, выровненные по 8 байт
+class IndexFile
+{
+public:
+	static constexpr uint32_t VERSION = 5;
+
+	static void Save(const std::string& path, const std::vector<std::shared_ptr<const Segment>>& segments);
+	static std::vector<std::shared_ptr<const Segment>> Load(const std::string& path);
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include "Segment.h"
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+struct SegmentDeletes
+{
+	std::vector<bool> docs;
+	std::unordered_map<uint32_t, uint32_t> termDocs;
+	size_t count = 0;
+	uint64_t length = 0;
+};
+
+struct IndexSnapshot
+{
+	struct SegmentView
+	{
+		std::shared_ptr<const Segment> segment;
+		std::shared_ptr<const SegmentDeletes> deletes;
+
+		bool IsDeleted(uint32_t localDocId) const;
+		size_t GetLiveDocsCount() const;
+		uint64_t GetLiveDocLength() const;
+		size_t GetLiveTermDocsCount(uint32_t termOrdinal) const;
+	};
+
+	struct DocLocation
+	{
+		size_t segmentIndex;
+		uint32_t localDocId;
+	};
+
+	std::optional<DocLocation> FindDocument(uint64_t globalDocId) const;
+	size_t GetLiveDocsCount() const;
+	uint64_t GetLiveDocLength() const;
+
+	std::vector<SegmentView> segments;
+	// Растёт при каждом добавлении и удалении документов; слияние сегментов результаты не меняет и эпоху не трогает
+	uint64_t epoch = 0;
+};
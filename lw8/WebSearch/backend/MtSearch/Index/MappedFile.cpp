@@ -0,0 +1,41 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path)
+{
+	const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Cannot open file: " + path);
+	}
+
+	struct stat fileStat{};
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(fd);
+		throw std::runtime_error("Cannot map empty file: " + path);
+	}
+
+	m_size = static_cast<size_t>(fileStat.st_size);
+	m_data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (m_data == MAP_FAILED)
+	{
+		throw std::runtime_error("Cannot map file: " + path);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	munmap(m_data, m_size);
+}
+
+std::span<const std::byte> MappedFile::GetBytes() const
+{
+	return { static_cast<const std::byte*>(m_data), m_size };
+}
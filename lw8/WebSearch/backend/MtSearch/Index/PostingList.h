@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class PostingList
+{
+public:
+	static constexpr size_t BLOCK_SIZE = 128;
+
+	struct Block
+	{
+		size_t count = 0;
+		std::array<uint64_t, BLOCK_SIZE> docIds;
+		std::array<uint32_t, BLOCK_SIZE> termCounts;
+	};
+
+	// Курсор для обхода документ-за-документом: декодирует по одному блоку и умеет перепрыгивать блоки
+	class Cursor
+	{
+	public:
+		static constexpr uint64_t END = UINT64_MAX;
+
+		explicit Cursor(const PostingList& list);
+
+		uint64_t GetDocId() const;
+		uint32_t GetTermCount() const;
+		void Next();
+		void Advance(uint64_t docId);
+
+		size_t FindBlock(uint64_t docId) const;
+		uint64_t GetBlockLastDocId(size_t blockIndex) const;
+		size_t GetBlockIndex() const;
+		// Сумма termCount постингов блока перед курсором — столько позиций лежит до позиций текущего документа
+		uint64_t GetPrecedingTermCount() const;
+
+	private:
+		size_t GallopBlock(uint64_t docId) const;
+		void LoadBlock(size_t blockIndex);
+
+		const PostingList* m_list;
+		size_t m_blocksCount;
+		size_t m_blockIndex = 0;
+		size_t m_position = 0;
+		Block m_block;
+	};
+
+	// Список, читающий закодированные блоки прямо из чужой памяти (например, mmap-файла индекса)
+	static PostingList Map(std::span<const std::byte> bytes);
+	void Serialize(std::vector<std::byte>& out) const;
+
+	void Add(uint64_t docId, uint32_t termCount);
+	bool Remove(uint64_t docId);
+
+	size_t GetSize() const;
+	size_t GetMemoryUsage() const;
+
+	template <typename Callback>
+	void ForEachBlockInRange(uint64_t firstDocId, uint64_t lastDocId, Callback&& callback) const
+	{
+		Block block;
+		const auto blocks = GetBlocks();
+		auto it = std::ranges::lower_bound(blocks, firstDocId, {}, &BlockHeader::lastDocId);
+		for (; it != blocks.end(); ++it)
+		{
+			DecodeBlock(*it, block);
+			const auto isLastBlock = ClipBlock(block, firstDocId, lastDocId);
+			if (block.count > 0)
+			{
+				callback(block);
+			}
+			if (isLastBlock)
+			{
+				return;
+			}
+		}
+
+		block.count = m_tail.size();
+		std::ranges::copy(m_tail, block.docIds.begin());
+		std::ranges::copy(m_tailTermCounts, block.termCounts.begin());
+		ClipBlock(block, firstDocId, lastDocId);
+		if (block.count > 0)
+		{
+			callback(block);
+		}
+	}
+
+	template <typename Callback>
+	void ForEach(Callback&& callback) const
+	{
+		ForEachBlockInRange(0, UINT64_MAX, [&callback](const Block& block) {
+			for (size_t i = 0; i < block.count; ++i)
+			{
+				callback(block.docIds[i], block.termCounts[i]);
+			}
+		});
+	}
+
+private:
+	struct BlockHeader
+	{
+		uint64_t lastDocId;
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct EncodedHeader
+	{
+		uint64_t size;
+		uint64_t blocksCount;
+		uint64_t dataSize;
+	};
+
+	std::span<const BlockHeader> GetBlocks() const;
+	void DecodeBlockAt(size_t blockIndex, Block& block) const;
+	std::span<const uint8_t> GetData() const;
+	void FlushTail();
+	void DecodeBlock(const BlockHeader& header, Block& block) const;
+	static bool ClipBlock(Block& block, uint64_t firstDocId, uint64_t lastDocId);
+
+	std::vector<BlockHeader> m_blocks;
+	std::vector<uint8_t> m_data;
+	bool m_isMapped = false;
+	std::span<const BlockHeader> m_mappedBlocks;
+	std::span<const uint8_t> m_mappedData;
+	std::vector<uint64_t> m_tail;
+	std::vector<uint32_t> m_tailTermCounts;
+	size_t m_size = 0;
+};
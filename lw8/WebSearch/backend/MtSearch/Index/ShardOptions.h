@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+// Индекс делится на шарды по идентификаторам документов. У каждого шарда свои сегменты, слияния
+// и пул потоков; запрос рассылается по всем шардам, а их лучшие результаты сливаются
+struct ShardOptions
+{
+	size_t count = 1;
+	// Пул шарда привязывается к процессорам NUMA-узла (шарды раскладываются по узлам по кругу),
+	// и слияния его сегментов выполняются на этом же узле, чтобы память сегментов была локальной
+	bool pinToNumaNodes = false;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Отсортированный словарь терминов с фронтальным кодированием. Термины идут блоками по BLOCK_SIZE: первый
+// термин блока хранится целиком и служит ключом бинарного поиска, остальные — длиной общего с предыдущим
+// префикса и своим суффиксом. Словарь читает байты из образа сегмента без копирования
+class TermDictionary
+{
+public:
+	static constexpr uint32_t BLOCK_SIZE = 16;
+
+	struct Encoded
+	{
+		// Смещения блоков в bytes и в конце общий размер
+		std::vector<uint64_t> blockOffsets;
+		std::vector<uint8_t> bytes;
+	};
+
+	// Последовательный обход: каждый следующий термин раскодируется из предыдущего
+	class Iterator
+	{
+	public:
+		Iterator(const TermDictionary& dictionary, uint32_t ordinal);
+
+		bool IsValid() const;
+		uint32_t GetOrdinal() const;
+		std::string_view GetTerm() const;
+		void Next();
+		void Seek(uint32_t ordinal);
+
+	private:
+		void Decode();
+
+		const TermDictionary* m_dictionary;
+		uint32_t m_ordinal = 0;
+		const uint8_t* m_in = nullptr;
+		std::string m_term;
+	};
+
+	static Encoded Encode(std::span<const std::string> sortedTerms);
+
+	TermDictionary() = default;
+	TermDictionary(size_t termsCount, std::span<const uint64_t> blockOffsets, std::span<const uint8_t> bytes);
+
+	size_t GetSize() const;
+	std::string GetTerm(uint32_t ordinal) const;
+	std::optional<uint32_t> Find(std::string_view term) const;
+	// Номер первого термина, не меньшего term
+	uint32_t LowerBound(std::string_view term) const;
+
+	// Раскрытия отдают номера терминов по возрастанию и обходят только термины, которые могут подойти
+	std::vector<uint32_t> FindByPrefix(std::string_view prefix) const;
+	// Маска, где * — любая последовательность символов, ? — один символ
+	std::vector<uint32_t> FindByWildcard(std::string_view pattern) const;
+	// Термины на расстоянии Левенштейна не больше maxEdits
+	std::vector<uint32_t> FindByEditDistance(std::string_view term, uint32_t maxEdits) const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	std::string_view GetBlockFirstTerm(size_t blockIndex) const;
+	uint32_t GetPrefixEnd(std::string_view prefix) const;
+
+	size_t m_termsCount = 0;
+	std::span<const uint64_t> m_blockOffsets;
+	std::span<const uint8_t> m_bytes;
+};
@@ -0,0 +1,450 @@
+#include "IngestPipeline.h"
+#include "../Tokenizer/Tokenizer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+constexpr int64_t NANO_IN_SECOND = 1000000000;
+
+// Файл читается одним вызовом read на весь размер из fstat, без буферизации потоков
+bool ReadWholeFile(const int fd, const size_t size, std::vector<char>& content)
+{
+	content.resize(size);
+	size_t offset = 0;
+	while (offset < size)
+	{
+		const auto count = read(fd, content.data() + offset, size - offset);
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (count < 0)
+		{
+			return false;
+		}
+		if (count == 0)
+		{
+			break;
+		}
+		offset += static_cast<size_t>(count);
+	}
+	content.resize(offset);
+	return true;
+}
+} // namespace
+
+void IngestPipeline::StageCounters::Record(const uint64_t itemCount, const uint64_t byteCount, const Clock::time_point start)
+{
+	items.fetch_add(itemCount, std::memory_order_relaxed);
+	bytes.fetch_add(byteCount, std::memory_order_relaxed);
+	busyNanoseconds.fetch_add(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(),
+		std::memory_order_relaxed);
+}
+
+void IngestPipeline::StageCounters::Reset()
+{
+	items.store(0);
+	bytes.store(0);
+	busyNanoseconds.store(0);
+}
+
+IngestPipeline::StageStats IngestPipeline::StageCounters::GetStats(std::string name, const size_t workers) const
+{
+	return {
+		std::move(name),
+		workers,
+		items.load(),
+		bytes.load(),
+		static_cast<double>(busyNanoseconds.load()) / NANO_IN_SECOND,
+	};
+}
+
+template <typename Body>
+void IngestPipeline::Start(const size_t count, const Body& body)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		m_threads.emplace_back(body);
+	}
+}
+
+IngestPipeline::IngestPipeline(const Options& options, PublishSegment publishSegment)
+	: m_options(options)
+	, m_publishSegment(std::move(publishSegment))
+	, m_paths(options.queueCapacity)
+	, m_contents(options.queueCapacity)
+	, m_documents(options.queueCapacity)
+	, m_walkersCount(std::max<size_t>(options.walkers, 1))
+	, m_readersCount(std::max<size_t>(options.readers, 1))
+	, m_tokenizersCount(std::max<size_t>(options.tokenizers, 1))
+{
+	Start(m_walkersCount, [this] {
+		Walk();
+	});
+	Start(m_readersCount, [this] {
+		Read();
+	});
+	Start(m_tokenizersCount, [this] {
+		Tokenize();
+	});
+	// Сборщик один: сегменты получаются полными, а их публикация не делится между потоками
+	Start(1, [this] {
+		Merge();
+	});
+}
+
+IngestPipeline::~IngestPipeline()
+{
+	{
+		std::lock_guard lock(m_stateMutex);
+		m_isStopped = true;
+	}
+	m_cvDirs.notify_all();
+	m_paths.Close();
+	m_contents.Close();
+	m_documents.Close();
+	m_threads.clear();
+}
+
+IngestPipeline::Stats IngestPipeline::Run(const Input& input, const FindIndexedState& findIndexedState)
+{
+	std::lock_guard runLock(m_runMutex);
+	const auto start = Clock::now();
+
+	m_findIndexedState = &findIndexedState;
+	m_recordPositions = input.recordPositions;
+	m_isFailed.store(false);
+	for (auto* stage : { &m_walkStage, &m_readStage, &m_tokenizeStage, &m_mergeStage })
+	{
+		stage->Reset();
+	}
+	m_paths.ResetStats();
+	m_contents.ResetStats();
+	m_documents.ResetStats();
+	{
+		std::lock_guard lock(m_stateMutex);
+		m_error = nullptr;
+		m_recursively = input.recursively;
+		m_pendingItems = input.dirs.size() + input.files.size();
+		m_dirs.assign(input.dirs.begin(), input.dirs.end());
+	}
+	m_cvDirs.notify_all();
+
+	for (size_t i = 0; i < input.files.size(); ++i)
+	{
+		if (m_isFailed.load())
+		{
+			FinishItems(input.files.size() - i);
+			break;
+		}
+		m_walkStage.Record(1, 0, Clock::now());
+		m_paths.Push(input.files[i]);
+	}
+
+	// Стадии отпускают элемент только после того, как передали его дальше, поэтому ноль означает,
+	// что все документы запуска уже в m_builder или в опубликованных сегментах
+	std::exception_ptr error;
+	{
+		std::unique_lock lock(m_stateMutex);
+		m_cvRunDone.wait(lock, [this] {
+			return m_pendingItems == 0;
+		});
+		error = std::exchange(m_error, nullptr);
+	}
+	m_findIndexedState = nullptr;
+
+	if (error)
+	{
+		m_builder = Segment::Builder();
+		std::rethrow_exception(error);
+	}
+	PublishRemainder();
+	return GetStats(std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+// После ошибки элементы запуска проходят стадии без обработки, чтобы счётчик дошёл до нуля
+void IngestPipeline::Fail(const std::exception_ptr& error)
+{
+	std::lock_guard lock(m_stateMutex);
+	if (!m_error)
+	{
+		m_error = error;
+	}
+	m_isFailed.store(true);
+}
+
+void IngestPipeline::FinishItems(const size_t count)
+{
+	std::lock_guard lock(m_stateMutex);
+	m_pendingItems -= count;
+	if (m_pendingItems == 0)
+	{
+		m_cvRunDone.notify_all();
+	}
+}
+
+// Обходчики делят общий список каталогов: каждый читает один каталог, а вложенные отдаёт в список
+void IngestPipeline::Walk()
+{
+	for (;;)
+	{
+		std::string dir;
+		bool recursively = false;
+		{
+			std::unique_lock lock(m_stateMutex);
+			m_cvDirs.wait(lock, [this] {
+				return !m_dirs.empty() || m_isStopped;
+			});
+			if (m_isStopped)
+			{
+				return;
+			}
+			dir = std::move(m_dirs.front());
+			m_dirs.pop_front();
+			recursively = m_recursively;
+		}
+		if (m_isFailed.load())
+		{
+			FinishItems(1);
+			continue;
+		}
+
+		const auto start = Clock::now();
+		std::vector<std::string> files;
+		std::vector<std::string> subdirs;
+		try
+		{
+			for (const auto& entry : std::filesystem::directory_iterator(dir))
+			{
+				if (entry.is_regular_file())
+				{
+					files.push_back(entry.path());
+				}
+				else if (recursively && entry.is_directory() && !entry.is_symlink())
+				{
+					subdirs.push_back(entry.path());
+				}
+			}
+		}
+		catch (...)
+		{
+			Fail(std::current_exception());
+			FinishItems(1);
+			continue;
+		}
+		{
+			std::lock_guard lock(m_stateMutex);
+			m_pendingItems += files.size() + subdirs.size();
+			std::ranges::move(subdirs, std::back_inserter(m_dirs));
+		}
+		m_cvDirs.notify_all();
+		m_walkStage.Record(files.size(), 0, start);
+
+		for (auto& file : files)
+		{
+			if (!m_paths.Push(std::move(file)))
+			{
+				return;
+			}
+		}
+		FinishItems(1);
+	}
+}
+
+void IngestPipeline::Read()
+{
+	while (auto path = m_paths.Pop())
+	{
+		const auto start = Clock::now();
+		FileContent file{ std::move(*path), {}, std::nullopt, {} };
+		bool isRead = false;
+		if (!m_isFailed.load())
+		{
+			try
+			{
+				isRead = ReadFile(file);
+			}
+			catch (...)
+			{
+				Fail(std::current_exception());
+			}
+		}
+		if (!isRead)
+		{
+			m_readStage.Record(1, 0, start);
+			FinishItems(1);
+			continue;
+		}
+		m_readStage.Record(1, file.content.size(), start);
+		if (!m_contents.Push(std::move(file)))
+		{
+			return;
+		}
+	}
+}
+
+// false, если файл не прочитан или не изменился с прошлой индексации
+bool IngestPipeline::ReadFile(FileContent& file) const
+{
+	const auto fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat fileStat{};
+	if (fd < 0 || fstat(fd, &fileStat) != 0)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		std::cerr << "Cannot open file: " << file.path << std::endl;
+		return false;
+	}
+
+	file.state.inode = fileStat.st_ino;
+	file.state.size = static_cast<uint64_t>(fileStat.st_size);
+	file.state.modificationTime = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * NANO_IN_SECOND + fileStat.st_mtim.tv_nsec;
+
+	const auto& findIndexedState = *m_findIndexedState;
+	std::optional<FileState> indexedState;
+	try
+	{
+		indexedState = findIndexedState ? findIndexedState(file.path) : std::nullopt;
+	}
+	catch (...)
+	{
+		close(fd);
+		throw;
+	}
+	if (indexedState && indexedState->HasSameMetadata(file.state))
+	{
+		close(fd);
+		return false;
+	}
+	if (indexedState)
+	{
+		file.indexedHash = indexedState->contentHash;
+	}
+
+	const auto isRead = ReadWholeFile(fd, file.state.size, file.content);
+	close(fd);
+	if (!isRead)
+	{
+		std::cerr << "Cannot open file: " << file.path << std::endl;
+	}
+	return isRead;
+}
+
+void IngestPipeline::Tokenize()
+{
+	auto counterRecordsPositions = false;
+	TermCounter termCounter(counterRecordsPositions);
+	while (auto file = m_contents.Pop())
+	{
+		const auto start = Clock::now();
+		if (m_isFailed.load())
+		{
+			FinishItems(1);
+			continue;
+		}
+		file->state.contentHash = HashContent(file->content);
+		if (file->indexedHash == file->state.contentHash)
+		{
+			m_tokenizeStage.Record(1, file->content.size(), start);
+			FinishItems(1);
+			continue;
+		}
+
+		if (counterRecordsPositions != m_recordPositions)
+		{
+			counterRecordsPositions = m_recordPositions;
+			termCounter = TermCounter(counterRecordsPositions);
+		}
+		Tokenizer::CountTerms(file->content, termCounter);
+		DocumentTerms document{ std::move(file->path), file->state, std::move(file->content), {}, {}, termCounter.GetTotalCount() };
+
+		const auto entries = termCounter.GetEntries();
+		size_t positionsCount = 0;
+		for (const auto& entry : entries)
+		{
+			positionsCount += entry.positions.size();
+		}
+		// Память под позиции выделяется сразу, чтобы span не указывали в освобождённый буфер
+		document.positions.reserve(positionsCount);
+		document.entries.reserve(entries.size());
+		for (const auto& [term, count, positions] : entries)
+		{
+			const auto offset = document.positions.size();
+			document.positions.insert(document.positions.end(), positions.begin(), positions.end());
+			document.entries.push_back({ term, count, std::span(document.positions).subspan(offset, positions.size()) });
+		}
+		termCounter.Clear();
+
+		m_tokenizeStage.Record(1, document.content.size(), start);
+		if (!m_documents.Push(std::move(document)))
+		{
+			return;
+		}
+	}
+}
+
+void IngestPipeline::Merge()
+{
+	while (auto document = m_documents.Pop())
+	{
+		const auto start = Clock::now();
+		if (!m_isFailed.load())
+		{
+			try
+			{
+				m_builder.AddDocument(std::move(document->path), document->entries, document->length, document->state);
+				if (m_builder.GetDocsCount() >= m_options.docsPerSegment)
+				{
+					m_publishSegment(std::exchange(m_builder, Segment::Builder()).Build());
+				}
+			}
+			catch (...)
+			{
+				Fail(std::current_exception());
+			}
+			m_mergeStage.Record(1, document->content.size(), start);
+		}
+		FinishItems(1);
+	}
+}
+
+void IngestPipeline::PublishRemainder()
+{
+	if (m_builder.GetDocsCount() == 0)
+	{
+		return;
+	}
+	const auto start = Clock::now();
+	m_publishSegment(std::exchange(m_builder, Segment::Builder()).Build());
+	m_mergeStage.Record(0, 0, start);
+}
+
+IngestPipeline::Stats IngestPipeline::GetStats(const double wallSeconds) const
+{
+	return {
+		wallSeconds,
+		{
+			m_walkStage.GetStats("walk", m_walkersCount),
+			m_readStage.GetStats("read", m_readersCount),
+			m_tokenizeStage.GetStats("tokenize", m_tokenizersCount),
+			m_mergeStage.GetStats("merge", 1),
+		},
+		{
+			{ "paths", m_paths.GetStats() },
+			{ "contents", m_contents.GetStats() },
+			{ "documents", m_documents.GetStats() },
+		},
+	};
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include "../Index/FileState.h"
+#include "../Index/Segment.h"
+#include "../Tokenizer/TermCounter.h"
+#include "BoundedQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Конвейер индексации из четырёх стадий: обход каталогов, чтение файлов, токенизация и сборка сегментов.
+// Стадии связаны ограниченными очередями, поэтому медленный диск или нехватка ядер на токенизацию тормозят
+// только соседей, а не копят данные. Потоки стадий создаются один раз вместе с конвейером и обслуживают
+// все запуски. По каждой стадии и очереди собирается статистика, по которой видно, что ограничивает скорость
+class IngestPipeline
+{
+public:
+	struct Options
+	{
+		size_t walkers = 1;
+		size_t readers = 1;
+		size_t tokenizers = 1;
+		size_t queueCapacity = 256;
+		size_t docsPerSegment = 512;
+	};
+
+	struct Input
+	{
+		std::vector<std::string> files;
+		std::vector<std::string> dirs;
+		bool recursively = false;
+		bool recordPositions = false;
+	};
+
+	struct StageStats
+	{
+		std::string name;
+		size_t workers = 0;
+		uint64_t items = 0;
+		uint64_t bytes = 0;
+		// Суммарное время работы потоков стадии без ожидания очередей
+		double busySeconds = 0;
+	};
+
+	struct QueueStats
+	{
+		std::string name;
+		BoundedQueueStats stats;
+	};
+
+	struct Stats
+	{
+		double wallSeconds = 0;
+		std::vector<StageStats> stages;
+		std::vector<QueueStats> queues;
+	};
+
+	// Проиндексированное состояние файла: файл с теми же метаданными не читается, с тем же хешем — не индексируется
+	using FindIndexedState = std::function<std::optional<FileState>(const std::string& path)>;
+	using PublishSegment = std::function<void(const std::shared_ptr<Segment>& segment)>;
+
+	IngestPipeline(const Options& options, PublishSegment publishSegment);
+	~IngestPipeline();
+
+	IngestPipeline(const IngestPipeline&) = delete;
+	IngestPipeline& operator=(const IngestPipeline&) = delete;
+
+	// Запуски выполняются по одному. Ошибка любой стадии прерывает запуск и пробрасывается вызывающему,
+	// а сам конвейер остаётся готов к следующему запуску
+	Stats Run(const Input& input, const FindIndexedState& findIndexedState);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct FileContent
+	{
+		std::string path;
+		FileState state;
+		std::optional<uint64_t> indexedHash;
+		std::vector<char> content;
+	};
+
+	// Термины документа вместе с памятью, на которую они ссылаются: term указывают в content, positions — в positions.
+	// Буфер vector при перемещении остаётся на месте, поэтому документ можно передавать между стадиями
+	struct DocumentTerms
+	{
+		std::string path;
+		FileState state;
+		std::vector<char> content;
+		std::vector<TermCounter::Entry> entries;
+		std::vector<uint32_t> positions;
+		uint32_t length = 0;
+	};
+
+	struct StageCounters
+	{
+		void Record(uint64_t itemCount, uint64_t byteCount, Clock::time_point start);
+		void Reset();
+		StageStats GetStats(std::string name, size_t workers) const;
+
+		std::atomic<uint64_t> items{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+		std::atomic<int64_t> busyNanoseconds{ 0 };
+	};
+
+	template <typename Body>
+	void Start(size_t count, const Body& body);
+	void Fail(const std::exception_ptr& error);
+	// Элемент запуска прошёл конвейер до конца или отброшен; последний будит Run
+	void FinishItems(size_t count);
+
+	void Walk();
+	void Read();
+	bool ReadFile(FileContent& file) const;
+	void Tokenize();
+	void Merge();
+	void PublishRemainder();
+
+	Stats GetStats(double wallSeconds) const;
+
+	const Options m_options;
+	const PublishSegment m_publishSegment;
+
+	BoundedQueue<std::string> m_paths;
+	BoundedQueue<FileContent> m_contents;
+	BoundedQueue<DocumentTerms> m_documents;
+
+	std::mutex m_runMutex;
+
+	// Состояние текущего запуска; меняется только между запусками
+	const FindIndexedState* m_findIndexedState = nullptr;
+	bool m_recordPositions = false;
+	bool m_recursively = false;
+	std::atomic<bool> m_isFailed{ false };
+	std::exception_ptr m_error;
+
+	// Каталоги ждут обходчиков в общем списке, а незавершённые элементы запуска считаются вместе:
+	// каталоги, файлы и документы на любой стадии
+	std::mutex m_stateMutex;
+	std::condition_variable m_cvDirs;
+	std::condition_variable m_cvRunDone;
+	std::deque<std::string> m_dirs;
+	size_t m_pendingItems = 0;
+	bool m_isStopped = false;
+
+	// Сборка одного сегмента; между запусками остаток публикует Run
+	Segment::Builder m_builder;
+
+	StageCounters m_walkStage;
+	StageCounters m_readStage;
+	StageCounters m_tokenizeStage;
+	StageCounters m_mergeStage;
+
+	size_t m_walkersCount;
+	size_t m_readersCount;
+	size_t m_tokenizersCount;
+	std::vector<std::jthread> m_threads;
+};
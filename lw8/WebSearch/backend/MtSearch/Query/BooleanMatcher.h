@@ -0,0 +1,82 @@
+#pragma once
+#include "../Index/IndexSnapshot.h"
+#include "../Index/PostingList.h"
+#include "BooleanQuery.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Вычисление булева запроса по одному сегменту документ-за-документом. Каждый узел умеет перейти к первому
+// своему документу не меньше заданного: термин прыгает курсором по блокам и галопом внутри блока,
+// AND перебирает детей от самого редкого, поэтому пересечение стоит порядка длины самого короткого списка.
+// NOT вычисляется только как исключение внутри AND
+class BooleanMatcher
+{
+public:
+	// termOrdinals — номера терминов сегмента для слов запроса, nullopt для слов, которых в сегменте нет
+	BooleanMatcher(
+		const IndexSnapshot::SegmentView& view,
+		const BooleanQuery& query,
+		std::span<const std::optional<uint32_t>> termOrdinals);
+
+	BooleanMatcher(const BooleanMatcher&) = delete;
+	BooleanMatcher& operator=(const BooleanMatcher&) = delete;
+
+	// callback(localDocId, termCounts) для каждого живого документа из [firstDocId, lastDocId), подходящего под запрос;
+	// termCounts — по слову запроса, ноль для слов вне совпавших ветвей и под NOT
+	template <typename Callback>
+	void ForEachMatch(const uint32_t firstDocId, const uint32_t lastDocId, Callback&& callback)
+	{
+		for (auto docId = FindMatch(firstDocId, lastDocId); docId != PostingList::Cursor::END;
+			docId = FindMatch(docId + 1, lastDocId))
+		{
+			callback(static_cast<uint32_t>(docId), std::span<const uint32_t>(m_termCounts));
+		}
+	}
+
+private:
+	enum class IteratorType
+	{
+		Empty,
+		All,
+		Term,
+		And,
+		Or,
+	};
+
+	struct Iterator
+	{
+		IteratorType type;
+		size_t termIndex = 0;
+		size_t cursorIndex = 0;
+		// Для AND — обязательные дети по возрастанию стоимости, для OR — все дети
+		std::vector<size_t> children{};
+		std::vector<size_t> excluded{};
+		// Оценка числа документов узла, по ней AND выбирает порядок детей
+		uint64_t cost = 0;
+		uint64_t docId = 0;
+		bool isPositioned = false;
+	};
+
+	size_t Build(const BooleanQuery& query, size_t node);
+	size_t AddIterator(Iterator iterator);
+	size_t MakeAnd(std::vector<size_t> children, std::vector<size_t> excluded);
+
+	uint64_t FindMatch(uint64_t docId, uint32_t lastDocId);
+	uint64_t Advance(size_t iterator, uint64_t target);
+	uint64_t AdvanceAnd(Iterator& iterator, uint64_t target);
+	void CollectTermCounts(size_t iterator, uint64_t docId);
+
+	const IndexSnapshot::SegmentView& m_view;
+
+	// У каждого вхождения слова свой курсор: ветви запроса двигают их независимо
+	std::vector<PostingList> m_postings;
+	std::vector<PostingList::Cursor> m_cursors;
+	std::vector<size_t> m_nodeCursors;
+
+	std::vector<Iterator> m_iterators;
+	size_t m_root = 0;
+	std::vector<uint32_t> m_termCounts;
+};
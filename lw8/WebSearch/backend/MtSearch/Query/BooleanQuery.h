@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Разобранный булев запрос: слова, AND, OR, NOT и скобки. Слова подряд без оператора соединяются через AND,
+// приоритет NOT > AND > OR. Операторы пишутся заглавными, поэтому строчные "and" и "or" остаются словами
+class BooleanQuery
+{
+public:
+	enum class NodeType
+	{
+		Term,
+		And,
+		Or,
+		Not,
+	};
+
+	struct Node
+	{
+		NodeType type;
+		// Индекс в GetTerms() для Term
+		size_t termIndex = 0;
+		std::vector<size_t> children;
+	};
+
+	static BooleanQuery Parse(std::string_view text);
+
+	// Различные слова запроса в нижнем регистре
+	const std::vector<std::string>& GetTerms() const;
+	const std::vector<Node>& GetNodes() const;
+	size_t GetRoot() const;
+
+private:
+	class Parser;
+
+	std::vector<std::string> m_terms;
+	std::vector<Node> m_nodes;
+	size_t m_root = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include "../Index/IndexSnapshot.h"
+#include "ScoringModel.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Статистики коллекции для одной эпохи индекса: IDF терминов и таблицы нормировок длины документов
+// по сегментам. Считаются лениво при первом обращении и выбрасываются вместе со сменой эпохи
+class CollectionStatistics
+{
+public:
+	explicit CollectionStatistics(const IndexSnapshot& snapshot);
+
+	uint64_t GetEpoch() const;
+	size_t GetDocsCount() const;
+	double GetAverageDocLength() const;
+
+	// nullopt, если в снимке нет живых документов с этим термином
+	std::optional<double> FindIdf(const IndexSnapshot& snapshot, ScoringModel model, std::string_view term);
+	std::shared_ptr<const std::vector<float>> GetLengthNorms(const std::shared_ptr<const Segment>& segment);
+
+private:
+	struct TermHash
+	{
+		using is_transparent = void;
+
+		size_t operator()(const std::string_view term) const
+		{
+			return std::hash<std::string_view>{}(term);
+		}
+	};
+
+	struct TermIdf
+	{
+		double tfIdf;
+		double bm25;
+	};
+
+	struct SegmentNorms
+	{
+		std::weak_ptr<const Segment> segment;
+		std::shared_ptr<const std::vector<float>> norms;
+	};
+
+	static std::optional<double> SelectIdf(const std::optional<TermIdf>& termIdf, ScoringModel model);
+
+	uint64_t m_epoch;
+	size_t m_docsCount;
+	double m_averageDocLength;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, std::optional<TermIdf>, TermHash, std::equal_to<>> m_termIdfs;
+	std::unordered_map<const Segment*, SegmentNorms> m_segmentNorms;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include "../Index/IndexSnapshot.h"
+#include "../Index/PostingList.h"
+#include "QueryAlgorithm.h"
+#include "ScoreFunction.h"
+#include "ScoredDoc.h"
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Отбор top-k документов одного диапазона сегмента с ранним отсечением (MaxScore, WAND, BlockMax-WAND).
+// Оценки документов складываются в порядке слов запроса, поэтому совпадают с полным перебором бит в бит
+class DocAtATimeScorer
+{
+public:
+	struct Term
+	{
+		size_t queryIndex;
+		double idf;
+		PostingList postings;
+		float maxTermFrequency;
+		std::span<const float> blockMaxTermFrequencies;
+	};
+
+	using ScoredDocs = std::vector<ScoredDoc>;
+
+	DocAtATimeScorer(
+		const IndexSnapshot::SegmentView& view,
+		const ScoreFunction& scoreFunction,
+		size_t queryTermsCount,
+		size_t top,
+		std::atomic<double>& sharedThreshold);
+
+	ScoredDocs Score(const std::vector<Term>& terms, uint32_t firstDocId, uint32_t lastDocId, QueryAlgorithm algorithm);
+
+private:
+	struct TermCursor
+	{
+		const Term* term;
+		PostingList::Cursor cursor;
+		double maxScore;
+
+		uint64_t GetDocId(uint32_t lastDocId) const;
+	};
+
+	void ScoreMaxScore(std::vector<TermCursor>& cursors, uint32_t lastDocId);
+	void ScoreWand(std::vector<TermCursor>& cursors, uint32_t lastDocId, bool useBlockMax);
+
+	double GetContribution(const TermCursor& termCursor, uint64_t docId);
+	void Collect(uint64_t docId);
+	bool CanEnterTop(double scoreBound) const;
+
+	const IndexSnapshot::SegmentView& m_view;
+	const ScoreFunction& m_scoreFunction;
+	size_t m_top;
+	std::atomic<double>& m_sharedThreshold;
+
+	std::vector<double> m_contributions;
+	ScoredDocs m_heap;
+};
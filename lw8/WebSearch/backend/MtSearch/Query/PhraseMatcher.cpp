@@ -0,0 +1,173 @@
+#include "PhraseMatcher.h"
+
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+
+PhraseMatcher::PhraseMatcher(
+	const IndexSnapshot::SegmentView& view,
+	const std::span<const uint32_t> termOrdinals,
+	const Mode mode,
+	const uint32_t maxDistance)
+	: m_view(view)
+	, m_mode(mode)
+	, m_maxDistance(maxDistance)
+	, m_termCounts(termOrdinals.size(), 0)
+{
+	if (termOrdinals.empty())
+	{
+		throw std::invalid_argument("Phrase must contain at least one term");
+	}
+
+	for (const auto termOrdinal : termOrdinals)
+	{
+		const auto it = std::ranges::find(m_termOrdinals, termOrdinal);
+		m_queryTerms.push_back(it - m_termOrdinals.begin());
+		if (it == m_termOrdinals.end())
+		{
+			m_termOrdinals.push_back(termOrdinal);
+			m_postings.push_back(view.segment->GetPostings(termOrdinal));
+		}
+	}
+	// Курсоры держат указатели на списки, поэтому создаются, когда m_postings уже не растёт
+	m_cursors.reserve(m_postings.size());
+	for (const auto& postings : m_postings)
+	{
+		m_cursors.emplace_back(postings);
+	}
+	m_positions.resize(m_termOrdinals.size());
+
+	m_order.resize(m_termOrdinals.size());
+	std::iota(m_order.begin(), m_order.end(), 0);
+	std::ranges::sort(m_order, {}, [this](const size_t term) {
+		return m_postings[term].GetSize();
+	});
+}
+
+uint64_t PhraseMatcher::FindMatch(uint64_t docId, const uint32_t lastDocId)
+{
+	for (;;)
+	{
+		const auto candidate = Intersect(docId);
+		if (candidate >= lastDocId)
+		{
+			return PostingList::Cursor::END;
+		}
+		docId = candidate + 1;
+		if (m_view.IsDeleted(static_cast<uint32_t>(candidate)) || !MatchPositions())
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < m_queryTerms.size(); ++i)
+		{
+			m_termCounts[i] = m_cursors[m_queryTerms[i]].GetTermCount();
+		}
+		return candidate;
+	}
+}
+
+uint64_t PhraseMatcher::Intersect(const uint64_t docId)
+{
+	auto& lead = m_cursors[m_order.front()];
+	lead.Advance(docId);
+	auto candidate = lead.GetDocId();
+	for (size_t i = 1; i < m_order.size() && candidate != PostingList::Cursor::END;)
+	{
+		auto& cursor = m_cursors[m_order[i]];
+		cursor.Advance(candidate);
+		if (cursor.GetDocId() == candidate)
+		{
+			++i;
+			continue;
+		}
+		// Кандидат не подошёл: самый редкий список прыгает вперёд, и проверка начинается заново
+		lead.Advance(cursor.GetDocId());
+		candidate = lead.GetDocId();
+		i = 1;
+	}
+	return candidate;
+}
+
+bool PhraseMatcher::MatchPositions()
+{
+	if (m_mode == Mode::Phrase ? m_queryTerms.size() == 1 : m_termOrdinals.size() == 1)
+	{
+		return true;
+	}
+
+	for (size_t term = 0; term < m_termOrdinals.size(); ++term)
+	{
+		m_view.segment->DecodePositions(m_termOrdinals[term], m_cursors[term], m_positions[term]);
+	}
+	return m_mode == Mode::Phrase ? MatchPhrase() : MatchNear();
+}
+
+bool PhraseMatcher::MatchPhrase()
+{
+	// Якорем служит слово с самым коротким списком позиций, остальные ищутся на своём смещении от него
+	const auto anchor = *std::ranges::min_element(std::views::iota(size_t{ 0 }, m_queryTerms.size()), {}, [this](const size_t word) {
+		return m_positions[m_queryTerms[word]].size();
+	});
+
+	m_heads.assign(m_queryTerms.size(), 0);
+	for (const auto anchorPosition : m_positions[m_queryTerms[anchor]])
+	{
+		if (anchorPosition < anchor)
+		{
+			continue;
+		}
+
+		const auto start = anchorPosition - static_cast<uint32_t>(anchor);
+		auto isMatched = true;
+		for (size_t word = 0; word < m_queryTerms.size() && isMatched; ++word)
+		{
+			const auto& positions = m_positions[m_queryTerms[word]];
+			const auto expected = start + static_cast<uint32_t>(word);
+			auto& head = m_heads[word];
+			head = std::lower_bound(positions.begin() + head, positions.end(), expected) - positions.begin();
+			if (head == positions.size())
+			{
+				return false;
+			}
+			isMatched = positions[head] == expected;
+		}
+		if (isMatched)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PhraseMatcher::MatchNear()
+{
+	// Минимальное окно по отсортированным спискам: каждый шаг сдвигает список с наименьшей позицией
+	m_heads.assign(m_termOrdinals.size(), 0);
+	for (;;)
+	{
+		size_t minTerm = 0;
+		auto minPosition = UINT32_MAX;
+		uint32_t maxPosition = 0;
+		for (size_t term = 0; term < m_termOrdinals.size(); ++term)
+		{
+			const auto position = m_positions[term][m_heads[term]];
+			if (position < minPosition)
+			{
+				minPosition = position;
+				minTerm = term;
+			}
+			maxPosition = std::max(maxPosition, position);
+		}
+
+		if (maxPosition - minPosition <= m_maxDistance)
+		{
+			return true;
+		}
+		if (++m_heads[minTerm] == m_positions[minTerm].size())
+		{
+			return false;
+		}
+	}
+}
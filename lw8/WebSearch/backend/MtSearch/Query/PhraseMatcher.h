@@ -0,0 +1,65 @@
+#pragma once
+#include "../Index/IndexSnapshot.h"
+#include "../Index/PostingList.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Фразовые запросы и запросы близости в одном сегменте. Сначала пересекаются списки документов: кандидата
+// задаёт самый редкий термин, остальные курсоры догоняют его галопом. Позиции раскодируются только
+// для живых документов, переживших пересечение
+class PhraseMatcher
+{
+public:
+	enum class Mode
+	{
+		// Слова идут подряд в порядке запроса
+		Phrase,
+		// Все слова попадают в окно, где первая и последняя позиции отличаются не больше чем на maxDistance
+		Near,
+	};
+
+	PhraseMatcher(
+		const IndexSnapshot::SegmentView& view,
+		std::span<const uint32_t> termOrdinals,
+		Mode mode,
+		uint32_t maxDistance);
+
+	PhraseMatcher(const PhraseMatcher&) = delete;
+	PhraseMatcher& operator=(const PhraseMatcher&) = delete;
+
+	// callback(localDocId, termCounts) для каждого совпадения из [firstDocId, lastDocId) по возрастанию localDocId;
+	// termCounts идут в порядке слов запроса
+	template <typename Callback>
+	void ForEachMatch(const uint32_t firstDocId, const uint32_t lastDocId, Callback&& callback)
+	{
+		for (auto docId = FindMatch(firstDocId, lastDocId); docId != PostingList::Cursor::END;
+			docId = FindMatch(docId + 1, lastDocId))
+		{
+			callback(static_cast<uint32_t>(docId), std::span<const uint32_t>(m_termCounts));
+		}
+	}
+
+private:
+	uint64_t FindMatch(uint64_t docId, uint32_t lastDocId);
+	uint64_t Intersect(uint64_t docId);
+	bool MatchPositions();
+	bool MatchPhrase();
+	bool MatchNear();
+
+	const IndexSnapshot::SegmentView& m_view;
+	Mode m_mode;
+	uint32_t m_maxDistance;
+
+	// Повторяющиеся слова запроса делят один курсор; m_queryTerms отображает слово запроса на его термин
+	std::vector<uint32_t> m_termOrdinals;
+	std::vector<size_t> m_queryTerms;
+	std::vector<PostingList> m_postings;
+	std::vector<PostingList::Cursor> m_cursors;
+	std::vector<size_t> m_order;
+
+	std::vector<std::vector<uint32_t>> m_positions;
+	std::vector<size_t> m_heads;
+	std::vector<uint32_t> m_termCounts;
+};
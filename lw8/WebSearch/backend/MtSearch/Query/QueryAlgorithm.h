@@ -0,0 +1,32 @@
+#pragma once
+#include <optional>
+#include <string_view>
+
+enum class QueryAlgorithm
+{
+	Exhaustive,
+	MaxScore,
+	Wand,
+	BlockMaxWand,
+};
+
+inline std::optional<QueryAlgorithm> ParseQueryAlgorithm(const std::string_view name)
+{
+	if (name == "exhaustive")
+	{
+		return QueryAlgorithm::Exhaustive;
+	}
+	if (name == "maxscore")
+	{
+		return QueryAlgorithm::MaxScore;
+	}
+	if (name == "wand")
+	{
+		return QueryAlgorithm::Wand;
+	}
+	if (name == "bmw")
+	{
+		return QueryAlgorithm::BlockMaxWand;
+	}
+	return std::nullopt;
+}
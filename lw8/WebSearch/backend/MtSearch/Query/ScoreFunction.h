@@ -0,0 +1,101 @@
+#pragma once
+#include "../Index/PostingList.h"
+#include "ScoringModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Вклад одного термина в оценку документа. Один и тот же расчёт используют полный перебор
+// и отбор с отсечением, поэтому их выдача совпадает бит в бит
+class ScoreFunction
+{
+public:
+	static constexpr double BM25_K1 = 1.2;
+	static constexpr double BM25_B = 0.75;
+
+	static double GetIdf(const ScoringModel model, const size_t docsCount, const size_t docsWithTermCount)
+	{
+		const auto n = static_cast<double>(docsCount);
+		const auto df = static_cast<double>(docsWithTermCount);
+		return model == ScoringModel::Bm25 ? std::log(1 + (n - df + 0.5) / (df + 0.5)) : std::log(n / df);
+	}
+
+	static float GetBm25LengthNorm(const uint32_t docLength, const double averageDocLength)
+	{
+		return static_cast<float>(BM25_K1 * (1 - BM25_B + BM25_B * docLength / averageDocLength));
+	}
+
+	// Для BM25 нужна таблица нормировок длины сегмента, посчитанная по средней длине документа коллекции
+	ScoreFunction(
+		const ScoringModel model,
+		const std::span<const uint32_t> docLengths,
+		const std::span<const float> lengthNorms,
+		const double averageDocLength)
+		: m_model(model)
+		, m_docLengths(docLengths)
+		, m_lengthNorms(lengthNorms)
+		, m_averageDocLength(averageDocLength)
+	{
+	}
+
+	double GetContribution(const uint32_t termCount, const uint32_t localDocId, const double idf) const
+	{
+		if (m_model == ScoringModel::Bm25)
+		{
+			return ScoreBm25(termCount, m_lengthNorms[localDocId], idf);
+		}
+		return ScoreTfIdf(termCount, m_docLengths[localDocId], idf);
+	}
+
+	// Вклады всех постингов блока без ветвлений внутри цикла
+	void ScoreBlock(const PostingList::Block& block, const double idf, std::span<double> contributions) const
+	{
+		if (m_model == ScoringModel::Bm25)
+		{
+			for (size_t i = 0; i < block.count; ++i)
+			{
+				contributions[i] = ScoreBm25(block.termCounts[i], m_lengthNorms[block.docIds[i]], idf);
+			}
+			return;
+		}
+		for (size_t i = 0; i < block.count; ++i)
+		{
+			contributions[i] = ScoreTfIdf(block.termCounts[i], m_docLengths[block.docIds[i]], idf);
+		}
+	}
+
+	// Верхняя граница вклада по верхней границе termCount / docLength
+	double GetUpperBound(const float maxTermFrequency, const double idf) const
+	{
+		if (m_model == ScoringModel::Bm25)
+		{
+			// tf / (tf + norm) растёт и с tf, и с длиной документа, поэтому граница — предел при бесконечной длине.
+			// Нормировка хранится во float, запас покрывает её округление
+			const double ratio = maxTermFrequency / (maxTermFrequency + BM25_K1 * BM25_B / m_averageDocLength);
+			return idf * (BM25_K1 + 1) * std::min(ratio, 1.0) * (1 + BOUND_MARGIN);
+		}
+		return maxTermFrequency * idf;
+	}
+
+private:
+	static constexpr double BOUND_MARGIN = 1e-6;
+
+	static double ScoreTfIdf(const uint32_t termCount, const uint32_t docLength, const double idf)
+	{
+		return static_cast<double>(termCount) / docLength * idf;
+	}
+
+	static double ScoreBm25(const uint32_t termCount, const float lengthNorm, const double idf)
+	{
+		const auto tf = static_cast<double>(termCount);
+		return idf * (tf * (BM25_K1 + 1)) / (tf + lengthNorm);
+	}
+
+	ScoringModel m_model;
+	std::span<const uint32_t> m_docLengths;
+	std::span<const float> m_lengthNorms;
+	double m_averageDocLength;
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+
+using ScoredDoc = std::pair<uint64_t, double>;
+
+inline bool IsMoreRelevant(const ScoredDoc& a, const ScoredDoc& b)
+{
+	return a.second > b.second || (a.second == b.second && a.first < b.first);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <optional>
+#include <string_view>
+
+enum class ScoringModel
+{
+	TfIdf,
+	Bm25,
+};
+
+inline std::optional<ScoringModel> ParseScoringModel(const std::string_view name)
+{
+	if (name == "tfidf")
+	{
+		return ScoringModel::TfIdf;
+	}
+	if (name == "bm25")
+	{
+		return ScoringModel::Bm25;
+	}
+	return std::nullopt;
+}
@@ -0,0 +1,50 @@
+#include "TermPattern.h"
+
+#include <algorithm>
+#include <cctype>
+
+TermPattern TermPattern::Parse(const std::string_view word)
+{
+	TermPattern pattern;
+	pattern.text = word;
+	std::ranges::transform(pattern.text, pattern.text.begin(), [](const unsigned char c) {
+		return static_cast<char>(std::tolower(c));
+	});
+
+	if (pattern.text.find_first_of("*?") != std::string::npos)
+	{
+		pattern.type = Type::Wildcard;
+		return pattern;
+	}
+
+	// "~" без числа — одна правка; слово из одной тильды остаётся обычным словом
+	const auto tilde = pattern.text.rfind('~');
+	if (tilde == std::string::npos || tilde == 0)
+	{
+		return pattern;
+	}
+	const auto suffix = std::string_view(pattern.text).substr(tilde + 1);
+	if (suffix.size() > 1 || (suffix.size() == 1 && !std::isdigit(static_cast<unsigned char>(suffix[0]))))
+	{
+		return pattern;
+	}
+	pattern.type = Type::Fuzzy;
+	pattern.maxEdits = suffix.empty() ? 1 : std::min<uint32_t>(suffix[0] - '0', MAX_EDITS);
+	pattern.text.resize(tilde);
+	return pattern;
+}
+
+std::vector<uint32_t> TermPattern::Expand(const TermDictionary& dictionary) const
+{
+	switch (type)
+	{
+	case Type::Wildcard:
+		return dictionary.FindByWildcard(text);
+	case Type::Fuzzy:
+		return dictionary.FindByEditDistance(text, maxEdits);
+	case Type::Exact:
+		break;
+	}
+	const auto ordinal = dictionary.Find(text);
+	return ordinal ? std::vector<uint32_t>{ *ordinal } : std::vector<uint32_t>{};
+}
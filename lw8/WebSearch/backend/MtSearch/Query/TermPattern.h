@@ -0,0 +1,30 @@
+#pragma once
+#include "../Index/TermDictionary.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Слово запроса, которое раскрывается в термины словаря: маска с * и ? или нечёткое "слово~N",
+// где N — допустимое расстояние правки (по умолчанию 1, не больше MAX_EDITS)
+struct TermPattern
+{
+	static constexpr uint32_t MAX_EDITS = 2;
+
+	enum class Type
+	{
+		Exact,
+		Wildcard,
+		Fuzzy,
+	};
+
+	static TermPattern Parse(std::string_view word);
+
+	// Номера подходящих терминов словаря по возрастанию
+	std::vector<uint32_t> Expand(const TermDictionary& dictionary) const;
+
+	Type type = Type::Exact;
+	std::string text;
+	uint32_t maxEdits = 0;
+};
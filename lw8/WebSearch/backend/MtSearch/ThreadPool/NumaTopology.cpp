@@ -0,0 +1,100 @@
+#include "NumaTopology.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <thread>
+
+NumaTopology NumaTopology::Detect()
+{
+	NumaTopology topology;
+	std::error_code error;
+	for (int node = 0;; ++node)
+	{
+		const auto path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+		if (!std::filesystem::exists(path, error))
+		{
+			break;
+		}
+		std::string cpuList;
+		std::getline(std::ifstream(path), cpuList);
+		// Узел без процессоров (только память) потоки не принимает
+		if (auto cpus = ParseCpuList(cpuList); !cpus.empty())
+		{
+			topology.nodeCpus.push_back(std::move(cpus));
+		}
+	}
+
+	if (topology.nodeCpus.empty())
+	{
+		auto& cpus = topology.nodeCpus.emplace_back();
+		for (int cpu = 0; cpu < static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)); ++cpu)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+	return topology;
+}
+
+std::vector<int> NumaTopology::ParseCpuList(std::string_view cpuList)
+{
+	auto parseNumber = [](std::string_view& text) -> std::optional<int> {
+		int value = 0;
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (error != std::errc())
+		{
+			return std::nullopt;
+		}
+		text.remove_prefix(end - text.data());
+		return value;
+	};
+
+	std::vector<int> cpus;
+	while (!cpuList.empty())
+	{
+		const auto first = parseNumber(cpuList);
+		if (!first)
+		{
+			break;
+		}
+		auto last = first;
+		if (cpuList.starts_with('-'))
+		{
+			cpuList.remove_prefix(1);
+			last = parseNumber(cpuList);
+			if (!last)
+			{
+				break;
+			}
+		}
+		for (auto cpu = *first; cpu <= *last; ++cpu)
+		{
+			cpus.push_back(cpu);
+		}
+		if (!cpuList.starts_with(','))
+		{
+			break;
+		}
+		cpuList.remove_prefix(1);
+	}
+	return cpus;
+}
+
+bool PinCurrentThread(const std::span<const int> cpus)
+{
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (const auto cpu : cpus)
+	{
+		if (cpu >= 0 && cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &cpuSet);
+		}
+	}
+	return CPU_COUNT(&cpuSet) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Процессоры каждого NUMA-узла по данным /sys/devices/system/node. Без NUMA (или без sysfs) машина
+// считается одним узлом из всех процессоров
+struct NumaTopology
+{
+	std::vector<std::vector<int>> nodeCpus;
+
+	static NumaTopology Detect();
+	// Список вида "0-3,8,10-11"
+	static std::vector<int> ParseCpuList(std::string_view cpuList);
+};
+
+// false, если ядро отказало (например, процессоров нет в cpuset процесса)
+bool PinCurrentThread(std::span<const int> cpus);
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Хеш-таблица с открытой адресацией для подсчёта терминов документа. Ключи — string_view в буфер документа,
+// память таблицы переиспользуется между документами, поэтому на каждый токен аллокаций нет.
+// По запросу счётчик запоминает и позиции вхождений — порядковые номера токенов в документе
+class TermCounter
+{
+public:
+	struct Entry
+	{
+		std::string_view term;
+		uint32_t count;
+		std::span<const uint32_t> positions;
+	};
+
+	explicit TermCounter(bool recordPositions = false);
+
+	void Add(std::string_view term);
+	void Clear();
+
+	std::span<const Entry> GetEntries() const;
+	uint32_t GetTotalCount() const;
+
+private:
+	static constexpr size_t MIN_SLOTS_COUNT = 256;
+
+	void Grow();
+	size_t FindSlot(std::string_view term, size_t hash) const;
+
+	std::vector<Entry> m_entries;
+	std::vector<size_t> m_entryHashes;
+	std::vector<uint32_t> m_slots = std::vector<uint32_t>(MIN_SLOTS_COUNT, 0);
+	uint32_t m_totalCount = 0;
+	bool m_recordPositions;
+	// Списки позиций не освобождаются при Clear, чтобы их ёмкость досталась следующим документам
+	std::vector<std::vector<uint32_t>> m_entryPositions;
+};
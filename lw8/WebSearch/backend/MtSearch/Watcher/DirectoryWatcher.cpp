@@ -0,0 +1,158 @@
+#include "DirectoryWatcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+constexpr int POLL_INTERVAL_MS = 200;
+constexpr int QUIET_PERIOD_MS = 100;
+constexpr auto MAX_BATCH_DELAY = 1s;
+constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+DirectoryWatcher::DirectoryWatcher(std::string dirPath, Callback callback)
+	: m_dirPath(std::move(dirPath))
+	, m_callback(std::move(callback))
+	, m_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+	if (m_fd < 0)
+	{
+		throw std::runtime_error("Cannot initialize inotify");
+	}
+	AddWatches(m_dirPath);
+
+	m_thread = std::jthread([this](const std::stop_token& stopToken) {
+		WatchLoop(stopToken);
+	});
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	m_thread.request_stop();
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+	close(m_fd);
+}
+
+const std::string& DirectoryWatcher::GetDirPath() const
+{
+	return m_dirPath;
+}
+
+void DirectoryWatcher::AddWatches(const std::string& dirPath)
+{
+	auto addWatch = [this](const std::string& path) {
+		const auto wd = inotify_add_watch(m_fd, path.c_str(), WATCH_MASK);
+		if (wd < 0)
+		{
+			std::cerr << "Cannot watch directory: " << path << std::endl;
+			return;
+		}
+		m_watchPaths[wd] = path;
+	};
+
+	addWatch(dirPath);
+	std::error_code ec;
+	for (std::filesystem::recursive_directory_iterator it(dirPath, ec), end; !ec && it != end; it.increment(ec))
+	{
+		if (it->is_directory(ec))
+		{
+			addWatch(it->path());
+		}
+	}
+}
+
+void DirectoryWatcher::ReadEvents(std::vector<std::string>& changedPaths)
+{
+	alignas(inotify_event) char buffer[64 * 1024];
+	while (true)
+	{
+		const auto length = read(m_fd, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			return;
+		}
+
+		for (auto* ptr = buffer; ptr < buffer + length;)
+		{
+			const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+			ptr += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				changedPaths.push_back(m_dirPath);
+				continue;
+			}
+			if (event->mask & IN_IGNORED)
+			{
+				m_watchPaths.erase(event->wd);
+				continue;
+			}
+
+			const auto it = m_watchPaths.find(event->wd);
+			if (it == m_watchPaths.end() || event->len == 0)
+			{
+				continue;
+			}
+
+			auto path = it->second + "/" + event->name;
+			if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+			{
+				AddWatches(path);
+			}
+			else if (!(event->mask & IN_ISDIR) && (event->mask & IN_CREATE))
+			{
+				// Содержимое нового файла придёт вместе с IN_CLOSE_WRITE
+				continue;
+			}
+			changedPaths.push_back(std::move(path));
+		}
+	}
+}
+
+void DirectoryWatcher::WatchLoop(const std::stop_token& stopToken)
+{
+	std::vector<std::string> changedPaths;
+	auto batchStart = std::chrono::steady_clock::now();
+
+	while (!stopToken.stop_requested())
+	{
+		pollfd pollFd{ m_fd, POLLIN, 0 };
+		const auto ready = poll(&pollFd, 1, changedPaths.empty() ? POLL_INTERVAL_MS : QUIET_PERIOD_MS);
+		if (ready < 0 && errno != EINTR)
+		{
+			std::cerr << "inotify poll failed for " << m_dirPath << std::endl;
+			return;
+		}
+
+		if (ready > 0)
+		{
+			if (changedPaths.empty())
+			{
+				batchStart = std::chrono::steady_clock::now();
+			}
+			ReadEvents(changedPaths);
+		}
+
+		const auto isQuiet = ready == 0;
+		const auto isBatchTooOld = std::chrono::steady_clock::now() - batchStart > MAX_BATCH_DELAY;
+		if (!changedPaths.empty() && (isQuiet || isBatchTooOld))
+		{
+			std::ranges::sort(changedPaths);
+			const auto [first, last] = std::ranges::unique(changedPaths);
+			changedPaths.erase(first, last);
+
+			m_callback(changedPaths);
+			changedPaths.clear();
+		}
+	}
+}
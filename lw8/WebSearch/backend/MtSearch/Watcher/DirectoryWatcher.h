@@ -0,0 +1,33 @@
+#pragma once
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Следит за деревом каталогов через inotify и пачками отдаёт изменившиеся пути после короткого затишья
+class DirectoryWatcher
+{
+public:
+	using Callback = std::function<void(const std::vector<std::string>& changedPaths)>;
+
+	DirectoryWatcher(std::string dirPath, Callback callback);
+	~DirectoryWatcher();
+
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+	const std::string& GetDirPath() const;
+
+private:
+	void AddWatches(const std::string& dirPath);
+	void ReadEvents(std::vector<std::string>& changedPaths);
+	void WatchLoop(const std::stop_token& stopToken);
+
+	std::string m_dirPath;
+	Callback m_callback;
+	int m_fd;
+	std::unordered_map<int, std::string> m_watchPaths;
+	std::jthread m_thread;
+};
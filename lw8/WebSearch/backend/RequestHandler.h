@@ -1,14 +1,22 @@
 #pragma once
 #include "FileInfoOutput.h"
+#include "Handlers/BadRequestHandler.h"
 #include "Handlers/NotFoundHandler.h"
 #include "Handlers/ProcessOptionsHandler.h"
+#include "Handlers/ServiceUnavailableHandler.h"
+#include "Indexer/BatchIndexer.h"
 #include "JsonConverter.h"
 #include "MtSearch/MtSearch.h"
+#include "Server/ServerOptions.h"
 
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
 #include <boost/url/parse.hpp>
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <optional>
+#include <system_error>
 
 namespace http = boost::beast::http;
 namespace json = boost::json;
@@ -16,13 +24,29 @@ namespace json = boost::json;
 class RequestHandler : public BaseHandler
 {
 public:
-	RequestHandler()
+	explicit RequestHandler(const ServerOptions& options)
+		: m_sourceDir(CanonicalizeDir(options.sourceDir))
 	{
-		m_search->AddDirToIndex("/home/dmitriy.rybakov/projects/crm/crm-app", true);
+		// Файлы могли измениться, пока сервер не работал, поэтому загруженный индекс досинхронизируется
+		if (std::filesystem::exists(options.indexPath))
+		{
+			m_search->LoadIndex(options.indexPath);
+			m_search->SyncDir(options.sourceDir);
+		}
+		else
+		{
+			m_search->AddDirToIndex(options.sourceDir, true);
+		}
+		m_search->SaveIndex(options.indexPath);
+
+		BatchIndexer::Options indexerOptions;
+		indexerOptions.indexPath = options.indexPath;
+		m_indexer = std::make_unique<BatchIndexer>(*m_search, indexerOptions);
 	}
 
+	// Тело ответа со списком пишется в responseBuffer сессии, который должен жить до конца отправки
 	template <class Body, class Allocator>
-	http::message_generator Handle(http::request<Body, http::basic_fields<Allocator>>&& request)
+	http::message_generator Handle(http::request<Body, http::basic_fields<Allocator>>&& request, std::string& responseBuffer)
 	{
 		auto url = boost::urls::parse_origin_form(request.target());
 
@@ -33,20 +57,27 @@ public:
 
 		if (request.target().contains("/list") && request.method() == http::verb::get)
 		{
-			return ProcessListRequest(request);
+			return ProcessListRequest(request, responseBuffer);
+		}
+
+		if (request.target().contains("/add") && request.method() == http::verb::post)
+		{
+			return ProcessAddRequest(request, responseBuffer);
 		}
 
-		// if (request.target().contains("/add") && request.method() == http::verb::post)
-		// {
-		// 	return ProcessAddRequest(request);
-		// }
+		if (request.target().contains("/status") && request.method() == http::verb::get)
+		{
+			return ProcessStatusRequest(request, responseBuffer);
+		}
 
 		return NotFoundHandler::Handle(request);
 	}
 
 private:
 	template <class Body, class Allocator>
-	http::message_generator ProcessListRequest(const http::request<Body, http::basic_fields<Allocator>>& request)
+	http::message_generator ProcessListRequest(
+		const http::request<Body, http::basic_fields<Allocator>>& request,
+		std::string& responseBuffer)
 	{
 		auto url = boost::urls::parse_origin_form(request.target());
 
@@ -76,38 +107,204 @@ private:
 					{ { "error", "Parameters 'from' and 'to' must be a number" } });
 			}
 		}
+		// Глубину выдачи ограничивает сервер: иначе один запрос заставил бы ранжировать и держать в памяти сколько угодно документов
+		if (from < 0 || to < 0 || static_cast<size_t>(to) > MtSearch::MAX_RESULTS_DEPTH)
+		{
+			return GetJsonResponse(
+				http::status::bad_request,
+				request.version(),
+				{ { "error", "Parameters 'from' and 'to' must be between 0 and " + std::to_string(MtSearch::MAX_RESULTS_DEPTH) } });
+		}
 
 		const auto words = SplitBySpaces(wordsStr);
-		auto filesData = m_search->ListMostRelevantDocIds(words, from, to);
+		const auto filesData = m_search->ListMostRelevantDocIds(words, from, to);
+
+		return ListFileLinksResponse(filesData, request, responseBuffer);
+	}
+
+	// Тело: страница { "url", "title", "content" }, массив таких страниц в "documents" и/или пути файлов
+	// из каталога источника в "paths". Ответ приходит сразу, индексирует фоновый BatchIndexer
+	template <class Body, class Allocator>
+	http::message_generator ProcessAddRequest(
+		const http::request<Body, http::basic_fields<Allocator>>& request,
+		std::string& responseBuffer)
+	{
+		boost::system::error_code errorCode;
+		const auto data = json::parse(request.body(), errorCode);
+		if (errorCode || !data.is_object())
+		{
+			return BadRequestHandler::Handle("Body must be a JSON object", request);
+		}
+		const auto& object = data.as_object();
+
+		std::vector<MtSearch::Document> pages;
+		std::vector<std::string> filePaths;
+		if (object.if_contains("url") != nullptr && !ReadPage(object, pages))
+		{
+			return BadRequestHandler::Handle("Fields 'url', 'title' and 'content' must be strings", request);
+		}
+		if (const auto* documents = object.if_contains("documents"))
+		{
+			const auto* documentsArray = documents->if_array();
+			if (documentsArray == nullptr)
+			{
+				return BadRequestHandler::Handle("Field 'documents' must be an array", request);
+			}
+			for (const auto& document : *documentsArray)
+			{
+				if (!document.is_object() || !ReadPage(document.as_object(), pages))
+				{
+					return BadRequestHandler::Handle("Each document must have string 'url' and 'content'", request);
+				}
+			}
+		}
+		if (const auto* paths = object.if_contains("paths"))
+		{
+			const auto* pathsArray = paths->if_array();
+			if (pathsArray == nullptr)
+			{
+				return BadRequestHandler::Handle("Field 'paths' must be an array", request);
+			}
+			for (const auto& path : *pathsArray)
+			{
+				const auto* pathString = path.if_string();
+				if (pathString == nullptr)
+				{
+					return BadRequestHandler::Handle("Each path must be a string", request);
+				}
+				// Отсутствующий файл и файл вне каталога получают один ответ, чтобы по нему нельзя было проверить,
+				// есть ли файл на сервере
+				auto sourcePath = ResolveSourcePath(std::string_view(*pathString));
+				if (!sourcePath)
+				{
+					return BadRequestHandler::Handle("Each path must be an existing file inside the source directory", request);
+				}
+				filePaths.push_back(std::move(*sourcePath));
+			}
+		}
+		if (pages.empty() && filePaths.empty())
+		{
+			return BadRequestHandler::Handle("Nothing to add: expected 'url' and 'content', 'documents' or 'paths'", request);
+		}
+
+		const auto queuedCount = pages.size() + filePaths.size();
+		if (!m_indexer->Enqueue(std::move(pages), std::move(filePaths)))
+		{
+			return ServiceUnavailableHandler::Handle("Indexing queue is full", request);
+		}
+
+		responseBuffer.clear();
+		JsonWriter writer(responseBuffer);
+		writer.BeginObject();
+		writer.Key("queued");
+		writer.Number(static_cast<uint64_t>(queuedCount));
+		writer.Key("queueDepth");
+		writer.Number(static_cast<uint64_t>(m_indexer->GetStatus().queueDepth));
+		writer.EndObject();
+		return GetBufferedJsonResponse(http::status::accepted, request.version(), responseBuffer);
+	}
+
+	template <class Body, class Allocator>
+	http::message_generator ProcessStatusRequest(
+		const http::request<Body, http::basic_fields<Allocator>>& request,
+		std::string& responseBuffer)
+	{
+		const auto status = m_indexer->GetStatus();
+
+		responseBuffer.clear();
+		JsonWriter writer(responseBuffer);
+		writer.BeginObject();
+		writer.Key("queueDepth");
+		writer.Number(static_cast<uint64_t>(status.queueDepth));
+		writer.Key("queueCapacity");
+		writer.Number(static_cast<uint64_t>(status.queueCapacity));
+		writer.Key("indexingDocuments");
+		writer.Number(static_cast<uint64_t>(status.indexingDocs));
+		writer.Key("batchesCommitted");
+		writer.Number(status.batchesCommitted);
+		writer.Key("documentsCommitted");
+		writer.Number(status.docsCommitted);
+		writer.Key("lastCommittedEpoch");
+		writer.Number(status.lastCommittedEpoch);
+		writer.Key("lastSavedEpoch");
+		writer.Number(status.lastSavedEpoch);
+		writer.Key("indexEpoch");
+		writer.Number(m_search->GetIndexEpoch());
+		if (!status.lastError.empty())
+		{
+			writer.Key("lastError");
+			writer.String(status.lastError);
+		}
+		writer.EndObject();
+		return GetBufferedJsonResponse(http::status::ok, request.version(), responseBuffer);
+	}
 
-		return ListFileLinksResponse(filesData, request);
+	// Путь без символических ссылок и «..», если он ведёт в каталог источника
+	std::optional<std::string> ResolveSourcePath(const std::string_view path) const
+	{
+		std::error_code errorCode;
+		const auto resolved = std::filesystem::canonical(path, errorCode);
+		if (errorCode || !std::filesystem::is_regular_file(resolved, errorCode))
+		{
+			return std::nullopt;
+		}
+		if (std::mismatch(m_sourceDir.begin(), m_sourceDir.end(), resolved.begin(), resolved.end()).first != m_sourceDir.end())
+		{
+			return std::nullopt;
+		}
+		return resolved.string();
+	}
+
+	// Завершающий разделитель дал бы пустой последний элемент, с которым не совпал бы ни один путь
+	static std::filesystem::path CanonicalizeDir(const std::string& dir)
+	{
+		auto canonicalDir = std::filesystem::weakly_canonical(dir);
+		return canonicalDir.has_filename() ? canonicalDir : canonicalDir.parent_path();
 	}
 
-	// template <class Body, class Allocator>
-	// http::message_generator ProcessAddRequest(const http::request<Body, http::basic_fields<Allocator>>& request)
-	// {
-	// 	auto data = json::parse(request.body());
-	// }
+	// Заголовок страницы индексируется вместе с текстом
+	static bool ReadPage(const json::object& object, std::vector<MtSearch::Document>& pages)
+	{
+		const auto* url = object.if_contains("url");
+		const auto* content = object.if_contains("content");
+		const auto* title = object.if_contains("title");
+		if (url == nullptr || !url->is_string() || content == nullptr || !content->is_string()
+			|| (title != nullptr && !title->is_string()))
+		{
+			return false;
+		}
+
+		std::string text;
+		if (title != nullptr)
+		{
+			text.append(std::string_view(title->as_string()));
+			text.push_back('\n');
+		}
+		text.append(std::string_view(content->as_string()));
+		pages.push_back({ std::string(std::string_view(url->as_string())), std::move(text) });
+		return true;
+	}
 
+	// Результаты уже упорядочены по убыванию релевантности
 	template <class Body, class Allocator>
 	http::message_generator ListFileLinksResponse(
 		const std::vector<FileInfoOutput>& filesInfo,
-		const http::request<Body, http::basic_fields<Allocator>>& request)
+		const http::request<Body, http::basic_fields<Allocator>>& request,
+		std::string& responseBuffer)
 	{
-		auto filesData = filesInfo;
-		std::ranges::sort(filesData, std::ranges::greater{}, &FileInfoOutput::relevant);
-
-		json::array fileLinks;
-		for (const auto& fileInfo : filesData)
+		responseBuffer.clear();
+		JsonWriter writer(responseBuffer);
+		writer.BeginObject();
+		writer.Key("data");
+		writer.BeginArray();
+		for (const auto& fileInfo : filesInfo)
 		{
-			const auto value = JsonConverter::ConvertFileInfoToJson(fileInfo);
-			fileLinks.push_back(value);
+			JsonConverter::WriteFileInfo(writer, fileInfo);
 		}
+		writer.EndArray();
+		writer.EndObject();
 
-		return GetJsonResponse(
-			http::status::ok,
-			request.version(),
-			{ { "data", std::move(fileLinks) } });
+		return GetBufferedJsonResponse(http::status::ok, request.version(), responseBuffer);
 	}
 
 	static std::vector<std::string> SplitBySpaces(const std::string& str)
@@ -131,4 +328,6 @@ private:
 		std::cin,
 		std::cout,
 		THREADS);
+	const std::filesystem::path m_sourceDir;
+	std::unique_ptr<BatchIndexer> m_indexer;
 };
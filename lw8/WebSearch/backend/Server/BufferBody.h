@@ -0,0 +1,59 @@
+#pragma once
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// Тело ответа, которое ссылается на буфер сессии и не копирует его. Буфер отдаётся кусками по
+// CHUNK_SIZE: при Transfer-Encoding: chunked каждый кусок уходит отдельным чанком
+struct BufferBody
+{
+	static constexpr size_t CHUNK_SIZE = 16 << 10;
+
+	// Буфер должен жить до конца отправки ответа
+	using value_type = const std::string*;
+
+	static std::uint64_t size(const value_type& body)
+	{
+		return body != nullptr ? body->size() : 0;
+	}
+
+	class writer
+	{
+	public:
+		using const_buffers_type = boost::asio::const_buffer;
+
+		template <bool isRequest, class Fields>
+		writer(const boost::beast::http::header<isRequest, Fields>&, const value_type& body)
+			: m_body(body)
+		{
+		}
+
+		void init(boost::beast::error_code& errorCode)
+		{
+			errorCode = {};
+		}
+
+		boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& errorCode)
+		{
+			errorCode = {};
+			const auto bodySize = size(m_body);
+			if (m_offset >= bodySize)
+			{
+				return boost::none;
+			}
+			const auto chunkSize = std::min<size_t>(CHUNK_SIZE, bodySize - m_offset);
+			const const_buffers_type chunk(m_body->data() + m_offset, chunkSize);
+			m_offset += chunkSize;
+			return std::pair{ chunk, m_offset < bodySize };
+		}
+
+	private:
+		value_type m_body;
+		size_t m_offset = 0;
+	};
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Запас буферов ответов с уже выделенной памятью. Сессия берёт буферы для своих запросов,
+// переиспользует их между keep-alive запросами, а после закрытия возвращает для следующих соединений
+class BufferPool
+{
+public:
+	BufferPool(const size_t maxBuffers, const size_t maxBufferCapacity)
+		: m_maxBuffers(maxBuffers)
+		, m_maxBufferCapacity(maxBufferCapacity)
+	{
+	}
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	std::string Acquire()
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_buffers.empty())
+		{
+			return {};
+		}
+		auto buffer = std::move(m_buffers.back());
+		m_buffers.pop_back();
+		return buffer;
+	}
+
+	// Слишком большие буферы (после редкого огромного ответа) не оставляются, чтобы не держать память
+	void Release(std::string buffer)
+	{
+		if (buffer.capacity() > m_maxBufferCapacity)
+		{
+			return;
+		}
+		buffer.clear();
+
+		std::lock_guard lock(m_mutex);
+		if (m_buffers.size() < m_maxBuffers)
+		{
+			m_buffers.push_back(std::move(buffer));
+		}
+	}
+
+private:
+	const size_t m_maxBuffers;
+	const size_t m_maxBufferCapacity;
+	std::mutex m_mutex;
+	std::vector<std::string> m_buffers;
+};
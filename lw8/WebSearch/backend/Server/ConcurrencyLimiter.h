@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Допуск запросов к пулу поиска. Запрос, который встанет в очередь, пропускается, только если
+// по среднему времени обработки он дождётся свободного потока в пределах SLO по задержке.
+// Иначе лучше сразу ответить 503, чем держать клиента и удлинять очередь для остальных
+class ConcurrencyLimiter
+{
+public:
+	ConcurrencyLimiter(const size_t workers, const std::chrono::nanoseconds latencySlo, const size_t maxQueued)
+		: m_workers(workers)
+		, m_latencySloNs(static_cast<uint64_t>(latencySlo.count()))
+		, m_maxQueued(maxQueued)
+	{
+	}
+
+	ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+	ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+	bool TryAcquire()
+	{
+		auto inFlight = m_inFlight.load(std::memory_order_relaxed);
+		do
+		{
+			if (inFlight >= m_workers + m_maxQueued)
+			{
+				return false;
+			}
+			if (inFlight >= m_workers)
+			{
+				// Впереди в очереди inFlight - workers запросов, и ещё один освобождения потока ждёт этот запрос
+				const auto queuedAhead = inFlight - m_workers + 1;
+				const auto expectedWaitNs = m_serviceTimeNs.load(std::memory_order_relaxed) * queuedAhead / m_workers;
+				if (expectedWaitNs > m_latencySloNs)
+				{
+					return false;
+				}
+			}
+		} while (!m_inFlight.compare_exchange_weak(inFlight, inFlight + 1, std::memory_order_relaxed));
+		return true;
+	}
+
+	// Вызывается после обработки допущенного запроса с временем его выполнения в пуле
+	void Release(const std::chrono::nanoseconds serviceTime)
+	{
+		// Скользящее среднее с весом нового замера 1/8
+		const auto sampleNs = static_cast<uint64_t>(serviceTime.count());
+		auto averageNs = m_serviceTimeNs.load(std::memory_order_relaxed);
+		while (!m_serviceTimeNs.compare_exchange_weak(
+			averageNs,
+			averageNs - averageNs / 8 + sampleNs / 8,
+			std::memory_order_relaxed))
+		{
+		}
+		m_inFlight.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+private:
+	const size_t m_workers;
+	const uint64_t m_latencySloNs;
+	const size_t m_maxQueued;
+	std::atomic<size_t> m_inFlight{ 0 };
+	std::atomic<uint64_t> m_serviceTimeNs{ 0 };
+};
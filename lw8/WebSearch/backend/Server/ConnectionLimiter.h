@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Счётчик открытых соединений. Слот занимается при приёме соединения и освобождается при уничтожении сессии
+class ConnectionLimiter
+{
+public:
+	explicit ConnectionLimiter(const size_t maxConnections)
+		: m_maxConnections(maxConnections)
+	{
+	}
+
+	ConnectionLimiter(const ConnectionLimiter&) = delete;
+	ConnectionLimiter& operator=(const ConnectionLimiter&) = delete;
+
+	bool TryAcquire()
+	{
+		auto active = m_active.load(std::memory_order_relaxed);
+		do
+		{
+			if (active >= m_maxConnections)
+			{
+				return false;
+			}
+		} while (!m_active.compare_exchange_weak(active, active + 1, std::memory_order_relaxed));
+		return true;
+	}
+
+	void Release()
+	{
+		m_active.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	size_t GetActiveCount() const
+	{
+		return m_active.load(std::memory_order_relaxed);
+	}
+
+private:
+	const size_t m_maxConnections;
+	std::atomic<size_t> m_active{ 0 };
+};
@@ -1,18 +1,49 @@
 #include "Listener.h"
-#include "Session.h"
 
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core/bind_handler.hpp>
 #include <boost/beast/core/error.hpp>
+#include <string>
+
+namespace
+{
+// Ответ сверх лимита соединений заготовлен заранее: запрос не читается, чтобы не тратить на него ресурсы
+const std::string& GetTooManyConnectionsResponse()
+{
+	static const std::string response = [] {
+		const std::string body = R"({"error":"Service unavailable","message":"Too many connections"})";
+		return "HTTP/1.1 503 Service Unavailable\r\n"
+			   "Content-Type: application/json\r\n"
+			   "Access-Control-Allow-Origin: *\r\n"
+			   "Retry-After: 1\r\n"
+			   "Connection: close\r\n"
+			   "Content-Length: "
+			+ std::to_string(body.size()) + "\r\n\r\n" + body;
+	}();
+	return response;
+}
+} // namespace
 
 Listener::Listener(
 	boost::asio::io_context& ioContext,
 	const boost::asio::ip::tcp::endpoint& endpoint,
-	const std::shared_ptr<RequestHandler>& handler)
+	const std::shared_ptr<RequestHandler>& handler,
+	const ComputeExecutor& computeExecutor,
+	const std::shared_ptr<BufferPool>& bufferPool,
+	const std::shared_ptr<ConcurrencyLimiter>& concurrencyLimiter,
+	const ServerOptions& options)
 
 	: m_ioContext(ioContext)
 	, m_acceptor(boost::asio::make_strand(ioContext))
 	, m_handler(handler)
+	, m_computeExecutor(computeExecutor)
+	, m_bufferPool(bufferPool)
+	, m_concurrencyLimiter(concurrencyLimiter)
+	, m_options(options)
+	, m_connectionLimiter(std::make_shared<ConnectionLimiter>(options.maxConnections))
 {
 	boost::beast::error_code errorCode;
 	m_acceptor.open(endpoint.protocol(), errorCode);
@@ -37,8 +68,9 @@ void Listener::Run()
 
 void Listener::Stop()
 {
-	m_ioContext.post([this]() {
-		m_acceptor.close();
+	// io_context крутится в нескольких потоках, поэтому акцептор закрывается в своём strand
+	boost::asio::post(m_acceptor.get_executor(), [self = shared_from_this()]() {
+		self->m_acceptor.close();
 	});
 }
 
@@ -57,6 +89,34 @@ void Listener::OnAccept(
 	{
 		return;
 	}
-	std::make_shared<Session>(std::move(socket), std::move(m_handler))->Start();
+	if (m_connectionLimiter->TryAcquire())
+	{
+		std::make_shared<Session>(
+			std::move(socket),
+			m_handler,
+			m_computeExecutor,
+			m_bufferPool,
+			m_connectionLimiter,
+			m_concurrencyLimiter,
+			m_options)
+			->Start();
+	}
+	else
+	{
+		RejectConnection(std::move(socket));
+	}
 	Accept();
+}
+
+void Listener::RejectConnection(boost::asio::ip::tcp::socket socket)
+{
+	auto stream = std::make_shared<boost::beast::tcp_stream>(std::move(socket));
+	stream->expires_after(m_options.writeTimeout);
+	boost::asio::async_write(
+		*stream,
+		boost::asio::buffer(GetTooManyConnectionsResponse()),
+		[stream](const boost::beast::error_code&, std::size_t) {
+			boost::beast::error_code errorCode;
+			stream->socket().shutdown(boost::asio::ip::tcp::socket::shutdown_send, errorCode);
+		});
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "../RequestHandler.h"
+#include "Session.h"
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/core/error.hpp>
@@ -11,7 +12,11 @@ public:
 	Listener(
 		boost::asio::io_context& ioContext,
 		const boost::asio::ip::tcp::endpoint& endpoint,
-		const std::shared_ptr<RequestHandler>& handler);
+		const std::shared_ptr<RequestHandler>& handler,
+		const ComputeExecutor& computeExecutor,
+		const std::shared_ptr<BufferPool>& bufferPool,
+		const std::shared_ptr<ConcurrencyLimiter>& concurrencyLimiter,
+		const ServerOptions& options);
 
 	void Run();
 
@@ -24,8 +29,15 @@ private:
 		const boost::beast::error_code& errorCode,
 		boost::asio::ip::tcp::socket socket);
 
+	void RejectConnection(boost::asio::ip::tcp::socket socket);
+
 private:
 	boost::asio::io_context& m_ioContext;
 	boost::asio::ip::tcp::acceptor m_acceptor;
 	std::shared_ptr<RequestHandler> m_handler;
+	ComputeExecutor m_computeExecutor;
+	std::shared_ptr<BufferPool> m_bufferPool;
+	std::shared_ptr<ConcurrencyLimiter> m_concurrencyLimiter;
+	const ServerOptions m_options;
+	std::shared_ptr<ConnectionLimiter> m_connectionLimiter;
 };
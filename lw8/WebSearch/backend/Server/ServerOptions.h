@@ -0,0 +1,27 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+struct ServerOptions
+{
+	// Соединения сверх лимита сразу получают 503 и закрываются
+	size_t maxConnections = 10000;
+	// Сколько запросов одного соединения обрабатывается одновременно, пока ответы на предыдущие не отправлены
+	size_t maxPipelinedRequests = 16;
+	// Ожидание первого байта следующего запроса в keep-alive соединении
+	std::chrono::seconds idleTimeout{ 30 };
+	// За это время после первого байта запроса должен прийти весь заголовок
+	std::chrono::seconds headerTimeout{ 10 };
+	std::chrono::seconds bodyTimeout{ 30 };
+	std::chrono::seconds writeTimeout{ 30 };
+	// Запрос отклоняется сразу, если ожидаемое ожидание в очереди поиска больше этого времени
+	std::chrono::milliseconds latencySlo{ 200 };
+	// Жёсткий предел запросов, ждущих свободного потока поиска
+	size_t maxQueuedRequests = 1024;
+	// Индекс загружается отсюда при старте, а изменения из /add сохраняются сюда контрольными точками
+	std::string indexPath = "websearch.idx";
+	// Каталог, который индексируется при старте; загруженный индекс сверяется с ним.
+	// Через "paths" в /add можно добавить только файлы из него
+	std::string sourceDir = "/home/dmitriy.rybakov/projects/crm/crm-app";
+};
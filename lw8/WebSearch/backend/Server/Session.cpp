@@ -1,72 +1,247 @@
 #include "Session.h"
 
+#include <boost/asio/post.hpp>
 #include <boost/beast/http/read.hpp>
+#include <chrono>
 
-constexpr int TIMEOUT_IN_SECONDS = 30;
+constexpr size_t READ_CHUNK_SIZE = 4096;
 
 Session::Session(
 	boost::asio::ip::tcp::socket socket,
-	const std::shared_ptr<RequestHandler>& handler)
+	const std::shared_ptr<RequestHandler>& handler,
+	const ComputeExecutor& computeExecutor,
+	const std::shared_ptr<BufferPool>& bufferPool,
+	const std::shared_ptr<ConnectionLimiter>& connectionLimiter,
+	const std::shared_ptr<ConcurrencyLimiter>& concurrencyLimiter,
+	const ServerOptions& options)
 	: m_handler(handler)
+	, m_computeExecutor(computeExecutor)
+	, m_bufferPool(bufferPool)
+	, m_connectionLimiter(connectionLimiter)
+	, m_concurrencyLimiter(concurrencyLimiter)
+	, m_options(options)
 	, m_stream(std::move(socket))
 {
 }
 
+Session::~Session()
+{
+	for (auto& response : m_responses)
+	{
+		m_bufferPool->Release(std::move(response.buffer));
+	}
+	for (auto& buffer : m_spareBuffers)
+	{
+		m_bufferPool->Release(std::move(buffer));
+	}
+	m_connectionLimiter->Release();
+}
+
 void Session::Start()
 {
-	Read();
+	// Первый запрос ждётся с таймаутом заголовка: соединение, по которому ничего не шлют, не держит слот долго
+	m_reading = true;
+	ReadHeader();
 }
 
 void Session::Read()
 {
-	m_request = {};
-	m_stream.expires_after(std::chrono::seconds(TIMEOUT_IN_SECONDS));
+	m_reading = true;
+	if (m_buffer.size() > 0)
+	{
+		ReadHeader();
+		return;
+	}
+
+	// Простой между запросами: ждём первый байт, а уже потом отсчитываем таймаут заголовка
+	m_stream.expires_after(m_options.idleTimeout);
+	m_stream.async_read_some(
+		m_buffer.prepare(READ_CHUNK_SIZE),
+		boost::beast::bind_front_handler(&Session::OnReadSome, shared_from_this()));
+}
+
+void Session::ReadHeader()
+{
+	m_parser.emplace();
+	m_stream.expires_after(m_options.headerTimeout);
+	http::async_read_header(
+		m_stream,
+		m_buffer,
+		*m_parser,
+		boost::beast::bind_front_handler(&Session::OnReadHeader, shared_from_this()));
+}
+
+void Session::OnReadSome(const boost::beast::error_code& errorCode, std::size_t bytesRead)
+{
+	if (errorCode)
+	{
+		OnReadError();
+		return;
+	}
+	m_buffer.commit(bytesRead);
+	ReadHeader();
+}
+
+void Session::OnReadHeader(const boost::beast::error_code& errorCode, std::size_t bytesRead)
+{
+	if (errorCode)
+	{
+		OnReadError();
+		return;
+	}
+	if (m_parser->is_done())
+	{
+		OnRequest();
+		return;
+	}
+
+	m_stream.expires_after(m_options.bodyTimeout);
 	http::async_read(
 		m_stream,
 		m_buffer,
-		m_request,
-		boost::beast::bind_front_handler(&Session::OnRead, shared_from_this()));
+		*m_parser,
+		boost::beast::bind_front_handler(&Session::OnReadBody, shared_from_this()));
 }
 
-void Session::OnRead(const boost::beast::error_code& errorCode, std::size_t bytesRead)
+void Session::OnReadBody(const boost::beast::error_code& errorCode, std::size_t bytesRead)
 {
-	if (errorCode == http::error::end_of_stream)
+	if (errorCode)
+	{
+		OnReadError();
+		return;
+	}
+	OnRequest();
+}
+
+void Session::OnReadError()
+{
+	// Ответы на уже прочитанные запросы ещё отправляются, соединение закрывается после последнего
+	m_reading = false;
+	m_readClosed = true;
+	if (m_responses.empty())
 	{
 		Close();
+	}
+}
+
+void Session::OnRequest()
+{
+	m_reading = false;
+	auto request = m_parser->release();
+	m_parser.reset();
+	if (!request.keep_alive())
+	{
+		m_readClosed = true;
+	}
+
+	auto& response = m_responses.emplace_back();
+	if (m_concurrencyLimiter->TryAcquire())
+	{
+		response.buffer = AcquireBuffer();
+		boost::asio::post(m_computeExecutor, [self = shared_from_this(), request = std::move(request), &response]() mutable {
+			self->HandleRequest(std::move(request), response);
+		});
+	}
+	else
+	{
+		response.message.emplace(ServiceUnavailableHandler::Handle("Search queue wait exceeds latency limit", request));
+		response.ready = true;
+		WriteNext();
+	}
+
+	ContinueReading();
+}
+
+void Session::ContinueReading()
+{
+	if (m_reading || m_readClosed || m_responses.size() >= m_options.maxPipelinedRequests)
+	{
 		return;
 	}
-	if (errorCode)
+	// Пока есть неотправленные ответы, читаются только запросы, уже пришедшие в буфер.
+	// Иначе таймаут простоя закрыл бы соединение вместе с запросами в обработке
+	if (!m_responses.empty() && m_buffer.size() == 0)
 	{
 		return;
 	}
+	Read();
+}
 
+void Session::HandleRequest(http::request<http::string_body>&& request, PendingResponse& response)
+{
+	const auto start = std::chrono::steady_clock::now();
+	std::optional<http::message_generator> message;
 	try
 	{
-		SendResponse(m_handler->Handle(std::move(m_request)));
+		message.emplace(m_handler->Handle(std::move(request), response.buffer));
 	}
-	catch (const std::exception& e)
+	catch (const std::exception&)
 	{
-		Close();
+		// Без ответа соединение просто закрывается
 	}
+	m_concurrencyLimiter->Release(std::chrono::steady_clock::now() - start);
+
+	// Ответ отправляется из strand сессии, как и все остальные операции с сокетом
+	boost::asio::post(m_stream.get_executor(), [self = shared_from_this(), &response, message = std::move(message)]() mutable {
+		response.message = std::move(message);
+		response.ready = true;
+		self->WriteNext();
+	});
 }
 
-void Session::SendResponse(http::message_generator&& message)
+void Session::WriteNext()
 {
-	auto keepAlive = message.keep_alive();
-	auto self = shared_from_this();
+	if (m_writing || m_responses.empty() || !m_responses.front().ready)
+	{
+		return;
+	}
+
+	auto& response = m_responses.front();
+	if (!response.message)
+	{
+		m_readClosed = true;
+		Close();
+		return;
+	}
+
+	m_writing = true;
+	const auto keepAlive = response.message->keep_alive();
+	m_stream.expires_after(m_options.writeTimeout);
 	boost::beast::async_write(
 		m_stream,
-		std::move(message),
-		[self, keepAlive](const boost::beast::error_code& ec, std::size_t) {
-			if (!ec && keepAlive)
-			{
-				self->Read();
-			}
-			else
-			{
-				self->Close();
-			}
-		});
+		std::move(*response.message),
+		boost::beast::bind_front_handler(&Session::OnWrite, shared_from_this(), keepAlive));
+}
+
+void Session::OnWrite(const bool keepAlive, const boost::beast::error_code& errorCode, std::size_t bytesWritten)
+{
+	m_writing = false;
+	m_spareBuffers.push_back(std::move(m_responses.front().buffer));
+	m_responses.pop_front();
+	if (errorCode || !keepAlive)
+	{
+		m_readClosed = true;
+		Close();
+		return;
+	}
+
+	WriteNext();
+	ContinueReading();
+	if (m_readClosed && !m_reading && m_responses.empty())
+	{
+		Close();
+	}
+}
+
+std::string Session::AcquireBuffer()
+{
+	if (m_spareBuffers.empty())
+	{
+		return m_bufferPool->Acquire();
+	}
+	auto buffer = std::move(m_spareBuffers.back());
+	m_spareBuffers.pop_back();
+	return buffer;
 }
 
 void Session::Close()
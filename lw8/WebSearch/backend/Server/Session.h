@@ -1,35 +1,94 @@
 #pragma once
 
 #include "../RequestHandler.h"
+#include "BufferPool.h"
+#include "ConcurrencyLimiter.h"
+#include "ConnectionLimiter.h"
+#include "ServerOptions.h"
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/beast/core/flat_buffer.hpp>
 #include <boost/beast/core/tcp_stream.hpp>
 #include <boost/beast/http/message_generator.hpp>
+#include <boost/beast/http/parser.hpp>
 #include <boost/beast/http/string_body.hpp>
+#include <deque>
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Пул, в котором выполняются обработчики запросов, чтобы долгий поиск не занимал потоки ввода-вывода
+using ComputeExecutor = boost::asio::thread_pool::executor_type;
 
 class Session : public std::enable_shared_from_this<Session>
 {
 public:
 	explicit Session(
 		boost::asio::ip::tcp::socket socket,
-		const std::shared_ptr<RequestHandler>& handler);
+		const std::shared_ptr<RequestHandler>& handler,
+		const ComputeExecutor& computeExecutor,
+		const std::shared_ptr<BufferPool>& bufferPool,
+		const std::shared_ptr<ConnectionLimiter>& connectionLimiter,
+		const std::shared_ptr<ConcurrencyLimiter>& concurrencyLimiter,
+		const ServerOptions& options);
+	~Session();
 
 	void Start();
 
 private:
+	// Запросы конвейера обрабатываются параллельно, а ответы уходят строго в порядке запросов
+	struct PendingResponse
+	{
+		// Буфер тела ответа, на который ссылается message до конца отправки
+		std::string buffer;
+		std::optional<http::message_generator> message;
+		bool ready = false;
+	};
+
 	void Read();
 
-	void OnRead(const boost::beast::error_code& errorCode, std::size_t bytesRead);
+	void ReadHeader();
+
+	void OnReadSome(const boost::beast::error_code& errorCode, std::size_t bytesRead);
+
+	void OnReadHeader(const boost::beast::error_code& errorCode, std::size_t bytesRead);
+
+	void OnReadBody(const boost::beast::error_code& errorCode, std::size_t bytesRead);
+
+	void OnReadError();
+
+	void OnRequest();
+
+	void ContinueReading();
+
+	void HandleRequest(http::request<http::string_body>&& request, PendingResponse& response);
+
+	void WriteNext();
+
+	void OnWrite(bool keepAlive, const boost::beast::error_code& errorCode, std::size_t bytesWritten);
 
-	void SendResponse(http::message_generator&& message);
+	std::string AcquireBuffer();
 
 	void Close();
 
 private:
 	std::shared_ptr<RequestHandler> m_handler;
+	ComputeExecutor m_computeExecutor;
+	std::shared_ptr<BufferPool> m_bufferPool;
+	std::shared_ptr<ConnectionLimiter> m_connectionLimiter;
+	std::shared_ptr<ConcurrencyLimiter> m_concurrencyLimiter;
+	const ServerOptions m_options;
 	boost::beast::tcp_stream m_stream;
 	boost::beast::flat_buffer m_buffer;
-	http::request<http::string_body> m_request;
+	std::optional<http::request_parser<http::string_body>> m_parser;
+	// Ссылки на элементы deque не меняются при добавлении в конец и удалении из начала
+	std::deque<PendingResponse> m_responses;
+	// Буферы отправленных ответов переиспользуются следующими запросами соединения
+	std::vector<std::string> m_spareBuffers;
+	bool m_reading = false;
+	bool m_writing = false;
+	// Новых запросов не будет: клиент закрыл соединение, попросил его закрыть или чтение не удалось
+	bool m_readClosed = false;
 };
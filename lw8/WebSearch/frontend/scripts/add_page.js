@@ -16,10 +16,16 @@ form.addEventListener('submit', async (e) => {
     msg.style.display = 'none';
 
     try {
-        const response = await simulateFetch('https://api.lumina.search/v1/index', formData);
-
-        if (response.ok) {
-            showStatus('Страница успешно добавлена в индекс!', 'success');
+        const response = await fetch('http://127.0.0.1:10000/add', {
+            method: 'POST',
+            headers: {'Content-Type': 'application/json'},
+            body: JSON.stringify(formData)
+        });
+
+        if (response.status === 503) {
+            showStatus('Очередь индексации переполнена. Попробуйте позже.', 'error');
+        } else if (response.ok) {
+            showStatus('Страница принята и скоро появится в поиске!', 'success');
             form.reset();
         } else {
             throw new Error('Ошибка сервера');
@@ -32,16 +38,6 @@ form.addEventListener('submit', async (e) => {
     }
 });
 
-function simulateFetch(url, data) {
-    console.log('Отправка данных на:', url, data);
-
-    return new Promise((resolve) => {
-        setTimeout(() => {
-            resolve({ok: true});
-        }, 500);
-    });
-}
-
 function showStatus(text, type) {
     msg.textContent = text;
     msg.className = '';
@@ -2,14 +2,64 @@
 #include "backend/Server/Listener.h"
 
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t MAX_POOLED_BUFFERS = 1024;
+constexpr size_t MAX_POOLED_BUFFER_CAPACITY = 1 << 20;
+
+void PrintUsage()
+{
+	std::cerr << "Usage: ./WebSearch <ADDRESS> <PORT> [IO_THREADS] [COMPUTE_THREADS] [MAX_CONNECTIONS] [LATENCY_SLO_MS] [INDEX_PATH] [SOURCE_DIR]" << std::endl
+			  << "IO_THREADS, COMPUTE_THREADS, MAX_CONNECTIONS and LATENCY_SLO_MS must be positive integers" << std::endl;
+}
+
+// Нулевое число потоков оставило бы пул без исполнителей, а отрицательное после приведения к size_t стало бы огромным
+std::optional<int> ParsePositive(const std::string& text)
+{
+	try
+	{
+		size_t parsedLength = 0;
+		const auto value = std::stoi(text, &parsedLength);
+		if (parsedLength == text.size() && value > 0)
+		{
+			return value;
+		}
+	}
+	catch (const std::exception&)
+	{
+	}
+	return std::nullopt;
+}
 
 int main(const int argc, char* argv[])
 {
-	if (argc < 2)
+	if (argc < 3)
 	{
-		std::cerr << "Usage: ./WebSearch <ADDRESS> <PORT>" << std::endl;
+		PrintUsage();
+		return 1;
+	}
+
+	// Отсутствующий аргумент заменяется значением по умолчанию, неверный — пустой
+	const auto readPositiveArg = [argc, argv](const int index, const int defaultValue) {
+		return argc > index ? ParsePositive(argv[index]) : std::optional(defaultValue);
+	};
+	const ServerOptions defaultOptions;
+	const auto cores = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+	const auto ioThreads = readPositiveArg(3, cores);
+	const auto computeThreads = readPositiveArg(4, cores);
+	const auto maxConnections = readPositiveArg(5, static_cast<int>(defaultOptions.maxConnections));
+	const auto latencySloMs = readPositiveArg(6, static_cast<int>(defaultOptions.latencySlo.count()));
+	if (!ioThreads || !computeThreads || !maxConnections || !latencySloMs)
+	{
+		PrintUsage();
 		return 1;
 	}
 
@@ -18,14 +68,36 @@ int main(const int argc, char* argv[])
 		const auto address = boost::asio::ip::make_address(argv[1]);
 		const unsigned short port = std::stoi(argv[2]);
 
-		const auto handler = std::make_shared<RequestHandler>();
+		ServerOptions options;
+		options.maxConnections = static_cast<size_t>(*maxConnections);
+		options.latencySlo = std::chrono::milliseconds(*latencySloMs);
+		if (argc > 7)
+		{
+			options.indexPath = argv[7];
+		}
+		if (argc > 8)
+		{
+			options.sourceDir = argv[8];
+		}
 
-		boost::asio::io_context ioContext;
+		const auto handler = std::make_shared<RequestHandler>(options);
+		const auto bufferPool = std::make_shared<BufferPool>(MAX_POOLED_BUFFERS, MAX_POOLED_BUFFER_CAPACITY);
+		const auto concurrencyLimiter = std::make_shared<ConcurrencyLimiter>(
+			*computeThreads,
+			options.latencySlo,
+			options.maxQueuedRequests);
+
+		boost::asio::io_context ioContext(*ioThreads);
+		boost::asio::thread_pool computePool(*computeThreads);
 
 		const auto listener = std::make_shared<Listener>(
 			ioContext,
 			boost::asio::ip::tcp::endpoint{ address, port },
-			handler);
+			handler,
+			computePool.get_executor(),
+			bufferPool,
+			concurrencyLimiter,
+			options);
 
 		boost::asio::signal_set signals(ioContext, SIGINT, SIGTERM);
 		signals.async_wait([&](const boost::system::error_code& ec, int signal_number) {
@@ -35,7 +107,17 @@ int main(const int argc, char* argv[])
 
 		listener->Run();
 		std::cout << "Server started on port " << port << std::endl;
+
+		std::vector<std::jthread> ioWorkers;
+		for (int i = 1; i < *ioThreads; ++i)
+		{
+			ioWorkers.emplace_back([&ioContext] {
+				ioContext.run();
+			});
+		}
 		ioContext.run();
+		ioWorkers.clear();
+		computePool.join();
 	}
 	catch (const std::exception& e)
 	{